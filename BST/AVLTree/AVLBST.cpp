@@ -13,6 +13,22 @@
 #include <cstdlib>
 #include <cmath>
 #include <deque>
+#include <ctime>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <cstddef>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "../TreeBenchmark.h"
+#include "../TreeExport.h"
 using namespace std;
 
 /* Type definitions */
@@ -24,6 +40,105 @@ using namespace std;
     BSTNode* right;
   };
 
+/*
+ * Structs : IndexFileHeader,IndexFileNode
+ * -----------------------------------------------------------------------------------------
+ * Layout of a tree saved by saveTree. The header is followed by nodeCount node records in
+ * pre order, so the root is record 0. Children are referred to by record number, -1 for
+ * none. The checksum is the FNV-1a hash of all the node records. Integers are stored in
+ * the byte order of the machine that wrote the file.
+ */
+
+  struct IndexFileHeader{
+    char magic[8];
+    uint32_t version;
+    uint32_t nodeCount;
+    uint32_t checksum;
+    uint32_t reserved;
+  };
+
+  struct IndexFileNode{
+    int32_t key;
+    int32_t bf;
+    int32_t left;
+    int32_t right;
+  };
+
+/*
+ * Struct : MappedTree
+ * -----------------------------------------------------------------------------------------
+ * A read only tree mapped from a file by mapTree. Lookups with findMappedNode run directly
+ * on the mapped pages, which the kernel reads in lazily as they are first touched.
+ */
+
+  struct MappedTree{
+    void* address;
+    size_t length;
+    const IndexFileHeader* header;
+    const IndexFileNode* nodes;
+  };
+
+/*
+ * Struct : LazyTree
+ * -----------------------------------------------------------------------------------------
+ * A tree opened from a file by openLazyTree. Lookups run on the mapping until the first
+ * insert or remove, which thaws the tree into tree and releases the mapping, so a process
+ * that only reads never pays for building the nodes.
+ */
+
+  struct LazyTree{
+    MappedTree mapped;
+    BSTNode* tree;
+    bool thawed;
+  };
+
+/*
+ * Struct : LogRecord
+ * -----------------------------------------------------------------------------------------
+ * One record of the write ahead log kept by a DurableTree. The checksum covers the key and
+ * the type, so a record torn by a crash in the middle of a write is detected on recovery.
+ */
+
+  enum LogRecordType { LOG_INSERT = 1, LOG_REMOVE = 2 };
+
+  struct LogRecord{
+    int32_t key;
+    uint8_t type;
+    uint8_t padding[3];
+    uint32_t checksum;
+  };
+
+/*
+ * Struct : DurableTree
+ * -----------------------------------------------------------------------------------------
+ * An AVL tree whose changes are made durable by a write ahead log and periodic snapshots.
+ * The files used are basePath + ".snapshot" and basePath + ".wal". Writers append records
+ * to pending and wait for the flusher thread, which writes everything pending with one
+ * write and one fdatasync call, so concurrent writers share the cost of a disk flush.
+ * All fields are guarded by lock, except that the flusher writes to logFd without it.
+ */
+
+  struct DurableTree{
+    BSTNode* tree;
+    string basePath;
+    int logFd;
+    vector<LogRecord> pending;
+    uint64_t appendedCount;
+    uint64_t durableCount;
+    int changesSinceSnapshot;
+    bool stopping;
+    mutex lock;
+    condition_variable pendingChanged;
+    condition_variable durableChanged;
+    thread flusher;
+  };
+
+  //Number of logged changes after which the flusher replaces the log by a snapshot.
+  const int SNAPSHOT_INTERVAL = 100000;
+
+  const char INDEX_FILE_MAGIC[8] = {'A','V','L','I','N','D','E','X'};
+  const uint32_t INDEX_FILE_VERSION = 1;
+
 /* Function prototypes */
 void insertNode(BSTNode* &tree,const int &key);
 int insertAVL(BSTNode* parent,BSTNode* &tree, const int &key);
@@ -37,12 +152,42 @@ bool isBalanced(BSTNode *tree);
 bool isBST(BSTNode *tree);
 BSTNode *findNode(BSTNode* &tree, const int &key);
 void displayTree(BSTNode* tree);
+void exportTree(BSTNode* tree);
+  void describeNode(OutputBuffer &out,BSTNode* node);
+void runLookupBenchmark();
+void runWorkloadBenchmark();
+
+bool saveTree(BSTNode* tree,const string &fileName);
+bool mapTree(const string &fileName,MappedTree &mapped,bool verifyChecksum);
+void unmapTree(MappedTree &mapped);
+const IndexFileNode *findMappedNode(const MappedTree &mapped,const int &key);
+bool thawTree(const MappedTree &mapped,BSTNode* &tree);
+  uint32_t checksumNodes(const IndexFileNode* nodes,uint32_t nodeCount);
+  uint32_t checksumBytes(const void* data,size_t length);
+
+bool openLazyTree(LazyTree &lazy,const string &fileName,bool verifyChecksum);
+bool lazyContains(LazyTree &lazy,const int &key);
+bool lazyInsert(LazyTree &lazy,const int &key);
+bool lazyRemove(LazyTree &lazy,const int &key);
+void closeLazyTree(LazyTree &lazy);
+  bool thawLazyTree(LazyTree &lazy);
+
+bool openDurableTree(DurableTree &durable,const string &basePath);
+void durableInsert(DurableTree &durable,const int &key);
+void durableRemove(DurableTree &durable,const int &key);
+void closeDurableTree(DurableTree &durable);
+  void appendLogRecord(DurableTree &durable,const int &key,LogRecordType type);
+  void runFlusher(DurableTree* durable);
+  bool writeSnapshot(DurableTree &durable);
+  bool replayLog(DurableTree &durable,const string &logFile);
+  bool syncFile(const string &fileName);
 
 void removeNode(BSTNode* &tree,const int &key);
 void removeAVL(BSTNode* &tree,BSTNode* nodeToDelete);
   void copyNode(BSTNode* nodeToCopyInto,BSTNode* nodeToDelete);
+  bool isLeftChild(BSTNode* node);
   BSTNode* findSuccessorInLeftSubtree(BSTNode* tree);
-  void fixImbalance(BSTNode* &tree,BSTNode* start);
+  void fixImbalance(BSTNode* &tree,BSTNode* parent,bool leftShorter);
 
 /* The main program */
   int main(){
@@ -85,10 +230,138 @@ void removeAVL(BSTNode* &tree,BSTNode* nodeToDelete);
   removeNode(root,7);//A leaf node involving rotation.
   cout<<"Tree after removal of 7"<<endl;
   displayTree(root);
+  exportTree(root);
+
+  //Saving the tree, then looking keys up in the mapped file until an insert thaws it
+  string indexFile = "AVLBST.idx";
+  LazyTree lazy;
+  if(saveTree(root,indexFile) && openLazyTree(lazy,indexFile,true)){
+    cout<<"Saved and mapped "<<lazy.mapped.header->nodeCount<<" nodes"<<endl;
+    cout<<"Key 5 in mapped tree : "<<lazyContains(lazy,5)<<endl;
+    cout<<"Key 7 in mapped tree : "<<lazyContains(lazy,7)<<endl;
+    if(lazyInsert(lazy,7)){
+      cout<<"Thawed tree after inserting 7"<<endl;
+      displayTree(lazy.tree);
+    }
+    closeLazyTree(lazy);
+  }
+  remove(indexFile.c_str());
+
+  //Logging changes from several threads, then recovering the tree from disk
+  {
+    string basePath = "AVLBST";
+    DurableTree durable;
+    if(openDurableTree(durable,basePath)){
+      vector<thread> writers;
+      for(int t=0;t<4;t++)
+        writers.push_back(thread([&durable,t](){
+          for(int i=t;i<1000;i+=4) durableInsert(durable,i);
+        }));
+      for(int t=0;t<4;t++)
+        writers[t].join();
+      for(int i=0;i<1000;i+=2)
+        durableRemove(durable,i);
+      closeDurableTree(durable);
+
+      DurableTree recovered;
+      if(openDurableTree(recovered,basePath)){
+        cout<<"Recovered tree has 999 : "<<(findNode(recovered.tree,999)!=NULL);
+        cout<<", has 998 : "<<(findNode(recovered.tree,998)!=NULL);
+        cout<<", balanced : "<<isBalanced(recovered.tree)<<endl;
+        closeDurableTree(recovered);
+      }else{
+        cerr<<"Error : Cannot recover the tree from "<<basePath<<endl;
+      }
+    }
+    remove((basePath+".snapshot").c_str());
+    remove((basePath+".wal").c_str());
+  }
+
+  runLookupBenchmark();
+  runWorkloadBenchmark();
     
     return 0;
   }
 
+/*
+ * Function : runLookupBenchmark
+ * ---------------------------------------------------------------------------------------
+ * Measures lookup throughput under the access patterns exported by TreeBenchmark.h.
+ * SplayBST.cpp runs the same workloads so that the two programs can be compared.
+ */
+
+  void runLookupBenchmark(){
+    const int N_KEYS = 100000;
+    const int N_ACCESSES = 2000000;
+    AccessPattern patterns[] = {UNIFORM,ZIPF,SLIDING_WINDOW};
+    vector<int> keys;
+    shuffledKeys(keys,N_KEYS);
+    BSTNode* root = NULL;
+    for(int i=0;i<N_KEYS;i++)
+      insertNode(root,keys[i]);
+
+    cout<<"Lookup benchmark : "<<N_KEYS<<" keys, "<<N_ACCESSES<<" lookups"<<endl;
+    for(int p=0;p<3;p++){
+      vector<int> accesses;
+      generateAccessSequence(accesses,N_KEYS,N_ACCESSES,patterns[p]);
+
+      clock_t start = clock();
+      int found = 0;
+      for(int i=0;i<N_ACCESSES;i++)
+        if(findNode(root,accesses[i])!=NULL) found++;
+      double seconds = secondsSince(start);
+
+      cout<<"AVL ("<<patternName(patterns[p])<<") : ";
+      cout<<(seconds>0?N_ACCESSES/seconds:0)<<" lookups/sec, "<<found<<" found"<<endl;
+    }
+  }
+
+/*
+ * Function : runWorkloadBenchmark
+ * ---------------------------------------------------------------------------------------
+ * Measures throughput on the insert-, lookup- and delete-heavy mixes exported by
+ * TreeBenchmark.h. RBBST.cpp runs the same mixes so that the two programs can be
+ * compared. Deletes of absent keys are filtered with findNode so that removeNode does
+ * not report them.
+ */
+
+  void runWorkloadBenchmark(){
+    const int N_KEYS = 20000;
+    const int N_OPERATIONS = 200000;
+    WorkloadMix mixes[] = {INSERT_HEAVY,LOOKUP_HEAVY,DELETE_HEAVY};
+    vector<int> keys;
+    shuffledKeys(keys,N_KEYS);
+
+    cout<<"Workload benchmark : "<<N_KEYS<<" initial keys, "<<N_OPERATIONS<<" operations"<<endl;
+    for(int m=0;m<3;m++){
+      BSTNode* root = NULL;
+      for(int i=0;i<N_KEYS;i++)
+        insertNode(root,2*keys[i]);
+      vector<TreeOperation> operations;
+      generateOperationMix(operations,N_KEYS,N_OPERATIONS,mixes[m]);
+
+      clock_t start = clock();
+      int hits = 0;
+      for(int i=0;i<N_OPERATIONS;i++){
+        switch(operations[i].type){
+          case INSERT_OP: insertNode(root,operations[i].key); break;
+          case LOOKUP_OP: if(findNode(root,operations[i].key)!=NULL) hits++; break;
+          case DELETE_OP:
+            if(findNode(root,operations[i].key)!=NULL){
+              removeNode(root,operations[i].key);
+              hits++;
+            }
+            break;
+        }
+      }
+      double seconds = secondsSince(start);
+
+      cout<<"AVL ("<<mixName(mixes[m])<<") : ";
+      cout<<(seconds>0?N_OPERATIONS/seconds:0)<<" operations/sec, "<<hits<<" hits, ";
+      cout<<"valid : "<<(isBalanced(root) && isBST(root))<<endl;
+    }
+  }
+
 /*
  * Function : insertNode
  * ------------------------------
@@ -348,31 +621,57 @@ void removeAVL(BSTNode* &tree,BSTNode* nodeToDelete);
 
 /* 
  * Function : displayTree
- * ------------------------------
- * Displays by inorder traversal.
+ * -----------------------------------------------------------------
+ * Displays by inorder traversal, through the shared output buffer.
  */
 
   void displayTree(BSTNode* tree){
-    if(tree==NULL)
-      return;
-    else{
-      displayTree(tree->left);
-      cout<<"Key : "<<tree->key<<"  ";
-      if(tree->parent!=NULL)
-        cout<<"Parent : "<<tree->parent->key<<"  ";
-      else
-        cout<<"Parent : NULL"<<"  ";
-      if(tree->left!=NULL)
-        cout<<"Left Child : "<<tree->left->key<<"  ";
-      else
-        cout<<"Left Child : NULL"<<"  ";
-      if(tree->right!=NULL)   
-        cout<<"Right Child : "<<tree->right->key<<"  ";
-      else
-        cout<<"Right Child : NULL"<<"  ";
-      cout<<"Balance factor : "<<tree->bf<<endl; 
-      displayTree(tree->right);
-    }
+    OutputBuffer &out = standardOutputBuffer();
+    renderInOrder(out,tree,describeNode);
+    out.flush();
+  }
+
+/*
+ * Function : exportTree
+ * ------------------------------------------------------------------------------------
+ * Writes the keys in pre order and as an indented hierarchy, then the tree as JSON and as
+ * a Graphviz graph, through the shared output buffer. The graph can be drawn with dot -Tpng.
+ */
+
+  void exportTree(BSTNode* tree){
+    OutputBuffer &out = standardOutputBuffer();
+    out<<"Tree in pre order :\n";
+    renderPreOrder(out,tree,describeKey<BSTNode>);
+    out<<"Tree as a hierarchy :\n";
+    renderIndented(out,tree,describeKey<BSTNode>);
+    out<<"Tree as JSON : ";
+    renderJSON(out,tree);
+    out<<"Tree as DOT :\n";
+    renderDOT(out,tree);
+    out.flush();
+  }
+
+/*
+ * Function : describeNode
+ * ---------------------------------------------------------------
+ * Writes the line of displayTree for one node, without its newline.
+ */
+
+  void describeNode(OutputBuffer &out,BSTNode* node){
+    out<<"Key : "<<node->key<<"  ";
+    if(node->parent!=NULL)
+      out<<"Parent : "<<node->parent->key<<"  ";
+    else
+      out<<"Parent : NULL"<<"  ";
+    if(node->left!=NULL)
+      out<<"Left Child : "<<node->left->key<<"  ";
+    else
+      out<<"Left Child : NULL"<<"  ";
+    if(node->right!=NULL)
+      out<<"Right Child : "<<node->right->key<<"  ";
+    else
+      out<<"Right Child : NULL"<<"  ";
+    out<<"Balance factor : "<<node->bf;
   }
 
 /* 
@@ -400,6 +699,13 @@ void removeAVL(BSTNode* &tree,BSTNode* nodeToDelete);
     //Case 1 : Deleting the node with no children. The leaf node.
     if(nodeToDelete->left==NULL && nodeToDelete->right==NULL){
 
+      //Deleting the only node of the tree.
+      if(nodeToDelete->parent==NULL){
+        tree = NULL;
+        delete nodeToDelete;
+        return;
+      }
+
       //Making amends to the parents members. Memory freeing done at the end.
       bool deletedIsLeft = false;
       if(nodeToDelete->parent->left==nodeToDelete){
@@ -410,24 +716,27 @@ void removeAVL(BSTNode* &tree,BSTNode* nodeToDelete);
         nodeToDelete->parent->right=NULL;
      
       //Balancing the tree after deletion
-      fixImbalance(tree,nodeToDelete->parent); 
+      fixImbalance(tree,nodeToDelete->parent,deletedIsLeft); 
       //Freeing the heap memory.
       delete nodeToDelete;
 
     }else if((nodeToDelete->right!=NULL && nodeToDelete->left==NULL) ||(nodeToDelete->right==NULL && nodeToDelete->left!=NULL)){
 
     //Case 2 : Deleting the node with one child.                            
+      //The child is copied into nodeToDelete, so it is the child that gets freed.
       if(nodeToDelete->right!=NULL){
-        copyNode(nodeToDelete,nodeToDelete->right);
+        BSTNode* child = nodeToDelete->right;
+        copyNode(nodeToDelete,child);
         //Balancing the tree after deletion
-        fixImbalance(tree,nodeToDelete); 
-        delete nodeToDelete->right;
+        fixImbalance(tree,nodeToDelete->parent,isLeftChild(nodeToDelete)); 
+        delete child;
       }
       else{
-        copyNode(nodeToDelete,nodeToDelete->left);    
+        BSTNode* child = nodeToDelete->left;
+        copyNode(nodeToDelete,child);    
 	//Balancing the tree after deletion
-        fixImbalance(tree,nodeToDelete); 
-        delete nodeToDelete->left;
+        fixImbalance(tree,nodeToDelete->parent,isLeftChild(nodeToDelete)); 
+        delete child;
       }
       
     }else{
@@ -436,17 +745,19 @@ void removeAVL(BSTNode* &tree,BSTNode* nodeToDelete);
       nodeToDelete->key = successor->key;
       if(successor->left!=NULL){    
         //We use ->left here since findSuccessorInLeftSubtree finds the rightmost node in the left subtree.
-        copyNode(successor,successor->left);
+        BSTNode* child = successor->left;
+        copyNode(successor,child);
         //Balancing the tree after deletion
-        fixImbalance(tree,successor); 
-        delete successor->left;
+        fixImbalance(tree,successor->parent,isLeftChild(successor)); 
+        delete child;
       }else{
-        if(successor->parent->left == successor)
+        bool successorIsLeft = isLeftChild(successor);
+        if(successorIsLeft)
           successor->parent->left= NULL; 
         else
           successor->parent->right = NULL;
         //Balancing the tree after deletion
-        fixImbalance(tree,successor->parent); 
+        fixImbalance(tree,successor->parent,successorIsLeft); 
         delete successor;
       }
     } 
@@ -454,51 +765,50 @@ void removeAVL(BSTNode* &tree,BSTNode* nodeToDelete);
 /* 
  * Function : fixImbalance
  * ----------------------------------------------------------------------------------------
- * Function used in removeAVL. Fixed imbalance starting at a node all the way upto the root
+ * Function used in removeAVL. Restores the balance factors on the path from parent up, after
+ * the left or right subtree of parent, as leftShorter says, lost one level. Works from the
+ * stored balance factors like fixLeftImbalance and fixRightImbalance, and stops as soon as a
+ * subtree keeps its height, so a removal takes O(log N) time.
  */
 
-  void fixImbalance(BSTNode* &tree,BSTNode* start){
-    if(start==NULL) return;//Incase of one node tree.
-
-    //Some node pointers we use in the algorithm to balance the tree.
-    BSTNode* z = start; 
-    BSTNode* forTheTree = NULL;
-    //Travels up until it reaches the root
+  void fixImbalance(BSTNode* &tree,BSTNode* parent,bool leftShorter){
+    BSTNode* z = parent;
     while(z!=NULL){
-      int bf_z = height(z->right)-height(z->left);
-      z->bf = bf_z;
-      //Condition for a node being unbalanced
-      if(abs(bf_z)>1){
-        bool yl = height(z->left)>height(z->right);
-        bool yr = yl?false:true;
-        BSTNode* y = yl?z->left:z->right;
-        bool xl = height(y->left)>height(y->right);
-        bool xr = xl?false:true;
-        BSTNode* x = xl?y->left:y->right; 
-        bool ylxl = yl && xl;
-        bool ylxr = yl && xr;
-        bool yrxl = yr && xl;
-        bool yrxr = yr && xr;
-        if(ylxl){
-          rotateRight(z);
-        }else if(ylxr){
-          rotateLeft(y);
-          rotateRight(z);
-        }else if(yrxl){
-          rotateRight(y);
-          rotateLeft(z);
-        }else{
-          rotateLeft(z);
+      //The balance factor z would have, before any rotation.
+      int bf_z = z->bf+(leftShorter?1:-1);
+      if(bf_z==1 || bf_z==-1){
+        //z was balanced, so its height is unchanged.
+        z->bf = bf_z;
+        return;
+      }
+      if(bf_z!=0){
+        //z is two levels heavier on the other side. On a tie between the children of that
+        //side a single rotation is enough, and it leaves the height of the subtree unchanged.
+        BSTNode* y = bf_z>0?z->right:z->left;
+        if(y->bf==0){
+          if(bf_z>0) rotateLeft(z); else rotateRight(z);
+          if(bf_z>0){
+            z->bf = -1;
+            z->left->bf = 1;
+          }else{
+            z->bf = 1;
+            z->right->bf = -1;
+          }
+          if(z->parent==NULL) tree = z;
+          return;
         }
+        if(bf_z>0) fixRightImbalance(z); else fixLeftImbalance(z);
+        if(z->parent==NULL) tree = z;
+      }else{
+        z->bf = 0;
       }
-   
-      //Update for the while loop
-      forTheTree = z;
-      z = z->parent;      
-    }//End of while loop
-    if(forTheTree!=NULL)
-      tree = forTheTree;
+      //The subtree at z lost one level, so the walk goes on at its parent.
+      if(z->parent==NULL) return;
+      leftShorter = isLeftChild(z);
+      z = z->parent;
+    }
   }
+
 /*
  * Function : findSuccessorInLeftSubtree
  * -----------------------------------------------------------------
@@ -516,14 +826,521 @@ void removeAVL(BSTNode* &tree,BSTNode* nodeToDelete);
 
 /*
  * Function : copyNode
- * ----------------------------------------------
- * Copies contents from one node to second node.
+ * -----------------------------------------------------------------------------
+ * Copies contents from one node to second node and reparents the copied children.
  */
 
   void copyNode(BSTNode* nodeToCopyInto,BSTNode* nodeToDelete){
     nodeToCopyInto->key = nodeToDelete->key;
+    nodeToCopyInto->bf = nodeToDelete->bf;
     nodeToCopyInto->left = nodeToDelete->left;
     nodeToCopyInto->right = nodeToDelete->right;
+    //The adopted children must point back at their new parent.
+    if(nodeToCopyInto->left!=NULL)
+      nodeToCopyInto->left->parent = nodeToCopyInto;
+    if(nodeToCopyInto->right!=NULL)
+      nodeToCopyInto->right->parent = nodeToCopyInto;
+  }
+
+/*
+ * Function : isLeftChild
+ * ------------------------------------------------------
+ * Returns whether a node is the left child of its parent.
+ */
+
+  bool isLeftChild(BSTNode* node){
+    return node->parent!=NULL && node->parent->left==node;
+  }
+
+
+
+/*
+ * Function : saveTree
+ * -----------------------------------------------------------------------------------------
+ * Writes the tree to the specified file in the format described at IndexFileHeader. The
+ * nodes are numbered in pre order with an explicit stack, so deep trees cannot overflow
+ * the call stack. Returns false if the file could not be written.
+ */
+
+  bool saveTree(BSTNode* tree,const string &fileName){
+    vector<IndexFileNode> records;
+    vector<BSTNode*> order;
+    vector<BSTNode*> stack;
+    if(tree!=NULL)
+      stack.push_back(tree);
+    while(!stack.empty()){
+      BSTNode* node = stack.back();
+      stack.pop_back();
+      order.push_back(node);
+      if(node->right!=NULL) stack.push_back(node->right);
+      if(node->left!=NULL) stack.push_back(node->left);
+    }
+    //Pre order numbering puts a left child right after its parent, and a right child
+    //right after the last node of the left subtree.
+    records.resize(order.size());
+    vector<int32_t> subtreeEnd(order.size());
+    for(int i=(int)order.size()-1;i>=0;i--){
+      BSTNode* node = order[i];
+      IndexFileNode &record = records[i];
+      record.key = node->key;
+      record.bf = node->bf;
+      int32_t next = i+1;
+      record.left = -1;
+      record.right = -1;
+      if(node->left!=NULL){
+        record.left = next;
+        next = subtreeEnd[next];
+      }
+      if(node->right!=NULL){
+        record.right = next;
+        next = subtreeEnd[next];
+      }
+      subtreeEnd[i] = next;
+    }
+
+    IndexFileHeader header;
+    memset(&header,0,sizeof(header));
+    memcpy(header.magic,INDEX_FILE_MAGIC,sizeof(header.magic));
+    header.version = INDEX_FILE_VERSION;
+    header.nodeCount = records.size();
+    header.checksum = checksumNodes(records.empty()?NULL:&records[0],header.nodeCount);
+
+    ofstream file(fileName.c_str(),ios::binary|ios::trunc);
+    if(file.fail()) return false;
+    file.write((const char*)&header,sizeof(header));
+    if(!records.empty())
+      file.write((const char*)&records[0],records.size()*sizeof(IndexFileNode));
+    file.close();
+    return !file.fail();
   }
 
+/*
+ * Function : mapTree
+ * -----------------------------------------------------------------------------------------
+ * Maps a file written by saveTree read only into memory without copying it. Checks the
+ * magic, version and size, and the checksum if verifyChecksum is set. Verifying reads the
+ * whole file once, so it can be skipped for files already known to be intact when only
+ * the pages touched by lookups should be read. Returns false if the file is not valid.
+ * Child indices are not checked here, as that too would read the whole file; instead
+ * findMappedNode and thawTree refuse any that break the pre order layout.
+ */
 
+  bool mapTree(const string &fileName,MappedTree &mapped,bool verifyChecksum){
+    int fd = open(fileName.c_str(),O_RDONLY);
+    if(fd<0) return false;
+    struct stat info;
+    if(fstat(fd,&info)!=0 || (size_t)info.st_size<sizeof(IndexFileHeader)){
+      close(fd);
+      return false;
+    }
+    void* address = mmap(NULL,info.st_size,PROT_READ,MAP_SHARED,fd,0);
+    //The mapping stays valid after the descriptor is closed.
+    close(fd);
+    if(address==MAP_FAILED) return false;
+
+    const IndexFileHeader* header = (const IndexFileHeader*)address;
+    const IndexFileNode* nodes = (const IndexFileNode*)(header+1);
+    bool valid = memcmp(header->magic,INDEX_FILE_MAGIC,sizeof(header->magic))==0
+                 && header->version==INDEX_FILE_VERSION
+                 && (size_t)info.st_size==sizeof(IndexFileHeader)+header->nodeCount*sizeof(IndexFileNode);
+    if(valid && verifyChecksum)
+      valid = checksumNodes(nodes,header->nodeCount)==header->checksum;
+    if(!valid){
+      munmap(address,info.st_size);
+      return false;
+    }
+    mapped.address = address;
+    mapped.length = info.st_size;
+    mapped.header = header;
+    mapped.nodes = nodes;
+    return true;
+  }
+
+/*
+ * Function : unmapTree
+ * ------------------------------------------------------------------
+ * Releases a mapping made by mapTree. Node pointers into it go stale.
+ */
+
+  void unmapTree(MappedTree &mapped){
+    munmap(mapped.address,mapped.length);
+    mapped.address = NULL;
+    mapped.header = NULL;
+    mapped.nodes = NULL;
+  }
+
+/*
+ * Function : findMappedNode
+ * -----------------------------------------------------------------------------------------
+ * Finds the record with the specified key in a mapped tree. Returns NULL if absent. In pre
+ * order every child comes after its parent, so the walk stops at a child index that is not
+ * past the current record or is past the last one. That keeps a damaged file, mapped without
+ * verifying its checksum, from sending the walk out of the mapping or round a cycle.
+ */
+
+  const IndexFileNode *findMappedNode(const MappedTree &mapped,const int &key){
+    if(mapped.header->nodeCount==0) return NULL;
+    int32_t index = 0;
+    while(true){
+      const IndexFileNode &node = mapped.nodes[index];
+      if(node.key==key)
+        return &node;
+      int32_t next = key<node.key?node.left:node.right;
+      if(next<=index || (uint32_t)next>=mapped.header->nodeCount)
+        return NULL;
+      index = next;
+    }
+  }
+
+/*
+ * Function : thawTree
+ * -----------------------------------------------------------------------------------------
+ * Rebuilds a writable tree from a mapped one into tree, keeping its shape and balance
+ * factors, so no rebalancing is needed. Takes O(N) time against O(N log N) for N insertNode
+ * calls. Returns false, leaving tree NULL, unless every record but the first is the child of
+ * exactly one earlier record, which holds for the pre order layout and rules out cycles and
+ * shared children in a damaged file.
+ */
+
+  bool thawTree(const MappedTree &mapped,BSTNode* &tree){
+    tree = NULL;
+    uint32_t count = mapped.header->nodeCount;
+    if(count==0) return true;
+    vector<BSTNode*> nodes(count);
+    for(uint32_t i=0;i<count;i++){
+      nodes[i] = new BSTNode;
+      nodes[i]->key = mapped.nodes[i].key;
+      nodes[i]->bf = mapped.nodes[i].bf;
+      nodes[i]->parent = NULL;
+      nodes[i]->left = NULL;
+      nodes[i]->right = NULL;
+    }
+    bool valid = true;
+    for(uint32_t i=0;i<count && valid;i++){
+      int32_t children[2] = {mapped.nodes[i].left,mapped.nodes[i].right};
+      for(int side=0;side<2 && valid;side++){
+        int32_t child = children[side];
+        if(child==-1) continue;
+        valid = child>(int32_t)i && (uint32_t)child<count && nodes[child]->parent==NULL;
+        if(!valid) break;
+        nodes[child]->parent = nodes[i];
+        (side==0?nodes[i]->left:nodes[i]->right) = nodes[child];
+      }
+    }
+    for(uint32_t i=1;i<count && valid;i++)
+      valid = nodes[i]->parent!=NULL;
+    if(!valid){
+      for(uint32_t i=0;i<count;i++)
+        delete nodes[i];
+      return false;
+    }
+    tree = nodes[0];
+    return true;
+  }
+
+/*
+ * Function : openLazyTree
+ * -----------------------------------------------------------------------------------------
+ * Maps the file written by saveTree, as mapTree does, without building any node. Returns
+ * false if the file is not valid.
+ */
+
+  bool openLazyTree(LazyTree &lazy,const string &fileName,bool verifyChecksum){
+    lazy.tree = NULL;
+    lazy.thawed = false;
+    return mapTree(fileName,lazy.mapped,verifyChecksum);
+  }
+
+/*
+ * Functions : lazyContains,lazyInsert,lazyRemove
+ * -----------------------------------------------------------------------------------------
+ * lazyContains looks the key up in the mapping, or in the tree once thawed. The other two
+ * thaw the tree first if need be, then change it, and return false only if the file turned
+ * out to be damaged when thawing, in which case nothing is changed.
+ */
+
+  bool lazyContains(LazyTree &lazy,const int &key){
+    if(lazy.thawed)
+      return findNode(lazy.tree,key)!=NULL;
+    return findMappedNode(lazy.mapped,key)!=NULL;
+  }
+
+  bool lazyInsert(LazyTree &lazy,const int &key){
+    if(!thawLazyTree(lazy)) return false;
+    insertNode(lazy.tree,key);
+    return true;
+  }
+
+  bool lazyRemove(LazyTree &lazy,const int &key){
+    if(!thawLazyTree(lazy)) return false;
+    if(findNode(lazy.tree,key)!=NULL)
+      removeNode(lazy.tree,key);
+    return true;
+  }
+
+/*
+ * Function : thawLazyTree
+ * ---------------------------------------------------------------------------------------
+ * Thaws the tree and releases the mapping, unless that was done already. Returns false
+ * and keeps the mapping if the records do not form a tree.
+ */
+
+  bool thawLazyTree(LazyTree &lazy){
+    if(lazy.thawed) return true;
+    if(!thawTree(lazy.mapped,lazy.tree)) return false;
+    unmapTree(lazy.mapped);
+    lazy.thawed = true;
+    return true;
+  }
+
+/*
+ * Function : closeLazyTree
+ * -------------------------------------------------------------------------------------
+ * Releases the mapping if the tree was never thawed. A thawed tree stays in lazy.tree
+ * and belongs to the caller.
+ */
+
+  void closeLazyTree(LazyTree &lazy){
+    if(!lazy.thawed)
+      unmapTree(lazy.mapped);
+  }
+
+/*
+ * Function : checksumNodes
+ * --------------------------------------------------------
+ * FNV-1a hash over the bytes of the node records of a file.
+ */
+
+  uint32_t checksumNodes(const IndexFileNode* nodes,uint32_t nodeCount){
+    return checksumBytes(nodes,(size_t)nodeCount*sizeof(IndexFileNode));
+  }
+
+  uint32_t checksumBytes(const void* data,size_t length){
+    uint32_t hash = 2166136261u;
+    const unsigned char* bytes = (const unsigned char*)data;
+    for(size_t i=0;i<length;i++){
+      hash ^= bytes[i];
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+
+/*
+ * Function : openDurableTree
+ * -----------------------------------------------------------------------------------------
+ * Recovers the tree kept at basePath and starts its flusher thread. The last snapshot is
+ * thawed, if there is one, and the log is replayed on top of it. Replay stops at the first
+ * torn or corrupt record, which can only be a write that was never acknowledged, and the
+ * log is cut back to the last good record. Returns false if the files cannot be used.
+ */
+
+  bool openDurableTree(DurableTree &durable,const string &basePath){
+    durable.tree = NULL;
+    durable.basePath = basePath;
+    durable.pending.clear();
+    durable.appendedCount = durable.durableCount = 0;
+    durable.changesSinceSnapshot = 0;
+    durable.stopping = false;
+
+    string snapshotFile = basePath+".snapshot";
+    string logFile = basePath+".wal";
+    if(access(snapshotFile.c_str(),F_OK)==0){
+      MappedTree mapped;
+      if(!mapTree(snapshotFile,mapped,true)) return false;
+      bool thawed = thawTree(mapped,durable.tree);
+      unmapTree(mapped);
+      if(!thawed) return false;
+    }
+    if(!replayLog(durable,logFile)) return false;
+
+    durable.logFd = open(logFile.c_str(),O_WRONLY|O_APPEND|O_CREAT,0644);
+    if(durable.logFd<0) return false;
+    durable.flusher = thread(runFlusher,&durable);
+    return true;
+  }
+
+/*
+ * Function : replayLog
+ * -------------------------------------------------------------------------------
+ * Applies the valid prefix of the log to durable.tree and truncates the rest away.
+ */
+
+  bool replayLog(DurableTree &durable,const string &logFile){
+    ifstream file(logFile.c_str(),ios::binary);
+    if(file.fail()) return true;//No log yet.
+    LogRecord record;
+    off_t validLength = 0;
+    while(file.read((char*)&record,sizeof(record))){
+      if(checksumBytes(&record,offsetof(LogRecord,checksum))!=record.checksum) break;
+      if(record.type==LOG_INSERT)
+        insertNode(durable.tree,record.key);
+      else if(record.type==LOG_REMOVE && findNode(durable.tree,record.key)!=NULL)
+        removeNode(durable.tree,record.key);
+      else if(record.type!=LOG_REMOVE)
+        break;
+      validLength += sizeof(record);
+      durable.changesSinceSnapshot++;
+    }
+    file.close();
+    return truncate(logFile.c_str(),validLength)==0;
+  }
+
+/*
+ * Functions : durableInsert,durableRemove
+ * -----------------------------------------------------------------------------------------
+ * Change the tree and return once the change is on disk. Several threads may call these
+ * at once; their records are then flushed together. Changes that leave the tree as it was
+ * (inserting a present key, removing an absent one) are not logged.
+ */
+
+  void durableInsert(DurableTree &durable,const int &key){
+    unique_lock<mutex> guard(durable.lock);
+    if(findNode(durable.tree,key)!=NULL) return;
+    insertNode(durable.tree,key);
+    appendLogRecord(durable,key,LOG_INSERT);
+    uint64_t mine = durable.appendedCount;
+    while(durable.durableCount<mine)
+      durable.durableChanged.wait(guard);
+  }
+
+  void durableRemove(DurableTree &durable,const int &key){
+    unique_lock<mutex> guard(durable.lock);
+    if(findNode(durable.tree,key)==NULL) return;
+    removeNode(durable.tree,key);
+    appendLogRecord(durable,key,LOG_REMOVE);
+    uint64_t mine = durable.appendedCount;
+    while(durable.durableCount<mine)
+      durable.durableChanged.wait(guard);
+  }
+
+/*
+ * Function : appendLogRecord
+ * ---------------------------------------------------------------------------
+ * Queues a record for the flusher. Must be called with durable.lock held.
+ */
+
+  void appendLogRecord(DurableTree &durable,const int &key,LogRecordType type){
+    LogRecord record;
+    memset(&record,0,sizeof(record));
+    record.key = key;
+    record.type = type;
+    record.checksum = checksumBytes(&record,offsetof(LogRecord,checksum));
+    durable.pending.push_back(record);
+    durable.appendedCount++;
+    durable.changesSinceSnapshot++;
+    durable.pendingChanged.notify_one();
+  }
+
+/*
+ * Function : runFlusher
+ * -----------------------------------------------------------------------------------------
+ * Body of the flusher thread. Takes everything pending, writes and syncs it with the lock
+ * released, so writers keep queueing records for the next batch meanwhile, then wakes the
+ * writers whose records are now durable. Once SNAPSHOT_INTERVAL changes have been logged it
+ * writes a snapshot instead, which also covers the pending records. Since only this thread
+ * touches the log, no batch can be in flight while the log is being replaced. If the snapshot
+ * fails, for instance on a full disk, the log still holds every change, so the error is
+ * reported and the count restarted : the next attempt comes SNAPSHOT_INTERVAL changes later
+ * rather than on every batch, each of which would save the whole tree with the lock held.
+ */
+
+  void runFlusher(DurableTree* durable){
+    unique_lock<mutex> guard(durable->lock);
+    vector<LogRecord> batch;
+    while(true){
+      while(durable->pending.empty() && !durable->stopping)
+        durable->pendingChanged.wait(guard);
+      if(durable->pending.empty() && durable->stopping)
+        break;
+
+      if(durable->changesSinceSnapshot>=SNAPSHOT_INTERVAL){
+        if(writeSnapshot(*durable)){
+          durable->pending.clear();
+          durable->durableCount = durable->appendedCount;
+          durable->durableChanged.notify_all();
+          continue;
+        }
+        cerr<<"Error : Cannot write a snapshot of "<<durable->basePath<<", keeping the log"<<endl;
+        durable->changesSinceSnapshot = 0;
+      }
+
+      batch.swap(durable->pending);
+      uint64_t batchEnd = durable->appendedCount;
+      guard.unlock();
+      const char* bytes = (const char*)&batch[0];
+      size_t remaining = batch.size()*sizeof(LogRecord);
+      while(remaining>0){
+        ssize_t written = write(durable->logFd,bytes,remaining);
+        if(written<0){
+          cerr<<"Error : Cannot write to the log of "<<durable->basePath<<endl;
+          abort();
+        }
+        bytes += written;
+        remaining -= written;
+      }
+      if(fdatasync(durable->logFd)!=0){
+        cerr<<"Error : Cannot sync the log of "<<durable->basePath<<endl;
+        abort();
+      }
+      batch.clear();
+      guard.lock();
+      durable->durableCount = batchEnd;
+      durable->durableChanged.notify_all();
+    }
+  }
+
+/*
+ * Function : writeSnapshot
+ * -----------------------------------------------------------------------------------------
+ * Saves the tree to a temporary file, syncs it and renames it over the old snapshot, so a
+ * crash leaves either the old or the new snapshot in place. The log is then emptied, as
+ * the snapshot covers every change in it. Called by the flusher with durable.lock held. A
+ * temporary file that could not be completed is removed, so it does not hold on to disk space.
+ */
+
+  bool writeSnapshot(DurableTree &durable){
+    string snapshotFile = durable.basePath+".snapshot";
+    string tempFile = snapshotFile+".tmp";
+    if(!saveTree(durable.tree,tempFile) || !syncFile(tempFile) || rename(tempFile.c_str(),snapshotFile.c_str())!=0){
+      unlink(tempFile.c_str());
+      return false;
+    }
+    //The directory entry must be on disk before the log may be emptied.
+    string directory = durable.basePath.find('/')==string::npos?".":durable.basePath.substr(0,durable.basePath.rfind('/')+1);
+    if(!syncFile(directory)) return false;
+    if(ftruncate(durable.logFd,0)!=0 || fdatasync(durable.logFd)!=0) return false;
+    durable.changesSinceSnapshot = 0;
+    return true;
+  }
+
+/*
+ * Function : syncFile
+ * ------------------------------------------------------------------
+ * Flushes a file or directory to disk. Returns false if that failed.
+ */
+
+  bool syncFile(const string &fileName){
+    int fd = open(fileName.c_str(),O_RDONLY);
+    if(fd<0) return false;
+    bool synced = fsync(fd)==0;
+    close(fd);
+    return synced;
+  }
+
+/*
+ * Function : closeDurableTree
+ * -----------------------------------------------------------------------------------------
+ * Stops the flusher once everything pending is on disk and closes the log. The in memory
+ * tree stays in durable.tree and belongs to the caller.
+ */
+
+  void closeDurableTree(DurableTree &durable){
+    {
+      lock_guard<mutex> guard(durable.lock);
+      durable.stopping = true;
+      durable.pendingChanged.notify_one();
+    }
+    durable.flusher.join();
+    close(durable.logFd);
+    durable.logFd = -1;
+  }
@@ -13,7 +13,8 @@
 #include <string>
 #include <cstdlib>
 #include <cmath>
-#include <deque>
+#include "../TreeExport.h"
+#include "../../Queue/Deque.h"
 using namespace std;
 
 /* Type definitions */
@@ -31,7 +32,7 @@ using namespace std;
   //Maximum no of elements that can be marked for lazy deletion
   const int LAZY_DEL_CAPACITY = 5;
   //Queue to hold the variables marked as delete for lazy deletion.
-  deque<BSTNode* > deleteDeque;
+  Deque<BSTNode* > deleteDeque;
 
 /* Function prototypes */
 void insertNode(BSTNode* &tree,const int &key);
@@ -46,6 +47,7 @@ bool isBalanced(BSTNode *tree);
 bool isBST(BSTNode *tree);
 BSTNode *findNode(BSTNode* &tree, const int &key);
 void displayTree(BSTNode* tree);
+  void describeNode(OutputBuffer &out,BSTNode* node);
 void displayDeleteDeque();
 void drawLine();
 
@@ -153,14 +155,14 @@ int main(){
   void insertNode(BSTNode* &tree,const int &key){
     bool lazilyDeleted =false;
     BSTNode* node= NULL;
-    deque<BSTNode*> newdeque;
+    Deque<BSTNode*> newdeque;
     for(int i=0;i<deleteDeque.size();i++){
       if(deleteDeque[i]->key==key){
         //Condition is set true if the node is already in tree but just marked deleted.
         lazilyDeleted=true;
         node = deleteDeque[i];
       }else{
-        newdeque.push_back(deleteDeque[i]);
+        newdeque.pushBack(deleteDeque[i]);
       }
     }
     //If node already present in tree, but just marked deleted, change the isDeleted field.
@@ -447,32 +449,37 @@ int main(){
 /*
  * Function : displayTree
  * --------------------------------------------------------------------------------------------------------
- * Displays by inorder traversal. Displays the actual tree in memory, with elements marked by lazy delete
+ * Displays by inorder traversal. Displays the actual tree in memory, with elements marked by lazy delete.
+ * Goes through the shared output buffer.
  */
 
   void displayTree(BSTNode* tree){
-    if(tree==NULL)
-      return;
-    else{
-      displayTree(tree->left);
-      cout<<"Key : "<<tree->key<<"  ";
-      if(tree->parent!=NULL)
-        cout<<"Parent : "<<tree->parent->key<<"  ";
-      else
-        cout<<"Parent : NULL"<<"  ";
-      if(tree->left!=NULL)
-        cout<<"Left Child : "<<tree->left->key<<"  ";
-      else
-        cout<<"Left Child : NULL"<<"  ";
-      if(tree->right!=NULL)
-        cout<<"Right Child : "<<tree->right->key<<"  ";
-      else
-        cout<<"Right Child : NULL"<<"  ";
-      bool isDeleted = tree->isDeleted;
-      string status = isDeleted?"Deleted":"Not Deleted";
-      cout<<"Status : "<<status<<endl;
-      displayTree(tree->right);
-    }
+    OutputBuffer &out = standardOutputBuffer();
+    renderInOrder(out,tree,describeNode);
+    out.flush();
+  }
+
+/*
+ * Function : describeNode
+ * ---------------------------------------------------------------
+ * Writes the line of displayTree for one node, without its newline.
+ */
+
+  void describeNode(OutputBuffer &out,BSTNode* node){
+    out<<"Key : "<<node->key<<"  ";
+    if(node->parent!=NULL)
+      out<<"Parent : "<<node->parent->key<<"  ";
+    else
+      out<<"Parent : NULL"<<"  ";
+    if(node->left!=NULL)
+      out<<"Left Child : "<<node->left->key<<"  ";
+    else
+      out<<"Left Child : NULL"<<"  ";
+    if(node->right!=NULL)
+      out<<"Right Child : "<<node->right->key<<"  ";
+    else
+      out<<"Right Child : NULL"<<"  ";
+    out<<"Status : "<<(node->isDeleted?"Deleted":"Not Deleted");
   }
 
 /*
@@ -498,18 +505,18 @@ int main(){
  */
 
   void removeAVLLazy(BSTNode* &tree,BSTNode* nodeToDelete){
-    deque<BSTNode* > newdeque;
+    Deque<BSTNode* > newdeque;
     if(deleteDeque.size()==LAZY_DEL_CAPACITY){
       //Deleting all the nodes listed in the delete Queue , and empty the queue, once the capacity has been reached.
       for(int i=0;i<LAZY_DEL_CAPACITY;i++){
         removeAVL(tree,deleteDeque[i]);
       }
       nodeToDelete->isDeleted =true;
-      newdeque.push_back(nodeToDelete);
+      newdeque.pushBack(nodeToDelete);
       deleteDeque = newdeque;
     }else{
       nodeToDelete->isDeleted =true;
-      deleteDeque.push_back(nodeToDelete);
+      deleteDeque.pushBack(nodeToDelete);
     }
   }
 
@@ -0,0 +1,190 @@
+/*
+ * File : edgeFileParser.h
+ * ---------------------------------------------------------------------------------------
+ * Streaming reader for files in the format of familytree.txt : the name of the root on
+ * the first line, then one Child:Parent line per edge. The file is mapped into memory and
+ * names are handed out as string_views into the mapping, so parsing copies no characters
+ * and allocates nothing per line. Lines and separators are found with memchr, which the C
+ * library implements with vector instructions. Large files can be parsed by several
+ * threads, each taking a chunk of whole lines.
+ */
+
+#ifndef _edgeFileParser_h
+#define _edgeFileParser_h
+
+/* Including standard libraries */
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+using namespace std;
+
+/*
+ * Struct : EdgeFile
+ * -------------------------------------------------------------------------------
+ * A mapped edge file. The views handed out by the parser are valid until the file
+ * is unmapped with unmapEdgeFile.
+ */
+
+  struct EdgeFile{
+    const char* data;
+    size_t length;
+  };
+
+/*
+ * Struct : Edge
+ * ---------------------------------------
+ * One Child:Parent line of an edge file.
+ */
+
+  struct Edge{
+    string_view child;
+    string_view parent;
+  };
+
+  //Files smaller than this are parsed by one thread whatever is asked for.
+  const size_t MIN_PARALLEL_CHUNK = 1<<20;
+
+/*
+ * Function : mapEdgeFile
+ * Usage    : if(mapEdgeFile("familytree.txt",file))
+ * ---------------------------------------------------------------------------------
+ * Maps the named file read only. Returns false if it cannot be opened or mapped.
+ */
+
+  inline bool mapEdgeFile(const string& fileName,EdgeFile& file){
+    int fd = open(fileName.c_str(),O_RDONLY);
+    if(fd<0) return false;
+    struct stat info;
+    if(fstat(fd,&info)!=0){
+      close(fd);
+      return false;
+    }
+    file.length = info.st_size;
+    file.data = NULL;
+    if(file.length>0){
+      void* address = mmap(NULL,file.length,PROT_READ,MAP_PRIVATE,fd,0);
+      if(address==MAP_FAILED){
+        close(fd);
+        return false;
+      }
+      madvise(address,file.length,MADV_SEQUENTIAL);
+      file.data = (const char*)address;
+    }
+    close(fd);
+    return true;
+  }
+
+/*
+ * Function : unmapEdgeFile
+ * -------------------------------------------------------------------
+ * Releases the mapping. Views into the file must no longer be used.
+ */
+
+  inline void unmapEdgeFile(EdgeFile& file){
+    if(file.data!=NULL)
+      munmap((void*)file.data,file.length);
+    file.data = NULL;
+    file.length = 0;
+  }
+
+/*
+ * Function : nextLine
+ * -------------------------------------------------------------------------------------
+ * Returns the line starting at begin without its line ending, and moves begin past it.
+ */
+
+  inline string_view nextLine(const char* &begin,const char* end){
+    const char* newline = (const char*)memchr(begin,'\n',end-begin);
+    const char* lineEnd = newline==NULL?end:newline;
+    string_view line(begin,lineEnd-begin);
+    begin = newline==NULL?end:newline+1;
+    if(!line.empty() && line.back()=='\r')
+      line.remove_suffix(1);
+    return line;
+  }
+
+/*
+ * Function : rootName
+ * -----------------------------------------------------
+ * Returns the first line of the file, the root's name.
+ */
+
+  inline string_view rootName(const EdgeFile& file){
+    const char* begin = file.data;
+    return file.length==0?string_view():nextLine(begin,file.data+file.length);
+  }
+
+/*
+ * Function : parseEdges
+ * -------------------------------------------------------------------------------------
+ * Appends the edges found in the lines between begin and end to edges. Lines without a
+ * colon, such as blank lines, are skipped. begin must be at the start of a line.
+ */
+
+  inline void parseEdges(const char* begin,const char* end,vector<Edge>& edges){
+    while(begin<end){
+      string_view line = nextLine(begin,end);
+      const char* colon = (const char*)memchr(line.data(),':',line.size());
+      if(colon==NULL) continue;
+      Edge edge;
+      edge.child = string_view(line.data(),colon-line.data());
+      edge.parent = string_view(colon+1,line.data()+line.size()-colon-1);
+      edges.push_back(edge);
+    }
+  }
+
+/*
+ * Function : parseEdgeFile
+ * Usage    : parseEdgeFile(file,edges,thread::hardware_concurrency());
+ * -----------------------------------------------------------------------------------------
+ * Fills edges with every edge of the file in file order. The lines after the root's line
+ * are cut into nThreads chunks, each moved forward to the start of a line, and parsed in
+ * parallel into separate vectors which are then joined.
+ */
+
+  inline void parseEdgeFile(const EdgeFile& file,vector<Edge>& edges,int nThreads){
+    edges.clear();
+    if(file.length==0) return;
+    const char* begin = file.data;
+    const char* end = file.data+file.length;
+    nextLine(begin,end);//Skips the root's line.
+
+    size_t remaining = end-begin;
+    if(nThreads<1) nThreads = 1;
+    if(remaining/nThreads<MIN_PARALLEL_CHUNK) nThreads = remaining/MIN_PARALLEL_CHUNK+1;
+    if(nThreads==1){
+      parseEdges(begin,end,edges);
+      return;
+    }
+
+    vector<const char*> starts(nThreads+1);
+    starts[0] = begin;
+    starts[nThreads] = end;
+    for(int i=1;i<nThreads;i++){
+      const char* start = begin+remaining/nThreads*i;
+      if(start<starts[i-1]) start = starts[i-1];
+      const char* newline = (const char*)memchr(start,'\n',end-start);
+      starts[i] = newline==NULL?end:newline+1;
+    }
+
+    vector<vector<Edge> > chunks(nThreads);
+    vector<thread> workers;
+    for(int i=0;i<nThreads;i++)
+      workers.push_back(thread(parseEdges,starts[i],starts[i+1],ref(chunks[i])));
+    size_t total = 0;
+    for(int i=0;i<nThreads;i++){
+      workers[i].join();
+      total += chunks[i].size();
+    }
+    edges.reserve(total);
+    for(int i=0;i<nThreads;i++)
+      edges.insert(edges.end(),chunks[i].begin(),chunks[i].end());
+  }
+
+#endif
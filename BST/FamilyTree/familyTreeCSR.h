@@ -0,0 +1,316 @@
+/*
+ * File : familyTreeCSR.h
+ * ------------------------------------------------------------------------------------------
+ * This file exports a frozen, compact representation of a family tree in compressed sparse
+ * row form : every person is a number and the tree is held in a few flat arrays instead of
+ * one heap node per person. It can be built from either the vector or the linked list
+ * representation of treeRepresentation(Vector).cpp and treeRepresentation(LinkedList).cpp.
+ * The tree cannot be changed once built.
+ */
+
+#ifndef _familyTreeCSR_h
+#define _familyTreeCSR_h
+
+/* Including standard libraries */
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../TreeExport.h"
+using namespace std;
+
+class FamilyTreeCSR{
+
+  /* The public interface for the FamilyTreeCSR class */
+
+  public :
+
+  /*
+   * Methods : buildFromVectorTree,buildFromLinkedTree
+   * Usage   : csr.buildFromVectorTree(root);
+   * -----------------------------------------------------------------------------------------
+   * Replace the contents of the CSR tree with the tree rooted at root. buildFromVectorTree
+   * takes nodes with name and children fields, buildFromLinkedTree nodes with name, firstChild
+   * and nextSibling fields. Both take O(N) time and no recursion.
+   */
+
+    template<typename NodeType> void buildFromVectorTree(const NodeType *root);
+    template<typename NodeType> void buildFromLinkedTree(const NodeType *root);
+
+  /*
+   * Methods : size,getName,getParent,childCount,getChild
+   * Usage   : for(int i=0;i<csr.childCount(p);i++) csr.getChild(p,i);
+   * -----------------------------------------------------------------------------------------
+   * People are numbered 0..size()-1 in pre order, so the root is 0 and the descendants of
+   * person p are the numbers just after p. getParent returns -1 for the root. getName returns
+   * a view into the tree's name storage.
+   */
+
+    int size() const;
+    string_view getName(int person) const;
+    int getParent(int person) const;
+    int childCount(int person) const;
+    int getChild(int person,int index) const;
+
+  /*
+   * Methods : displayFamilyTree,renderIndented
+   * Usage   : csr.displayFamilyTree();
+   * ---------------------------------------------------------------------------------------
+   * Draw the tree in pre order with two spaces per generation, like displayFamilyTree does
+   * for the pointer representations. As people are numbered in pre order this is one pass
+   * over the arrays. displayFamilyTree writes to standard output, renderIndented to out.
+   */
+
+    void displayFamilyTree() const;
+    void renderIndented(OutputBuffer &out) const;
+
+  /*
+   * Methods : renderJSON,renderDOT
+   * Usage   : csr.renderJSON(out);
+   * ---------------------------------------------------------------------------------------
+   * Write the tree as nested {"name":...,"children":[...]} objects, or as a Graphviz digraph
+   * whose nodes are the people's numbers labelled with their names.
+   */
+
+    void renderJSON(OutputBuffer &out) const;
+    void renderDOT(OutputBuffer &out) const;
+
+  /*
+   * Method : breadthFirstOrder
+   * Usage  : csr.breadthFirstOrder(order);
+   * ---------------------------------------------------------------------------------------
+   * Stores the people in order a generation at a time. The result vector doubles as the
+   * queue, so no other memory is used.
+   */
+
+    void breadthFirstOrder(vector<int> &order) const;
+
+  /*
+   * Method : memoryUsage
+   * Usage  : size_t bytes = csr.memoryUsage();
+   * -------------------------------------------------------------------
+   * Returns the number of bytes held by the arrays, names included.
+   */
+
+    size_t memoryUsage() const;
+
+  private :
+
+  /*
+   * Representational Notes :
+   * ----------------------------------------------------------------------------------------
+   * parents[p]      : number of the parent of p, -1 for the root.
+   * childStart[p]   : the children of p are childIndex[childStart[p]..childStart[p+1]-1],
+   *                   in the order of the original tree.
+   * childIndex      : all child numbers, grouped by parent.
+   * nameStart[p]    : the name of p is names[nameStart[p]..nameStart[p+1]-1].
+   * So a person costs 12 bytes for the structure plus 4 bytes and the characters of its name.
+   */
+
+    vector<int> parents;
+    vector<int> childStart;
+    vector<int> childIndex;
+    vector<int> nameStart;
+    string names;
+
+  /* Private methods */
+    void clear();
+    void addPerson(const string &name,int parent);
+    void linkChildren();
+};
+
+/*
+ * Implementation Notes : buildFromVectorTree,buildFromLinkedTree
+ * ------------------------------------------------------------------------------------------
+ * Walk the tree in pre order with an explicit stack of (node, parent number) pairs, pushing
+ * children in reverse so that they come off the stack in their original order. Each person
+ * is numbered as it comes off the stack. The children arrays are filled afterwards from the
+ * parent array by linkChildren.
+ */
+
+  template<typename NodeType>
+  void FamilyTreeCSR::buildFromVectorTree(const NodeType *root){
+    clear();
+    if(root==NULL) return;
+    vector<pair<const NodeType *,int> > stack;
+    stack.push_back(make_pair(root,-1));
+    while(!stack.empty()){
+      const NodeType *node = stack.back().first;
+      int parent = stack.back().second;
+      stack.pop_back();
+      int person = size();
+      addPerson(node->name,parent);
+      for(int i=(int)node->children.size()-1;i>=0;i--)
+        stack.push_back(make_pair((const NodeType *)node->children[i],person));
+    }
+    linkChildren();
+  }
+
+  template<typename NodeType>
+  void FamilyTreeCSR::buildFromLinkedTree(const NodeType *root){
+    clear();
+    if(root==NULL) return;
+    vector<pair<const NodeType *,int> > stack;
+    vector<const NodeType *> siblings;
+    stack.push_back(make_pair(root,-1));
+    while(!stack.empty()){
+      const NodeType *node = stack.back().first;
+      int parent = stack.back().second;
+      stack.pop_back();
+      int person = size();
+      addPerson(node->name,parent);
+      siblings.clear();
+      for(const NodeType *child = node->firstChild;child!=NULL;child = child->nextSibling)
+        siblings.push_back(child);
+      for(int i=(int)siblings.size()-1;i>=0;i--)
+        stack.push_back(make_pair(siblings[i],person));
+    }
+    linkChildren();
+  }
+
+/*
+ * Implementation Notes : accessors
+ * ------------------------------------------------
+ * All run in constant time on the flat arrays.
+ */
+
+  inline int FamilyTreeCSR::size() const{
+    return parents.size();
+  }
+
+  inline string_view FamilyTreeCSR::getName(int person) const{
+    return string_view(names.data()+nameStart[person],nameStart[person+1]-nameStart[person]);
+  }
+
+  inline int FamilyTreeCSR::getParent(int person) const{
+    return parents[person];
+  }
+
+  inline int FamilyTreeCSR::childCount(int person) const{
+    return childStart[person+1]-childStart[person];
+  }
+
+  inline int FamilyTreeCSR::getChild(int person,int index) const{
+    return childIndex[childStart[person]+index];
+  }
+
+/*
+ * Implementation Notes : displayFamilyTree
+ * -----------------------------------------------------------------------------------------
+ * The depth of a person is one more than the depth of its parent, which has a smaller number
+ * and so is already known when the person is reached.
+ */
+
+  inline void FamilyTreeCSR::displayFamilyTree() const{
+    OutputBuffer &out = standardOutputBuffer();
+    renderIndented(out);
+    out.flush();
+  }
+
+  inline void FamilyTreeCSR::renderIndented(OutputBuffer &out) const{
+    vector<int> depths(size());
+    for(int person=0;person<size();person++){
+      depths[person] = parents[person]<0?0:depths[parents[person]]+1;
+      for(int i=0;i<depths[person];i++)
+        out<<"  ";
+      string_view name = getName(person);
+      out.append(name.data(),name.size());
+      out<<'\n';
+    }
+  }
+
+/*
+ * Implementation Notes : renderJSON,renderDOT
+ * -----------------------------------------------------------------------------------------
+ * renderJSON keeps, for every person whose object is still open, the number of children not
+ * yet closed. A person is closed once that count drops to zero, which in turn closes one
+ * child of its parent. A comma goes before every child but the first.
+ */
+
+  inline void FamilyTreeCSR::renderJSON(OutputBuffer &out) const{
+    vector<int> remaining;
+    for(int person=0;person<size();person++){
+      if(person>0 && remaining.back()<childCount(parents[person]))
+        out<<',';
+      string_view name = getName(person);
+      out<<"{\"name\":";
+      writeJSONString(out,name.data(),name.size());
+      out<<",\"children\":[";
+      remaining.push_back(childCount(person));
+      while(!remaining.empty() && remaining.back()==0){
+        out<<"]}";
+        remaining.pop_back();
+        if(!remaining.empty()) remaining.back()--;
+      }
+    }
+    out<<'\n';
+  }
+
+  inline void FamilyTreeCSR::renderDOT(OutputBuffer &out) const{
+    out<<"digraph FamilyTree {\n";
+    for(int person=0;person<size();person++){
+      string_view name = getName(person);
+      out<<"  "<<person<<" [label=";
+      writeDOTString(out,name.data(),name.size());
+      out<<"];\n";
+      if(parents[person]>=0)
+        out<<"  "<<parents[person]<<" -> "<<person<<";\n";
+    }
+    out<<"}\n";
+  }
+
+  inline void FamilyTreeCSR::breadthFirstOrder(vector<int> &order) const{
+    order.clear();
+    if(size()==0) return;
+    order.reserve(size());
+    order.push_back(0);
+    for(size_t head=0;head<order.size();head++){
+      int person = order[head];
+      order.insert(order.end(),childIndex.begin()+childStart[person],childIndex.begin()+childStart[person+1]);
+    }
+  }
+
+  inline size_t FamilyTreeCSR::memoryUsage() const{
+    return (parents.capacity()+childStart.capacity()+childIndex.capacity()+nameStart.capacity())*sizeof(int)
+           + names.capacity();
+  }
+
+/*
+ * Implementation Notes : private methods
+ * -------------------------------------------------------------------------------------------
+ * addPerson appends a person's parent and name. linkChildren groups the people by parent with
+ * a counting sort; since people are visited in increasing number, each parent's children keep
+ * the order in which the walk numbered them, which is their original order.
+ */
+
+  inline void FamilyTreeCSR::clear(){
+    parents.clear();
+    childStart.clear();
+    childIndex.clear();
+    nameStart.assign(1,0);
+    names.clear();
+  }
+
+  inline void FamilyTreeCSR::addPerson(const string &name,int parent){
+    parents.push_back(parent);
+    names.append(name);
+    nameStart.push_back(names.size());
+  }
+
+  inline void FamilyTreeCSR::linkChildren(){
+    int n = size();
+    childStart.assign(n+1,0);
+    for(int person=1;person<n;person++)
+      childStart[parents[person]+1]++;
+    for(int person=0;person<n;person++)
+      childStart[person+1] += childStart[person];
+    childIndex.resize(n>0?n-1:0);
+    vector<int> fill(childStart.begin(),childStart.end()-1);
+    for(int person=1;person<n;person++)
+      childIndex[fill[parents[person]]++] = person;
+    parents.shrink_to_fit();
+    nameStart.shrink_to_fit();
+    names.shrink_to_fit();
+  }
+
+#endif
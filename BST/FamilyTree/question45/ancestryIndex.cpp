@@ -0,0 +1,213 @@
+/*
+ * File : ancestryIndex.cpp
+ * --------------------------------------------------------------------------------
+ * Implementation of the AncestryIndex class, using gapped pre and post order labels.
+ */
+
+/* Including standard libraries */
+#include "ancestryIndex.h"
+
+/* Implementation of class AncestryIndex */
+
+  /*
+   * Constructor : AncestryIndex
+   * --------------------------------------------------------------------------
+   * Starts from the two sentinels, links the tokens of the whole tree between
+   * them, then spreads the labels evenly over the label space.
+   */
+
+   AncestryIndex::AncestryIndex(FamilyTreeNode *root){
+     Token head = {0,-1,TAIL};
+     Token tail = {LABEL_SPACE,HEAD,-1};
+     tokens.push_back(head);
+     tokens.push_back(tail);
+     if(root==NULL) return;
+     linkSubtree(root,HEAD);
+     relabel(HEAD,TAIL,tokens.size()-2);
+   }
+
+  /*
+   * Method : isAncestor
+   * ------------------------------------------------------------
+   * Compares the labels of both people, as SubtreeInterval does.
+   */
+
+   bool AncestryIndex::isAncestor(FamilyTreeNode *elder,FamilyTreeNode *younger) const{
+     return getInterval(elder).contains(getInterval(younger));
+   }
+
+  /*
+   * Method : getInterval
+   * --------------------------------------------------------------
+   * Reads the labels of the two tokens of node.
+   */
+
+   SubtreeInterval AncestryIndex::getInterval(FamilyTreeNode *node) const{
+     SubtreeInterval interval = {0,0};
+     int id = ids.get(node)-1;
+     if(id<0) return interval;
+     interval.pre = tokens[2*id+2].label;
+     interval.post = tokens[2*id+3].label;
+     return interval;
+   }
+
+  /*
+   * Method : addChild
+   * -----------------------------------------------------------------------------------------
+   * The new tokens go just before the parent's closing token, which puts the child last
+   * among its siblings, as FamilyTreeNode::addChild does. Everything that can fail, the
+   * people of the subtree and the room for their labels, is checked before the first token
+   * is linked, so an error leaves the index unchanged.
+   */
+
+   void AncestryIndex::addChild(FamilyTreeNode *parent,FamilyTreeNode *child){
+     int parentId = ids.get(parent)-1;
+     if(parentId<0) throw "Error : Parent is not in the ancestry index";
+     int people = checkSubtree(child);
+     int before = 2*parentId+3;
+     int after = tokens[before].prev;
+     int left, right, total;
+     findRelabelRange(after,before,2*people,left,right,total);
+     linkSubtree(child,after);
+     relabel(left,right,total);
+     parent->addChild(child);
+   }
+
+  /*
+   * Private method : checkSubtree
+   * -----------------------------------------------------------------------------------------
+   * Returns the number of people in the subtree of root, walking it with an explicit stack.
+   * Throws an error if one of them is already in the index, or is reached twice, which would
+   * mean the subtree has a cycle.
+   */
+
+   int AncestryIndex::checkSubtree(FamilyTreeNode *root) const{
+     HashMap<FamilyTreeNode *,bool> seen;
+     vector<FamilyTreeNode *> stack;
+     stack.push_back(root);
+     int people = 0;
+     while(!stack.empty()){
+       FamilyTreeNode *node = stack.back();
+       stack.pop_back();
+       if(ids.containsKey(node)) throw "Error : Child is already in the ancestry index";
+       if(seen.containsKey(node)) throw "Error : Person appears twice in the family tree";
+       seen.put(node,true);
+       people++;
+       const vector<FamilyTreeNode *> &children = node->getChildren();
+       for(size_t i=0;i<children.size();i++)
+         stack.push_back(children[i]);
+     }
+     return people;
+   }
+
+  /*
+   * Private method : linkSubtree
+   * -----------------------------------------------------------------------------------------
+   * Walks the subtree of root with an explicit stack of (node, next child to visit) pairs,
+   * linking each token after the previous one, starting after the token after. Labels are
+   * left for the caller to set.
+   */
+
+   void AncestryIndex::linkSubtree(FamilyTreeNode *root,int after){
+     vector<pair<int,int> > stack;
+     int id = newPerson(root);
+     linkAfter(2*id+2,after);
+     after = 2*id+2;
+     stack.push_back(make_pair(id,0));
+     while(!stack.empty()){
+       id = stack.back().first;
+       int nextChild = stack.back().second;
+       const vector<FamilyTreeNode *> &children = nodes[id]->getChildren();
+       if(nextChild<(int)children.size()){
+         stack.back().second++;
+         int childId = newPerson(children[nextChild]);
+         linkAfter(2*childId+2,after);
+         after = 2*childId+2;
+         stack.push_back(make_pair(childId,0));
+       }else{
+         linkAfter(2*id+3,after);
+         after = 2*id+3;
+         stack.pop_back();
+       }
+     }
+   }
+
+  /*
+   * Private method : newPerson
+   * --------------------------------------------------------------------
+   * Numbers node and makes room for its two tokens. Throws an error if it
+   * is already numbered, which would mean the tree has a cycle.
+   */
+
+   int AncestryIndex::newPerson(FamilyTreeNode *node){
+     if(ids.containsKey(node)) throw "Error : Person appears twice in the family tree";
+     int id = nodes.size();
+     nodes.push_back(node);
+     ids.put(node,id+1);
+     tokens.resize(tokens.size()+2);
+     return id;
+   }
+
+  /*
+   * Private method : linkAfter
+   * ---------------------------------------------------
+   * Inserts token into the list right after token after.
+   */
+
+   void AncestryIndex::linkAfter(int token,int after){
+     int before = tokens[after].next;
+     tokens[token].prev = after;
+     tokens[token].next = before;
+     tokens[after].next = token;
+     tokens[before].prev = token;
+   }
+
+  /*
+   * Private method : findRelabelRange
+   * -----------------------------------------------------------------------------------------
+   * Finds the tokens left and right to relabel around count new tokens that are to go
+   * between after and before, and the total number of tokens that will lie between them.
+   * The range is widened, by twice as many tokens on each side every time, until its labels
+   * are at least as many apart on average as it holds tokens, which leaves room for later
+   * insertions nearby. If the range reaches both sentinels, all tokens are relabelled. Throws
+   * an error if even then there are too few labels. Changes nothing, so it can run before the
+   * new tokens are linked.
+   */
+
+   void AncestryIndex::findRelabelRange(int after,int before,int count,int &left,int &right,int &total) const{
+     left = after;
+     right = before;
+     int step = 1;
+     while(left!=HEAD || right!=TAIL){
+       long long gap = (tokens[right].label-tokens[left].label)/(count+1);
+       if(gap>count) break;
+       for(int i=0;i<step && left!=HEAD;i++){
+         left = tokens[left].prev;
+         count++;
+       }
+       for(int i=0;i<step && right!=TAIL;i++){
+         right = tokens[right].next;
+         count++;
+       }
+       step *= 2;
+     }
+     if((tokens[right].label-tokens[left].label)/(count+1)<1) throw "Error : Ancestry index is out of labels";
+     total = count;
+   }
+
+  /*
+   * Private method : relabel
+   * -------------------------------------------------------------------------------------
+   * Spreads the labels of the count tokens between left and right evenly over the labels
+   * between left's and right's. Throws an error if there are too few labels left.
+   */
+
+   void AncestryIndex::relabel(int left,int right,int count){
+     long long gap = (tokens[right].label-tokens[left].label)/(count+1);
+     if(gap<1) throw "Error : Ancestry index is out of labels";
+     long long label = tokens[left].label;
+     for(int token=tokens[left].next;token!=right;token=tokens[token].next){
+       label += gap;
+       tokens[token].label = label;
+     }
+   }
@@ -0,0 +1,132 @@
+/*
+ * File : ancestryIndex.h
+ * -----------------------------------------------------------------------------------------
+ * An interface to an index over a family tree that tells whether one person descends from
+ * another by comparing two pairs of integer labels, and that stays up to date as children
+ * are added through it.
+ */
+
+#ifndef _ancestryindex_h
+#define _ancestryindex_h
+
+/* Including standard libraries */
+#include <vector>
+#include "familyTree.h"
+#include "../../../HashMap/HashMap.h"
+using namespace std;
+
+/*
+ * Struct : SubtreeInterval
+ * -----------------------------------------------------------------------------------------
+ * The labels given to a person when the walk over the tree enters (pre) and leaves (post)
+ * them. A person descends from another exactly when its interval lies inside the other's.
+ * Intervals of people not in the index are {0,0} and contain nothing.
+ */
+
+  struct SubtreeInterval{
+    long long pre;
+    long long post;
+    bool contains(const SubtreeInterval &other) const {
+      return pre<other.pre && other.post<post;
+    }
+  };
+
+/*
+ * Class : AncestryIndex
+ * -----------------------------------------------------------------------------------------
+ * Ancestry index over the tree rooted at the node it is built from. Children added with
+ * the index's addChild are labelled as they are added. Children added directly to the nodes
+ * are not known to the index.
+ */
+
+class AncestryIndex{
+
+  public :
+
+  /*
+   * Constructor : AncestryIndex
+   * Usage       : AncestryIndex index(root);
+   * --------------------------------------------------------------------
+   * Labels every person of the tree rooted at root. Takes O(N) time.
+   */
+
+   AncestryIndex(FamilyTreeNode *root);
+
+  /*
+   * Method : isAncestor
+   * Usage  : if(index.isAncestor(elder,younger)) ...
+   * ----------------------------------------------------------------------------------------
+   * Returns true if younger descends from elder, false otherwise, including when they are
+   * the same person or either is not in the index. Takes two hash lookups and two
+   * comparisons.
+   */
+
+   bool isAncestor(FamilyTreeNode *elder,FamilyTreeNode *younger) const;
+
+  /*
+   * Method : getInterval
+   * Usage  : SubtreeInterval interval = index.getInterval(node);
+   * -----------------------------------------------------------------------------------------
+   * Returns the labels of node, for callers that check many pairs against the same people.
+   * Labels may change on the next addChild, so intervals must be fetched again after it.
+   */
+
+   SubtreeInterval getInterval(FamilyTreeNode *node) const;
+
+  /*
+   * Method : addChild
+   * Usage  : index.addChild(parent,child);
+   * ----------------------------------------------------------------------------------------
+   * Adds child as the last child of parent, like FamilyTreeNode::addChild, and labels child
+   * and any children it already has. Only labels close to the new ones are ever changed.
+   * Throws an error, leaving the index as it was, if parent is not in the index, if anyone in
+   * the subtree of child already is or appears twice in it, or if the labels run out.
+   */
+
+   void addChild(FamilyTreeNode *parent,FamilyTreeNode *child);
+
+  private :
+
+  /*
+   * Representational Notes :
+   * -----------------------------------------------------------------------------------------
+   * The walk over the tree is kept as a doubly linked list of tokens, one when a person is
+   * entered and one when it is left, between two sentinels labelled 0 and LABEL_SPACE. The
+   * tokens of person number i are 2i+2 and 2i+3, and labels increase along the list. Labels
+   * are spread out with wide gaps, so that a new child's two tokens normally fit in the gap
+   * before its parent's closing token. When they do not, the neighbourhood of the insertion
+   * is widened, doubling each time, until it is sparse enough, and only it is relabelled.
+   * ids maps a node to its number plus one, 0 meaning absent.
+   */
+
+  /* Private types */
+    struct Token{
+      long long label;
+      int prev;
+      int next;
+    };
+
+  /* Private constants */
+    static const long long LABEL_SPACE = 1LL<<62;
+    static const int HEAD = 0;
+    static const int TAIL = 1;
+
+  /* Private instance variables */
+    vector<Token> tokens;
+    vector<FamilyTreeNode *> nodes;
+    HashMap<FamilyTreeNode *,int> ids;
+
+  /* Private methods */
+    int checkSubtree(FamilyTreeNode *root) const;
+    void linkSubtree(FamilyTreeNode *root,int after);
+    int newPerson(FamilyTreeNode *node);
+    void linkAfter(int token,int after);
+    void findRelabelRange(int after,int before,int count,int &left,int &right,int &total) const;
+    void relabel(int left,int right,int count);
+
+  /* Making copying illegal */
+    AncestryIndex(const AncestryIndex &src);
+    AncestryIndex &operator=(const AncestryIndex &src);
+};
+
+#endif
@@ -10,6 +10,10 @@
 #include <fstream>
 #include <string>
 #include "familyTree.h"
+#include "lcaIndex.h"
+#include "offlineLCA.h"
+#include "subtreeAggregate.h"
+#include "ancestryIndex.h"
 using namespace std;
 
 /* Function prototype */
@@ -45,6 +49,42 @@ int main(){
   FamilyTreeNode* commonAncestor2  = commonAncestor(hazel,shilpa);
   cout<<"Common ancestor of "<<hazel->getName()<<" and "<<shilpa->getName()<<" is ";
   cout<<commonAncestor2->getName()<<endl;
+
+  /* Answering a batch of pairs with the preprocessed index */
+  LCAIndex index(william);
+  vector<pair<FamilyTreeNode*,FamilyTreeNode*> > pairs;
+  pairs.push_back(make_pair(hazel,apoorva));
+  pairs.push_back(make_pair(hazel,shilpa));
+  pairs.push_back(make_pair(apoorva,andy));
+  pairs.push_back(make_pair(sangram,shilpa));
+  vector<FamilyTreeNode*> ancestors;
+  index.commonAncestors(pairs,ancestors);
+  for(size_t i=0;i<pairs.size();i++){
+    cout<<"Indexed common ancestor of "<<pairs[i].first->getName()<<" and "<<pairs[i].second->getName();
+    cout<<" is "<<ancestors[i]->getName()<<endl;
+  }
+
+  /* Answering the same batch offline with one walk over the tree */
+  commonAncestorsOffline(william,pairs,ancestors);
+  for(size_t i=0;i<pairs.size();i++){
+    cout<<"Offline common ancestor of "<<pairs[i].first->getName()<<" and "<<pairs[i].second->getName();
+    cout<<" is "<<ancestors[i]->getName()<<endl;
+  }
+
+  /* Computing subtree aggregates in parallel */
+  SubtreeAggregate<DescendantCount> descendants(william,thread::hardware_concurrency());
+  SubtreeAggregate<SubtreeHeight> heights(william,thread::hardware_concurrency());
+  for(int i=0;i<descendants.size();i++){
+    cout<<descendants.getNode(i)->getName()<<" has "<<descendants.getValue(i)<<" descendants over ";
+    cout<<heights.get(descendants.getNode(i))<<" generations"<<endl;
+  }
+
+  /* Checking descent with interval labels, before and after adding a child */
+  AncestryIndex ancestry(william);
+  FamilyTreeNode* maya = new FamilyTreeNode("Maya");
+  ancestry.addChild(apoorva,maya);
+  cout<<"Andy is an ancestor of Maya : "<<(ancestry.isAncestor(andy,maya)?"yes":"no")<<endl;
+  cout<<"Elie is an ancestor of Maya : "<<(ancestry.isAncestor(elie,maya)?"yes":"no")<<endl;
   
   return 0;
 }
@@ -56,7 +96,8 @@ int main(){
  * Assumes that parameters passed are valid pointers to nodes in the tree.
  * If there is a line of descent from p1 to p2 or p2 to p1, returns the pointer
  * to the elder amongst the two.
- * If p1==p2, returns NULL.
+ * If p1==p2, or the nodes are in different trees, returns NULL.
+ * Takes O(depth^2) time; LCAIndex answers in O(1) after preprocessing the tree.
  */
 
   FamilyTreeNode* commonAncestor(FamilyTreeNode* p1,FamilyTreeNode* p2){
@@ -75,5 +116,6 @@ int main(){
           return curParentp2;
       curParentp2 = curParentp2->getParent();
     }
+    return NULL;
   }
 
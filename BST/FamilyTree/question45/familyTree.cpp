@@ -38,7 +38,7 @@
      return parent;
    }
 
-   vector<FamilyTreeNode *> FamilyTreeNode::getChildren() const{
+   const vector<FamilyTreeNode *>& FamilyTreeNode::getChildren() const{
      return children;
    }
 
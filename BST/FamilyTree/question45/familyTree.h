@@ -36,12 +36,13 @@ class FamilyTreeNode{
    * Returns the specified information about the current node.
    * getName : Returns the name(String)
    * getParent : Returns the pointer to the parent(FamilyTreeNode)
-   * getChildren : Returns a vector of children(Vector of FamilyTreeNode pointers)
+   * getChildren : Returns a vector of children(Vector of FamilyTreeNode pointers). The reference
+   *               stays valid as long as the node does, so walks over the tree copy nothing.
    */
 
    string getName() const;  
    FamilyTreeNode *getParent() const;
-   vector<FamilyTreeNode *> getChildren() const;
+   const vector<FamilyTreeNode *>& getChildren() const;
 
   /*
    * Setter Method : addChild
@@ -0,0 +1,126 @@
+/*
+ * File : lcaIndex.cpp
+ * ----------------------------------------------------------------------------
+ * Implementation of the LCAIndex class, using an Euler tour and a sparse table.
+ */
+
+/* Including standard libraries */
+#include "lcaIndex.h"
+
+/* Implementation of class LCAIndex */
+
+  /*
+   * Constructor : LCAIndex
+   * ---------------------------------------------------------------
+   * Records the Euler tour of the tree, then builds the sparse table.
+   */
+
+   LCAIndex::LCAIndex(FamilyTreeNode *root){
+     if(root==NULL) return;
+     buildTour(root);
+     buildSparseTable();
+   }
+
+  /*
+   * Private method : buildTour
+   * ---------------------------------------------------------------------------------------
+   * Walks the tree depth first with an explicit stack of (node, next child to visit) pairs,
+   * so that deep genealogies cannot overflow the call stack. A node is recorded when it is
+   * first reached and again after each of its children is done.
+   */
+
+   void LCAIndex::buildTour(FamilyTreeNode *root){
+     vector<pair<FamilyTreeNode *,int> > stack;
+     stack.push_back(make_pair(root,0));
+     firstVisit.put(root,1);
+     tourNodes.push_back(root);
+     tourDepths.push_back(0);
+     while(!stack.empty()){
+       FamilyTreeNode *node = stack.back().first;
+       int nextChild = stack.back().second;
+       const vector<FamilyTreeNode *> &children = node->getChildren();
+       if(nextChild<(int)children.size()){
+         stack.back().second++;
+         FamilyTreeNode *child = children[nextChild];
+         stack.push_back(make_pair(child,0));
+         firstVisit.put(child,tourNodes.size()+1);
+         tourNodes.push_back(child);
+         tourDepths.push_back(stack.size()-1);
+       }else{
+         stack.pop_back();
+         if(!stack.empty()){
+           tourNodes.push_back(stack.back().first);
+           tourDepths.push_back(stack.size()-1);
+         }
+       }
+     }
+   }
+
+  /*
+   * Private method : buildSparseTable
+   * -----------------------------------------------------------------------------------
+   * Level 0 is every position itself. Level k combines two halves from level k-1.
+   */
+
+   void LCAIndex::buildSparseTable(){
+     int n = tourNodes.size();
+     floorLog2.assign(n+1,0);
+     for(int i=2;i<=n;i++)
+       floorLog2[i] = floorLog2[i/2]+1;
+     sparseTable.resize(floorLog2[n]+1);
+     sparseTable[0].resize(n);
+     for(int i=0;i<n;i++)
+       sparseTable[0][i] = i;
+     for(int k=1;k<(int)sparseTable.size();k++){
+       int half = 1<<(k-1);
+       int count = n-(1<<k)+1;
+       sparseTable[k].resize(count);
+       for(int i=0;i<count;i++)
+         sparseTable[k][i] = shallower(sparseTable[k-1][i],sparseTable[k-1][i+half]);
+     }
+   }
+
+  /*
+   * Private method : shallower
+   * --------------------------------------------------------------
+   * Returns whichever of two tour positions has the smaller depth.
+   */
+
+   int LCAIndex::shallower(int i,int j) const{
+     return tourDepths[i]<=tourDepths[j]?i:j;
+   }
+
+  /*
+   * Method : commonAncestor
+   * -----------------------------------------------------------------------------------------
+   * Looks up the first visits of both nodes and returns the shallowest node of the tour in
+   * between, found as the shallower of the two table entries that cover the range.
+   */
+
+   FamilyTreeNode *LCAIndex::commonAncestor(FamilyTreeNode *p1,FamilyTreeNode *p2) const{
+     if(p1==p2) return NULL;
+     int first = firstVisit.get(p1)-1;
+     int second = firstVisit.get(p2)-1;
+     if(first<0 || second<0) return NULL;
+     if(first>second){
+       int temp = first;
+       first = second;
+       second = temp;
+     }
+     int k = floorLog2[second-first+1];
+     int position = shallower(sparseTable[k][first],sparseTable[k][second-(1<<k)+1]);
+     return tourNodes[position];
+   }
+
+  /*
+   * Method : commonAncestors
+   * -------------------------------------------------------------
+   * Answers each pair in turn. Takes O(1) time per pair.
+   */
+
+   void LCAIndex::commonAncestors(const vector<pair<FamilyTreeNode *,FamilyTreeNode *> > &pairs,
+                                  vector<FamilyTreeNode *> &results) const{
+     results.resize(pairs.size());
+     for(size_t i=0;i<pairs.size();i++)
+       results[i] = commonAncestor(pairs[i].first,pairs[i].second);
+   }
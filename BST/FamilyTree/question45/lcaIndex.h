@@ -0,0 +1,90 @@
+/*
+ * File : lcaIndex.h
+ * -----------------------------------------------------------------------------------
+ * An interface to an index over a family tree that answers common ancestor queries in
+ * constant time after O(N log N) preprocessing.
+ */
+
+#ifndef _lcaindex_h
+#define _lcaindex_h
+
+/* Including standard libraries */
+#include <vector>
+#include <utility>
+#include "familyTree.h"
+#include "../../../HashMap/HashMap.h"
+using namespace std;
+
+/*
+ * Class : LCAIndex
+ * -----------------------------------------------------------------------------------
+ * Lowest common ancestor index over the tree rooted at the node it is built from. The
+ * index describes the tree as it was when built; nodes added later are not known to it.
+ */
+
+class LCAIndex{
+
+  public :
+
+  /*
+   * Constructor : LCAIndex
+   * Usage       : LCAIndex index(root);
+   * ---------------------------------------------------------------------
+   * Builds the index for the tree rooted at root. Takes O(N log N) time.
+   */
+
+   LCAIndex(FamilyTreeNode *root);
+
+  /*
+   * Method : commonAncestor
+   * Usage  : FamilyTreeNode *ancestor = index.commonAncestor(p1,p2);
+   * -----------------------------------------------------------------------------------------
+   * Returns the common ancestor of p1 and p2 that is furthest from the root, with the same
+   * conventions as the commonAncestor function : if there is a line of descent from p1 to p2
+   * or p2 to p1, returns the elder of the two, and if p1==p2, returns NULL. Also returns NULL
+   * if either node is not in the tree. Takes O(1) time.
+   */
+
+   FamilyTreeNode *commonAncestor(FamilyTreeNode *p1,FamilyTreeNode *p2) const;
+
+  /*
+   * Method : commonAncestors
+   * Usage  : index.commonAncestors(pairs,results);
+   * -----------------------------------------------------------------------------
+   * Answers commonAncestor for every pair, storing the answers in results in order.
+   */
+
+   void commonAncestors(const vector<pair<FamilyTreeNode *,FamilyTreeNode *> > &pairs,
+                        vector<FamilyTreeNode *> &results) const;
+
+  private :
+
+  /*
+   * Representational Notes :
+   * -----------------------------------------------------------------------------------------
+   * The tree is walked depth first and every node is recorded each time the walk is at it,
+   * giving an Euler tour of 2N-1 entries. The common ancestor of two nodes is the shallowest
+   * node of the tour between their first visits. sparseTable[k][i] holds the position of the
+   * shallowest entry among the 2^k entries starting at i, so any range is covered by two
+   * overlapping entries of one level. firstVisit maps a node to its first position plus one,
+   * so that 0, which get returns for missing keys, means the node is not in the tree.
+   */
+
+  /* Private instance variables */
+    vector<FamilyTreeNode *> tourNodes;
+    vector<int> tourDepths;
+    vector<vector<int> > sparseTable;
+    vector<int> floorLog2;
+    HashMap<FamilyTreeNode *,int> firstVisit;
+
+  /* Private methods */
+    void buildTour(FamilyTreeNode *root);
+    void buildSparseTable();
+    int shallower(int i,int j) const;
+
+  /* Making copying illegal */
+    LCAIndex(const LCAIndex &src);
+    LCAIndex &operator=(const LCAIndex &src);
+};
+
+#endif
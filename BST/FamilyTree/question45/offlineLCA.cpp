@@ -0,0 +1,136 @@
+/*
+ * File : offlineLCA.cpp
+ * ------------------------------------------------------------------------------------
+ * Implementation of Tarjan's offline common ancestor algorithm over FamilyTreeNodes.
+ */
+
+/* Including standard libraries */
+#include "offlineLCA.h"
+#include "../../../HashMap/HashMap.h"
+
+/* Private function prototypes */
+  static int findSet(vector<int> &setParent,int node);
+
+/*
+ * Implementation Notes : commonAncestorsOffline
+ * -----------------------------------------------------------------------------------------
+ * Nodes are first numbered in pre order, and the queries are bucketed by node into one flat
+ * array (counting sort), so that each node can list the queries it takes part in.
+ * The tree is then walked depth first. When the walk leaves a child, the child's set is
+ * merged into its parent's set, and the parent is recorded as the ancestor of the merged
+ * set. Once a node is finished, every finished node w is in the set of the deepest ancestor
+ * of w that is still on the walk's path, and that ancestor is the common ancestor of the
+ * node and w. So a query is answered when the walk finishes the second of its two nodes.
+ */
+
+  void commonAncestorsOffline(FamilyTreeNode *root,
+                              const vector<pair<FamilyTreeNode *,FamilyTreeNode *> > &pairs,
+                              vector<FamilyTreeNode *> &results){
+    results.assign(pairs.size(),NULL);
+    if(root==NULL) return;
+
+    //Numbering the nodes in pre order. numbers holds the number plus one, 0 meaning absent.
+    HashMap<FamilyTreeNode *,int> numbers;
+    vector<FamilyTreeNode *> nodes;
+    vector<FamilyTreeNode *> stack;
+    stack.push_back(root);
+    while(!stack.empty()){
+      FamilyTreeNode *node = stack.back();
+      stack.pop_back();
+      numbers.put(node,nodes.size()+1);
+      nodes.push_back(node);
+      const vector<FamilyTreeNode *> &children = node->getChildren();
+      for(int i=(int)children.size()-1;i>=0;i--)
+        stack.push_back(children[i]);
+    }
+    int nNodes = nodes.size();
+
+    //Bucketing the queries by node. queryStart[u]..queryStart[u+1] are the entries of node u.
+    vector<int> queryStart(nNodes+1,0);
+    vector<int> pairNumbers(pairs.size()*2);
+    for(size_t i=0;i<pairs.size();i++){
+      pairNumbers[2*i] = numbers.get(pairs[i].first)-1;
+      pairNumbers[2*i+1] = numbers.get(pairs[i].second)-1;
+      if(pairNumbers[2*i]<0 || pairNumbers[2*i+1]<0 || pairNumbers[2*i]==pairNumbers[2*i+1]) continue;
+      queryStart[pairNumbers[2*i]+1]++;
+      queryStart[pairNumbers[2*i+1]+1]++;
+    }
+    for(int u=0;u<nNodes;u++)
+      queryStart[u+1] += queryStart[u];
+    vector<int> queryOther(queryStart[nNodes]);
+    vector<int> queryIndex(queryStart[nNodes]);
+    vector<int> fill(queryStart.begin(),queryStart.end()-1);
+    for(size_t i=0;i<pairs.size();i++){
+      int a = pairNumbers[2*i];
+      int b = pairNumbers[2*i+1];
+      if(a<0 || b<0 || a==b) continue;
+      queryOther[fill[a]] = b; queryIndex[fill[a]++] = i;
+      queryOther[fill[b]] = a; queryIndex[fill[b]++] = i;
+    }
+
+    //The walk. walkStack holds (node number, next child to visit) pairs.
+    vector<int> setParent(nNodes);
+    vector<int> setRank(nNodes,0);
+    vector<int> setAncestor(nNodes);
+    vector<bool> finished(nNodes,false);
+    vector<pair<int,int> > walkStack;
+    walkStack.push_back(make_pair(0,0));
+    setParent[0] = 0;
+    setAncestor[0] = 0;
+    while(!walkStack.empty()){
+      int u = walkStack.back().first;
+      int nextChild = walkStack.back().second;
+      const vector<FamilyTreeNode *> &children = nodes[u]->getChildren();
+      if(nextChild<(int)children.size()){
+        walkStack.back().second++;
+        int v = numbers.get(children[nextChild])-1;
+        setParent[v] = v;
+        setAncestor[v] = v;
+        walkStack.push_back(make_pair(v,0));
+        continue;
+      }
+
+      //All children of u are done : answering the queries whose other node is finished.
+      finished[u] = true;
+      for(int q=queryStart[u];q<queryStart[u+1];q++){
+        int w = queryOther[q];
+        if(finished[w])
+          results[queryIndex[q]] = nodes[setAncestor[findSet(setParent,w)]];
+      }
+      walkStack.pop_back();
+
+      //Merging the set of u into the set of its parent, by rank.
+      if(!walkStack.empty()){
+        int parent = walkStack.back().first;
+        int a = findSet(setParent,parent);
+        int b = findSet(setParent,u);
+        if(setRank[a]<setRank[b]){
+          int temp = a;
+          a = b;
+          b = temp;
+        }
+        setParent[b] = a;
+        if(setRank[a]==setRank[b]) setRank[a]++;
+        setAncestor[a] = parent;
+      }
+    }
+  }
+
+/*
+ * Function : findSet
+ * ---------------------------------------------------------------------------------
+ * Returns the representative of the set of node, pointing every node on the way at
+ * it (path compression). Written as two loops rather than recursively.
+ */
+
+  static int findSet(vector<int> &setParent,int node){
+    int representative = node;
+    while(setParent[representative]!=representative)
+      representative = setParent[representative];
+    while(setParent[node]!=representative){
+      int next = setParent[node];
+      setParent[node] = representative;
+      node = next;
+    }
+    return representative;
+  }
@@ -0,0 +1,33 @@
+/*
+ * File : offlineLCA.h
+ * ------------------------------------------------------------------------------------
+ * An interface to a batch common ancestor procedure that answers a set of queries known
+ * in advance with one walk over the family tree, using Tarjan's offline algorithm.
+ */
+
+#ifndef _offlinelca_h
+#define _offlinelca_h
+
+/* Including standard libraries */
+#include <vector>
+#include <utility>
+#include "familyTree.h"
+using namespace std;
+
+/*
+ * Function : commonAncestorsOffline
+ * Usage    : commonAncestorsOffline(root,pairs,results);
+ * -----------------------------------------------------------------------------------------
+ * Stores in results[i] the common ancestor of pairs[i] in the tree rooted at root, with the
+ * same conventions as the commonAncestor function : the elder of the two if one descends
+ * from the other, and NULL if both are the same node. NULL is also stored for pairs with a
+ * node outside the tree. Takes O((N+Q) a(N)) time for N nodes and Q pairs, where a is the
+ * inverse Ackermann function, and uses a fixed number of arrays whatever Q is. The walk uses
+ * an explicit stack, so deep trees cannot overflow the call stack.
+ */
+
+  void commonAncestorsOffline(FamilyTreeNode *root,
+                              const vector<pair<FamilyTreeNode *,FamilyTreeNode *> > &pairs,
+                              vector<FamilyTreeNode *> &results);
+
+#endif
@@ -0,0 +1,289 @@
+/*
+ * File : subtreeAggregate.h
+ * -----------------------------------------------------------------------------------------
+ * An interface to a parallel engine that computes a value for every subtree of a family
+ * tree, bottom up : descendant counts, heights, or any fold supplied by the user. Being a
+ * template, the implementation is included in this file.
+ */
+
+#ifndef _subtreeaggregate_h
+#define _subtreeaggregate_h
+
+/* Including standard libraries */
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include "familyTree.h"
+#include "../../../HashMap/HashMap.h"
+using namespace std;
+
+/*
+ * Aggregators : DescendantCount,SubtreeHeight
+ * -----------------------------------------------------------------------------------------
+ * An aggregator says how to compute a subtree's value. It names its ValueType, gives the
+ * value of a node on its own with start, and merges a finished child's value into its
+ * parent's with fold. fold is called once per child, in the order of getChildren, and may
+ * run on any thread, so it must not touch shared state.
+ * DescendantCount : number of people below a node.
+ * SubtreeHeight   : number of generations below a node, 0 for a node with no children.
+ */
+
+  struct DescendantCount{
+    typedef int ValueType;
+    int start(FamilyTreeNode *) const { return 0; }
+    void fold(int &total,int child) const { total += child+1; }
+  };
+
+  struct SubtreeHeight{
+    typedef int ValueType;
+    int start(FamilyTreeNode *) const { return 0; }
+    void fold(int &height,int child) const { if(child+1>height) height = child+1; }
+  };
+
+/*
+ * Class : SubtreeAggregate
+ * ----------------------------------------------------------------------------------------
+ * The values of an aggregator for every subtree of the tree rooted at the node it is built
+ * from. Like LCAIndex, it describes the tree as it was when built.
+ */
+
+template<typename Aggregator>
+class SubtreeAggregate{
+
+  public :
+
+    typedef typename Aggregator::ValueType ValueType;
+
+  /*
+   * Constructor : SubtreeAggregate
+   * Usage       : SubtreeAggregate<DescendantCount> counts(root,thread::hardware_concurrency());
+   * -----------------------------------------------------------------------------------------
+   * Computes the value of every subtree of root with nThreads threads. The result is the
+   * same whatever nThreads is, since every node folds its children in order.
+   */
+
+    SubtreeAggregate(FamilyTreeNode *root,int nThreads,const Aggregator &aggregator = Aggregator());
+
+  /*
+   * Methods : get,size,getNode,getValue
+   * Usage   : int below = counts.get(node);
+   * ------------------------------------------------------------------------------------------
+   * get returns the value of the subtree of node, or ValueType() if node is not in the tree.
+   * The first call indexes the nodes by address, in O(N) time. getNode and getValue give the
+   * nodes and their values by pre order number, 0 to size()-1, for walks over the whole result
+   * that need no index.
+   */
+
+    ValueType get(FamilyTreeNode *node) const;
+    int size() const;
+    FamilyTreeNode *getNode(int number) const;
+    const ValueType &getValue(int number) const;
+
+  private :
+
+  /*
+   * Representational Notes :
+   * -----------------------------------------------------------------------------------------
+   * Nodes are numbered in pre order, so the subtree of node i is the numbers i to
+   * i+sizes[i]-1, its first child is i+1, and each next child follows the previous child's
+   * subtree. Each value is wrapped in a ValueCell, so that values are separate objects even
+   * when ValueType is bool, which vector would otherwise pack into shared words that threads
+   * could not write at once. numbers maps a node to its number plus one, 0 meaning absent;
+   * it is built by the first get, as walks by number do not need it.
+   */
+
+  /* Private constants */
+    static const int MIN_TASK_SIZE = 4096;
+
+  /* Private types */
+    struct ValueCell{
+      ValueType value;
+    };
+
+  /* Private instance variables */
+    Aggregator aggregator;
+    vector<FamilyTreeNode *> nodes;
+    vector<int> sizes;
+    vector<ValueCell> values;
+    mutable HashMap<FamilyTreeNode *,int> numbers;
+    mutable once_flag numbered;
+
+  /* Private methods */
+    void numberNodes(FamilyTreeNode *root);
+    void indexNodes() const;
+    void computeNode(int number);
+    void computeRange(int begin,int end);
+    void runTasks(const vector<pair<int,int> > &tasks,atomic<int> &nextTask);
+
+  /* Making copying illegal */
+    SubtreeAggregate(const SubtreeAggregate &src);
+    SubtreeAggregate &operator=(const SubtreeAggregate &src);
+};
+
+/*
+ * Implementation Notes : SubtreeAggregate
+ * -----------------------------------------------------------------------------------------
+ * The tree is cut into tasks : runs of consecutive siblings whose subtrees hold at most
+ * grain nodes together, and which are therefore a range of consecutive numbers. A subtree
+ * bigger than grain is never part of a run; its root goes to the top of the tree and its
+ * children are cut in turn. Grouping siblings keeps a very wide family from turning into
+ * one task per person. Threads take tasks from a shared counter, the biggest tasks first,
+ * so a thread that finishes early takes over work left by the others. When all tasks are
+ * done, the top is computed on the calling thread; it holds few nodes unless the tree is
+ * mostly one long line, though the folds of a top node over all its children run there.
+ */
+
+  template<typename Aggregator>
+  SubtreeAggregate<Aggregator>::SubtreeAggregate(FamilyTreeNode *root,int nThreads,const Aggregator &aggregator)
+    : aggregator(aggregator){
+    if(root==NULL) return;
+    numberNodes(root);
+    int n = nodes.size();
+    values.resize(n);
+    if(nThreads<1) nThreads = 1;
+    int grain = n/(nThreads*8);
+    if(grain<MIN_TASK_SIZE) grain = MIN_TASK_SIZE;
+
+    //Splitting the tree into tasks, each a range of numbers, and top nodes.
+    vector<pair<int,int> > tasks;
+    vector<int> top;
+    vector<int> stack;
+    if(n<=grain)
+      tasks.push_back(make_pair(0,n));
+    else
+      stack.push_back(0);
+    while(!stack.empty()){
+      int i = stack.back();
+      stack.pop_back();
+      top.push_back(i);
+      int runStart = i+1;
+      for(int child=i+1;child<i+sizes[i];child += sizes[child]){
+        if(sizes[child]>grain){
+          if(runStart<child) tasks.push_back(make_pair(runStart,child));
+          stack.push_back(child);
+          runStart = child+sizes[child];
+        }else if(child+sizes[child]-runStart>grain){
+          tasks.push_back(make_pair(runStart,child));
+          runStart = child;
+        }
+      }
+      if(runStart<i+sizes[i]) tasks.push_back(make_pair(runStart,i+sizes[i]));
+    }
+
+    //Biggest tasks first, with a counting sort on sizes so that this stays O(N).
+    vector<int> bySize(grain+2,0);
+    for(size_t t=0;t<tasks.size();t++)
+      bySize[grain-(tasks[t].second-tasks[t].first)+1]++;
+    for(int s=0;s<=grain;s++)
+      bySize[s+1] += bySize[s];
+    vector<pair<int,int> > ordered(tasks.size());
+    for(size_t t=0;t<tasks.size();t++)
+      ordered[bySize[grain-(tasks[t].second-tasks[t].first)]++] = tasks[t];
+
+    atomic<int> nextTask(0);
+    if(nThreads>(int)ordered.size()) nThreads = ordered.size();
+    vector<thread> workers;
+    for(int t=1;t<nThreads;t++)
+      workers.push_back(thread(&SubtreeAggregate::runTasks,this,cref(ordered),ref(nextTask)));
+    runTasks(ordered,nextTask);
+    for(size_t t=0;t<workers.size();t++)
+      workers[t].join();
+
+    //Top nodes were collected parents first, so going backwards meets children first.
+    for(int t=(int)top.size()-1;t>=0;t--)
+      computeNode(top[t]);
+  }
+
+  template<typename Aggregator>
+  typename SubtreeAggregate<Aggregator>::ValueType SubtreeAggregate<Aggregator>::get(FamilyTreeNode *node) const{
+    call_once(numbered,&SubtreeAggregate::indexNodes,this);
+    int number = numbers.get(node)-1;
+    if(number<0) return ValueType();
+    return values[number].value;
+  }
+
+  template<typename Aggregator>
+  int SubtreeAggregate<Aggregator>::size() const{
+    return nodes.size();
+  }
+
+  template<typename Aggregator>
+  FamilyTreeNode *SubtreeAggregate<Aggregator>::getNode(int number) const{
+    return nodes[number];
+  }
+
+  template<typename Aggregator>
+  const typename SubtreeAggregate<Aggregator>::ValueType &SubtreeAggregate<Aggregator>::getValue(int number) const{
+    return values[number].value;
+  }
+
+/*
+ * Private methods : numberNodes,indexNodes
+ * -----------------------------------------------------------------------------------------
+ * numberNodes numbers the nodes in pre order with an explicit stack, then finds every
+ * subtree size in one backward pass : a node's number is larger than its parent's, so its
+ * size is final when it is added to the parent's. indexNodes fills numbers, sized for every
+ * node up front, and is run once by get through call_once, so concurrent gets are safe.
+ */
+
+  template<typename Aggregator>
+  void SubtreeAggregate<Aggregator>::numberNodes(FamilyTreeNode *root){
+    vector<int> parents;
+    vector<pair<FamilyTreeNode *,int> > stack;
+    stack.push_back(make_pair(root,-1));
+    while(!stack.empty()){
+      FamilyTreeNode *node = stack.back().first;
+      int parent = stack.back().second;
+      stack.pop_back();
+      int number = nodes.size();
+      nodes.push_back(node);
+      parents.push_back(parent);
+      const vector<FamilyTreeNode *> &children = node->getChildren();
+      for(int i=(int)children.size()-1;i>=0;i--)
+        stack.push_back(make_pair(children[i],number));
+    }
+    sizes.assign(nodes.size(),1);
+    for(int i=(int)nodes.size()-1;i>0;i--)
+      sizes[parents[i]] += sizes[i];
+  }
+
+  template<typename Aggregator>
+  void SubtreeAggregate<Aggregator>::indexNodes() const{
+    numbers.reserve(nodes.size());
+    for(size_t i=0;i<nodes.size();i++)
+      numbers.put(nodes[i],i+1);
+  }
+
+/*
+ * Private methods : computeNode,computeRange,runTasks
+ * ------------------------------------------------------------------------------------------
+ * computeNode folds the finished values of a node's children into its own. computeRange
+ * does so for the whole subtrees numbered begin to end-1, going backwards so that children
+ * come first. runTasks is the loop of each thread.
+ */
+
+  template<typename Aggregator>
+  void SubtreeAggregate<Aggregator>::computeNode(int number){
+    ValueType value = aggregator.start(nodes[number]);
+    for(int child=number+1;child<number+sizes[number];child += sizes[child])
+      aggregator.fold(value,values[child].value);
+    values[number].value = value;
+  }
+
+  template<typename Aggregator>
+  void SubtreeAggregate<Aggregator>::computeRange(int begin,int end){
+    for(int i=end-1;i>=begin;i--)
+      computeNode(i);
+  }
+
+  template<typename Aggregator>
+  void SubtreeAggregate<Aggregator>::runTasks(const vector<pair<int,int> > &tasks,atomic<int> &nextTask){
+    while(true){
+      int task = nextTask.fetch_add(1);
+      if(task>=(int)tasks.size()) return;
+      computeRange(tasks[task].first,tasks[task].second);
+    }
+  }
+
+#endif
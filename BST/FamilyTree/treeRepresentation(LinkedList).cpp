@@ -12,6 +12,11 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <vector>
+#include "../../HashMap/HashMap.h"
+#include "edgeFileParser.h"
+#include "familyTreeCSR.h"
+#include "../TreeExport.h"
 using namespace std;
 
 
@@ -22,20 +27,24 @@ using namespace std;
  * ----------------------------------------------------------------------------
  * Field name contains name of current element.
  * Other nodes contain a pointer to next sibling and a pointer to firstChild.
+ * lastChild points at the end of the list of children so that a child is added in O(1).
  */
 
   struct FamilyTreeNode{
     string name;
     FamilyTreeNode *nextSibling;
     FamilyTreeNode *firstChild;
+    FamilyTreeNode *lastChild;
   };
 
 /* Function prototypes */
 string openFileFromUser(ifstream& file);
 string getLine(const string& prompt);
 FamilyTreeNode *readFamilyTree(ifstream& file);
-void displayFamilyTree(FamilyTreeNode *root,string spacing);
-void storeEntryInTree(const string& parent, const string& child,FamilyTreeNode *root);
+FamilyTreeNode *loadFamilyTree(const string& fileName);
+void displayFamilyTree(FamilyTreeNode *root);
+void storeEntryInTree(string_view parent,string_view child,HashMap<string,FamilyTreeNode *>& index);
+FamilyTreeNode *findOrCreateNode(string_view name,HashMap<string,FamilyTreeNode *>& index);
 
 /* Main program */
   int main(){
@@ -43,88 +52,141 @@ void storeEntryInTree(const string& parent, const string& child,FamilyTreeNode *
     ifstream file;
     string fileName = openFileFromUser(file);
     
-    /* Reading the family tree */
-    FamilyTreeNode *root = readFamilyTree(file);
+    /* Reading the family tree, through the stream if the file cannot be mapped */
+    FamilyTreeNode *root = loadFamilyTree(fileName);
+    if(root==NULL)
+      root = readFamilyTree(file);
 
     /* Display the family tree */
-    displayFamilyTree(root,"");
+    displayFamilyTree(root);
+
+    /* Freezing the tree into its compact form */
+    FamilyTreeCSR frozen;
+    frozen.buildFromLinkedTree(root);
+    cout<<"Compact form : "<<frozen.size()<<" people in "<<frozen.memoryUsage()<<" bytes"<<endl;
     
     return 0;
   }
 
+/*
+ * Function : loadFamilyTree
+ * -----------------------------------------------------------------------------------------------
+ * Reads in the family tree stored in the named file like readFamilyTree, but maps the file and
+ * parses it with edgeFileParser.h on all cores, so that no string is built but the names of nodes.
+ * Returns NULL if the file cannot be mapped.
+ */
+
+  FamilyTreeNode *loadFamilyTree(const string& fileName){
+    EdgeFile file;
+    if(!mapEdgeFile(fileName,file)) return NULL;
+    vector<Edge> edges;
+    parseEdgeFile(file,edges,thread::hardware_concurrency());
+
+    HashMap<string,FamilyTreeNode *> index;
+    string_view name = rootName(file);
+    FamilyTreeNode *root = findOrCreateNode(name,index);
+    for(size_t i=0;i<edges.size();i++)
+      storeEntryInTree(edges[i].parent,edges[i].child,index);
+    if((int)edges.size()!=index.size()-1)
+      cout<<"Warning : "<<index.size()-1-(int)edges.size()<<" names are not connected to "<<name<<endl;
+    unmapEdgeFile(file);
+    return root;
+  }
+
 /*
  * Function : readFamilyTree
  * -----------------------------------------------------------------------------------------------
  * Reads in the family tree as stored in the specified file with the help of the storeEntryInTree
- * file.
+ * file. Keeps an index from names to nodes so that every line is stored in O(1) expected time,
+ * which makes reading N lines O(N). Names are assumed to be unique. Warns about names that were
+ * never connected to the root, which happens if a parent is never given a parent of its own.
  */
 
   FamilyTreeNode *readFamilyTree(ifstream& file){
-    FamilyTreeNode *root = new FamilyTreeNode;
+    HashMap<string,FamilyTreeNode *> index;
     string rootName;
     getline(file,rootName);
-    root->name = rootName;
-    root->nextSibling = NULL;
-    root->firstChild = NULL;
+    FamilyTreeNode *root = findOrCreateNode(rootName,index);
     string currentRel;
+    int nLinks = 0;
     while(getline(file,currentRel)){
       int colonIndex = currentRel.find(":");
-      string child = currentRel.substr(0,colonIndex);
-      string parent = currentRel.substr(colonIndex+1);
-      storeEntryInTree(parent,child,root);
+      if(colonIndex<0) continue;//Skips blank lines.
+      string_view line = currentRel;
+      storeEntryInTree(line.substr(colonIndex+1),line.substr(0,colonIndex),index);
+      nLinks++;
     }
+    if(nLinks!=index.size()-1)
+      cout<<"Warning : "<<index.size()-1-nLinks<<" names are not connected to "<<rootName<<endl;
     return root;
   }
 
 /* 
  * Function  : storeEntryInTree 
- * -------------------------------------------------------------------------------- 
- * Uses linked lists to create and store entries in underlying tree representation.
- * Uses Pre Order traversal. 
+ * ------------------------------------------------------------------------------------------------
+ * Uses linked lists to create and store entries in underlying tree representation. The parent is
+ * looked up in the index rather than searched for in the tree, and the child is appended after
+ * lastChild. A parent that has not been seen yet is created on its own and gets linked into the
+ * tree by the later line that names its parent, so lines may come in any order.
  */
 
-  void storeEntryInTree(const string& parent, const string& child,FamilyTreeNode *root){
-   FamilyTreeNode *traversalPointer1 = root->firstChild;
-  
-   if(parent==root->name){
-     /* Creating the new Cell */
-     FamilyTreeNode *tempCell = new FamilyTreeNode;
-     tempCell->name = child;
-     tempCell->firstChild = NULL;
-     tempCell->nextSibling = NULL;
-    
-     /* Inserting the new Cell */
-     if(traversalPointer1==NULL){
-       cout<<"Stored Root Child!"<<endl;
-       root->firstChild = tempCell;
-     }else{
-       while(traversalPointer1->nextSibling!=NULL){
-         traversalPointer1 = traversalPointer1->nextSibling;   
-       }
-       cout<<"Stored Sibling !"<<child<<endl;
-       traversalPointer1->nextSibling = tempCell;
-     }
-   }else{
-     if(root->firstChild == NULL) return;
-     for(FamilyTreeNode *childStart = root->firstChild;childStart !=NULL;childStart = childStart->nextSibling){
-       storeEntryInTree(parent,child,childStart);
-     }
-   }
-}
+  void storeEntryInTree(string_view parent,string_view child,HashMap<string,FamilyTreeNode *>& index){
+    FamilyTreeNode *parentNode = findOrCreateNode(parent,index);
+    FamilyTreeNode *childNode = findOrCreateNode(child,index);
+    if(parentNode->firstChild==NULL)
+      parentNode->firstChild = childNode;
+    else
+      parentNode->lastChild->nextSibling = childNode;
+    parentNode->lastChild = childNode;
+  }
+
+/*
+ * Function : findOrCreateNode
+ * ---------------------------------------------------------------------------
+ * Returns the node with the given name, creating and indexing it if necessary.
+ * The name is looked up as a string_view, so the only string built is the name
+ * of a new node, which is then put in the index under that string.
+ */
+
+  FamilyTreeNode *findOrCreateNode(string_view name,HashMap<string,FamilyTreeNode *>& index){
+    FamilyTreeNode **found = index.find(name);
+    if(found!=NULL) return *found;
+    FamilyTreeNode *node = new FamilyTreeNode;
+    node->name = string(name);
+    node->nextSibling = NULL;
+    node->firstChild = NULL;
+    node->lastChild = NULL;
+    index.put(node->name,node);
+    return node;
+  }
   
 
 /* 
  * Function : displayFamilyTree
- * -------------------------------------------------------------------------
- * Recursive function to display the family tree. Uses Pre Order traversal.
+ * -----------------------------------------------------------------------------------------
+ * Draws the family tree in Pre Order into the shared output buffer, which is written out at
+ * the end, each name indented by two spaces per generation. The walk uses an explicit stack
+ * of nodes and depths, so a long line of descent cannot overflow the call stack : a node's
+ * next sibling is pushed before its first child, so the child's subtree is written first.
  */
 
-  void displayFamilyTree(FamilyTreeNode *root,string spacing){
-    cout<<spacing<<root->name<<endl; 
-    for(FamilyTreeNode *childStart = root->firstChild;childStart !=NULL;childStart = childStart->nextSibling){
-      displayFamilyTree(childStart,spacing + "  ");
-    } 
-    return;
+  void displayFamilyTree(FamilyTreeNode *root){
+    OutputBuffer& out = standardOutputBuffer();
+    vector<pair<FamilyTreeNode *,int> > stack;
+    stack.push_back(make_pair(root,0));
+    while(!stack.empty()){
+      FamilyTreeNode *node = stack.back().first;
+      int depth = stack.back().second;
+      stack.pop_back();
+      for(int i=0;i<depth;i++)
+        out<<"  ";
+      out<<node->name<<'\n';
+      if(node!=root && node->nextSibling!=NULL)
+        stack.push_back(make_pair(node->nextSibling,depth));
+      if(node->firstChild!=NULL)
+        stack.push_back(make_pair(node->firstChild,depth+1));
+    }
+    out.flush();
   }
 
 /*
@@ -12,6 +12,10 @@
 #include <sstream>
 #include <string>
 #include <vector>
+#include "../../HashMap/HashMap.h"
+#include "edgeFileParser.h"
+#include "familyTreeCSR.h"
+#include "../TreeExport.h"
 using namespace std;
 
 /* Useful data types and constants for programs */
@@ -25,9 +29,10 @@ struct FamilyTreeNode {
 string openFileFromUser(ifstream& file);
 string getLine(const string& prompt);
 FamilyTreeNode *readFamilyTree(ifstream& file);
-void storeEntryInTree(const string& parent, const string& child,FamilyTreeNode *root);
+FamilyTreeNode *loadFamilyTree(const string& fileName);
+void storeEntryInTree(string_view parent,string_view child,HashMap<string,FamilyTreeNode *>& index);
+FamilyTreeNode *findOrCreateNode(string_view name,HashMap<string,FamilyTreeNode *>& index);
 void displayFamilyTree(FamilyTreeNode *root);
-void displayFamilyTreeWithSpacing(FamilyTreeNode *root,string spacing);
 
 /* Main program */
   int main(){
@@ -36,11 +41,18 @@ void displayFamilyTreeWithSpacing(FamilyTreeNode *root,string spacing);
     ifstream file;
     string fileName = openFileFromUser(file);
     
-    /* Reading the family tree */
-    FamilyTreeNode *root = readFamilyTree(file);
+    /* Reading the family tree, through the stream if the file cannot be mapped */
+    FamilyTreeNode *root = loadFamilyTree(fileName);
+    if(root==NULL)
+      root = readFamilyTree(file);
 
     /* Display the family tree */
     displayFamilyTree(root);
+
+    /* Freezing the tree into its compact form */
+    FamilyTreeCSR frozen;
+    frozen.buildFromVectorTree(root);
+    cout<<"Compact form : "<<frozen.size()<<" people in "<<frozen.memoryUsage()<<" bytes"<<endl;
     return 0; 
   }
 
@@ -79,76 +91,113 @@ void displayFamilyTreeWithSpacing(FamilyTreeNode *root,string spacing);
     return result;
   }
 
+/*
+ * Function : loadFamilyTree
+ * -----------------------------------------------------------------------------------------------
+ * Reads in the family tree stored in the named file like readFamilyTree, but maps the file and
+ * parses it with edgeFileParser.h on all cores, so that no string is built but the names of nodes.
+ * Returns NULL if the file cannot be mapped.
+ */
+
+  FamilyTreeNode *loadFamilyTree(const string& fileName){
+    EdgeFile file;
+    if(!mapEdgeFile(fileName,file)) return NULL;
+    vector<Edge> edges;
+    parseEdgeFile(file,edges,thread::hardware_concurrency());
+
+    HashMap<string,FamilyTreeNode *> index;
+    string_view name = rootName(file);
+    FamilyTreeNode *root = findOrCreateNode(name,index);
+    for(size_t i=0;i<edges.size();i++)
+      storeEntryInTree(edges[i].parent,edges[i].child,index);
+    if((int)edges.size()!=index.size()-1)
+      cout<<"Warning : "<<index.size()-1-(int)edges.size()<<" names are not connected to "<<name<<endl;
+    unmapEdgeFile(file);
+    return root;
+  }
+
 /*
  * Function : readFamilyTree
  * -----------------------------------------------------------------------------------------------
  * Reads in the family tree as stored in the specified file with the help of the storeEntryInTree
- * file.
+ * file. Keeps an index from names to nodes so that every line is stored in O(1) expected time,
+ * which makes reading N lines O(N). Names are assumed to be unique. Warns about names that were
+ * never connected to the root, which happens if a parent is never given a parent of its own.
  */
 
   FamilyTreeNode *readFamilyTree(ifstream& file){
-    FamilyTreeNode *root = new FamilyTreeNode;
+    HashMap<string,FamilyTreeNode *> index;
     string rootName;
     getline(file,rootName);
-    root->name = rootName;
+    FamilyTreeNode *root = findOrCreateNode(rootName,index);
     string currentRel;
+    int nLinks = 0;
     while(getline(file,currentRel)){
       int colonIndex = currentRel.find(":");
-      string child = currentRel.substr(0,colonIndex);
-      string parent = currentRel.substr(colonIndex+1);
-      storeEntryInTree(parent,child,root);
+      if(colonIndex<0) continue;//Skips blank lines.
+      string_view line = currentRel;
+      storeEntryInTree(line.substr(colonIndex+1),line.substr(0,colonIndex),index);
+      nLinks++;
     }
+    if(nLinks!=index.size()-1)
+      cout<<"Warning : "<<index.size()-1-nLinks<<" names are not connected to "<<rootName<<endl;
     return root;
   }
 
 /*
  * Function : storeEntryInTree
  * -------------------------------------------------------------------------------------------------
- * Reads input from a file and stores it in a tree data structure, if input is in a specific format.
+ * Stores one line of the input file in the tree, if input is in a specific format. The parent is
+ * looked up in the index rather than searched for in the tree. A parent that has not been seen yet
+ * is created on its own and gets linked into the tree by the later line that names its parent, so
+ * lines may come in any order.
  * Note : See familytree.txt for the format.
  */
 
-  void storeEntryInTree(const string& parent, const string& child,FamilyTreeNode *root){
-    if(root->name == parent){
-      FamilyTreeNode *tempChild = new FamilyTreeNode;
-      tempChild->name = child;
-      root->children.push_back(tempChild);
-    }
-  
-    if(root->children.size() == 0)
-      return;
-
-    else{
-      for(int i=0;i<root->children.size();i++){
-        storeEntryInTree(parent,child,root->children[i]);
-      }
-    }
+  void storeEntryInTree(string_view parent,string_view child,HashMap<string,FamilyTreeNode *>& index){
+    FamilyTreeNode *parentNode = findOrCreateNode(parent,index);
+    FamilyTreeNode *childNode = findOrCreateNode(child,index);
+    parentNode->children.push_back(childNode);
   }
 
-/* 
- * Function : displayFamilyTree
- * -----------------------------------------------------------
- * Wrapper function to the function drawFamilyTreeWithSpacing.
+/*
+ * Function : findOrCreateNode
+ * ---------------------------------------------------------------------------
+ * Returns the node with the given name, creating and indexing it if necessary.
+ * The name is looked up as a string_view, so the only string built is the name
+ * of a new node, which is then put in the index under that string.
  */
 
-  void displayFamilyTree(FamilyTreeNode *root){
-    string spacing = "";
-    displayFamilyTreeWithSpacing(root,spacing);
+  FamilyTreeNode *findOrCreateNode(string_view name,HashMap<string,FamilyTreeNode *>& index){
+    FamilyTreeNode **found = index.find(name);
+    if(found!=NULL) return *found;
+    FamilyTreeNode *node = new FamilyTreeNode;
+    node->name = string(name);
+    index.put(node->name,node);
+    return node;
   }
 
-/* 
- * Function : displayFamilyTreeWithSpacing
- * -------------------------------------------------------------------
- * This function draws the family tree by traversing it "In Pre Order".
+/*
+ * Function : displayFamilyTree
+ * -----------------------------------------------------------------------------------------
+ * Draws the family tree in Pre Order into the shared output buffer, which is written out at
+ * the end, each name indented by two spaces per generation. The walk uses an explicit stack
+ * of nodes and depths, with children pushed last first so that they come out in order.
  */
 
-  void displayFamilyTreeWithSpacing(FamilyTreeNode *root,string spacing){
-    cout<<spacing<<root->name<<endl;
-    if(root->children.size()==0)
-      return;
-    else{
-      for(int i=0;i<root->children.size();i++){
-        displayFamilyTreeWithSpacing(root->children[i],string(spacing+"  "));
-      }
+  void displayFamilyTree(FamilyTreeNode *root){
+    OutputBuffer& out = standardOutputBuffer();
+    vector<pair<FamilyTreeNode *,int> > stack;
+    stack.push_back(make_pair(root,0));
+    while(!stack.empty()){
+      FamilyTreeNode *node = stack.back().first;
+      int depth = stack.back().second;
+      stack.pop_back();
+      for(int i=0;i<depth;i++)
+        out<<"  ";
+      out<<node->name<<'\n';
+      for(size_t i=node->children.size();i>0;i--)
+        stack.push_back(make_pair(node->children[i-1],depth+1));
     }
+    out.flush();
   }
@@ -0,0 +1,518 @@
+/*
+ * File : RBBST.cpp (Red-Black Binary Search Tree)
+ * ------------------------------------------------------------------------------
+ * The file implements the balanced version of the binary search tree which uses
+ * red-black colouring for balancing. Compared to the AVL tree, an insertion does at
+ * most 2 rotations and a deletion at most 3, the rest of the rebalancing is done by
+ * recolouring. The colour of a node is kept in the lowest bit of its parent pointer,
+ * which is always zero for a heap allocated node, so a node is no bigger than a node
+ * of the unbalanced tree plus one pointer.
+ * Programming Paradigm : Procedural.
+ */
+
+/* Including standard libraries */
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include <stdint.h>
+#include "../TreeBenchmark.h"
+#include "../TreeExport.h"
+using namespace std;
+
+/* Type definitions */
+  struct BSTNode{
+    int key;
+    uintptr_t parentAndColor;
+    BSTNode* left;
+    BSTNode* right;
+  };
+
+/* Global variables and constants */
+
+  //Value of the low bit of parentAndColor for each colour.
+  const uintptr_t BLACK = 0;
+  const uintptr_t RED = 1;
+
+/* Function prototypes */
+void insertNode(BSTNode* &tree,const int &key);
+  void fixInsertion(BSTNode* &tree,BSTNode* node);
+BSTNode *findNode(BSTNode* &tree,const int &key);
+bool removeNode(BSTNode* &tree,const int &key);
+  void transplant(BSTNode* &tree,BSTNode* oldNode,BSTNode* newNode);
+  void fixRemoval(BSTNode* &tree,BSTNode* node,BSTNode* parent);
+  void rotateLeft(BSTNode* &tree,BSTNode* node);
+  void rotateRight(BSTNode* &tree,BSTNode* node);
+
+  BSTNode* parentOf(BSTNode* node);
+  void setParent(BSTNode* node,BSTNode* parent);
+  bool isRed(BSTNode* node);
+  void setColor(BSTNode* node,uintptr_t color);
+
+int height(BSTNode *tree);
+int blackHeight(BSTNode *tree);
+bool isBST(BSTNode *tree);
+void displayTree(BSTNode* tree);
+void exportTree(BSTNode* tree);
+  void describeNode(OutputBuffer &out,BSTNode* node);
+void runWorkloadBenchmark();
+
+/* The main program */
+  int main(){
+    cout<<"Program to test procedures on the Red-Black Binary Search tree"<<endl;
+    BSTNode* root = NULL;
+    for(int i=0;i<10;i++){
+      insertNode(root,i);
+    }
+
+    //Displaying the in-order traversal of the tree
+    displayTree(root);
+    cout<<"Height of tree : "<<height(root)<<endl;
+
+    //Testing the red-black and binary search properties. Expected Yes
+    cout<<"Red-black property status : "<<(blackHeight(root)>0)<<endl;
+    cout<<"Maintains binary search property status : "<<isBST(root)<<endl;
+
+    //Removing certain nodes
+    removeNode(root,0);
+    removeNode(root,2);
+    removeNode(root,8);
+    removeNode(root,7);
+    cout<<"Tree after removal of 0,2,8,7"<<endl;
+    displayTree(root);
+    exportTree(root);
+    cout<<"Red-black property status : "<<(blackHeight(root)>0)<<endl;
+    cout<<"Maintains binary search property status : "<<isBST(root)<<endl;
+
+    runWorkloadBenchmark();
+    return 0;
+  }
+
+/*
+ * Function : runWorkloadBenchmark
+ * ---------------------------------------------------------------------------------------
+ * Measures throughput on the insert-, lookup- and delete-heavy mixes exported by
+ * TreeBenchmark.h. AVLBST.cpp runs the same mixes so that the two programs' output
+ * can be compared directly.
+ */
+
+  void runWorkloadBenchmark(){
+    const int N_KEYS = 20000;
+    const int N_OPERATIONS = 200000;
+    WorkloadMix mixes[] = {INSERT_HEAVY,LOOKUP_HEAVY,DELETE_HEAVY};
+    vector<int> keys;
+    shuffledKeys(keys,N_KEYS);
+
+    cout<<"Workload benchmark : "<<N_KEYS<<" initial keys, "<<N_OPERATIONS<<" operations"<<endl;
+    for(int m=0;m<3;m++){
+      BSTNode* root = NULL;
+      for(int i=0;i<N_KEYS;i++)
+        insertNode(root,2*keys[i]);
+      vector<TreeOperation> operations;
+      generateOperationMix(operations,N_KEYS,N_OPERATIONS,mixes[m]);
+
+      clock_t start = clock();
+      int hits = 0;
+      for(int i=0;i<N_OPERATIONS;i++){
+        switch(operations[i].type){
+          case INSERT_OP: insertNode(root,operations[i].key); break;
+          case LOOKUP_OP: if(findNode(root,operations[i].key)!=NULL) hits++; break;
+          case DELETE_OP: if(removeNode(root,operations[i].key)) hits++; break;
+        }
+      }
+      double seconds = secondsSince(start);
+
+      cout<<"Red-black ("<<mixName(mixes[m])<<") : ";
+      cout<<(seconds>0?N_OPERATIONS/seconds:0)<<" operations/sec, "<<hits<<" hits, ";
+      cout<<"valid : "<<(blackHeight(root)>0 && isBST(root))<<endl;
+    }
+  }
+
+/*
+ * Functions : parentOf,setParent,isRed,setColor
+ * -----------------------------------------------------------------------------
+ * Accessors for the parent pointer and colour packed into parentAndColor.
+ * NULL children count as black leaves.
+ */
+
+  BSTNode* parentOf(BSTNode* node){
+    return (BSTNode*)(node->parentAndColor & ~RED);
+  }
+
+  void setParent(BSTNode* node,BSTNode* parent){
+    node->parentAndColor = (uintptr_t)parent | (node->parentAndColor & RED);
+  }
+
+  bool isRed(BSTNode* node){
+    return node!=NULL && (node->parentAndColor & RED);
+  }
+
+  void setColor(BSTNode* node,uintptr_t color){
+    node->parentAndColor = (node->parentAndColor & ~RED) | color;
+  }
+
+/*
+ * Function : insertNode
+ * ------------------------------------------------------------------------
+ * Inserts a node as a red leaf, preserving the binary search property, and
+ * then restores the red-black properties with fixInsertion.
+ * Assumes unique keys. Does nothing if key same as a key in the tree.
+ */
+
+  void insertNode(BSTNode* &tree,const int &key){
+    BSTNode* parent = NULL;
+    BSTNode* current = tree;
+    while(current!=NULL){
+      if(current->key==key) return;
+      parent = current;
+      current = key<current->key?current->left:current->right;
+    }
+    BSTNode* node = new BSTNode;
+    node->key = key;
+    node->left = node->right = NULL;
+    node->parentAndColor = (uintptr_t)parent | RED;
+    if(parent==NULL)
+      tree = node;
+    else if(key<parent->key)
+      parent->left = node;
+    else
+      parent->right = node;
+    fixInsertion(tree,node);
+  }
+
+/*
+ * Function : fixInsertion
+ * -----------------------------------------------------------------------------------------
+ * Removes a red node with a red parent by walking up the tree. When the uncle is red,
+ * recolouring moves the problem two levels up. When the uncle is black, one or two
+ * rotations finish the job, so an insertion never does more than two rotations.
+ */
+
+  void fixInsertion(BSTNode* &tree,BSTNode* node){
+    while(isRed(parentOf(node))){
+      BSTNode* parent = parentOf(node);
+      BSTNode* grandParent = parentOf(parent);
+      if(parent==grandParent->left){
+        BSTNode* uncle = grandParent->right;
+        if(isRed(uncle)){
+          setColor(parent,BLACK);
+          setColor(uncle,BLACK);
+          setColor(grandParent,RED);
+          node = grandParent;
+          continue;
+        }
+        if(node==parent->right){
+          rotateLeft(tree,parent);
+          node = parent;
+          parent = parentOf(node);
+        }
+        setColor(parent,BLACK);
+        setColor(grandParent,RED);
+        rotateRight(tree,grandParent);
+      }else{
+        BSTNode* uncle = grandParent->left;
+        if(isRed(uncle)){
+          setColor(parent,BLACK);
+          setColor(uncle,BLACK);
+          setColor(grandParent,RED);
+          node = grandParent;
+          continue;
+        }
+        if(node==parent->left){
+          rotateRight(tree,parent);
+          node = parent;
+          parent = parentOf(node);
+        }
+        setColor(parent,BLACK);
+        setColor(grandParent,RED);
+        rotateLeft(tree,grandParent);
+      }
+    }
+    setColor(tree,BLACK);
+  }
+
+/*
+ * Function : findNode
+ * ------------------------------------------------------------------------
+ * Finds the node with the specified key and returns a pointer to the same.
+ */
+
+  BSTNode *findNode(BSTNode* &tree,const int &key){
+    BSTNode* current = tree;
+    while(current!=NULL && current->key!=key)
+      current = key<current->key?current->left:current->right;
+    return current;
+  }
+
+/*
+ * Function : removeNode
+ * -----------------------------------------------------------------------------------------
+ * Removes the node with the specified key. A node with two children is replaced by the
+ * right most node of its left subtree, as in the AVL tree. If the node physically removed
+ * was black, fixRemoval restores the black height. Returns a boolean value indicating if
+ * the node with the specified key was removed.
+ */
+
+  bool removeNode(BSTNode* &tree,const int &key){
+    BSTNode* nodeToDelete = findNode(tree,key);
+    if(nodeToDelete==NULL)
+      return false;
+
+    //child takes the place of the node physically removed from the tree.
+    BSTNode* child;
+    BSTNode* childParent;
+    bool removedBlack = !isRed(nodeToDelete);
+    if(nodeToDelete->left==NULL){
+      child = nodeToDelete->right;
+      childParent = parentOf(nodeToDelete);
+      transplant(tree,nodeToDelete,child);
+    }else if(nodeToDelete->right==NULL){
+      child = nodeToDelete->left;
+      childParent = parentOf(nodeToDelete);
+      transplant(tree,nodeToDelete,child);
+    }else{
+      BSTNode* successor = nodeToDelete->left;
+      while(successor->right!=NULL)
+        successor = successor->right;
+      removedBlack = !isRed(successor);
+      child = successor->left;
+      if(parentOf(successor)==nodeToDelete){
+        childParent = successor;
+      }else{
+        childParent = parentOf(successor);
+        transplant(tree,successor,child);
+        successor->left = nodeToDelete->left;
+        setParent(successor->left,successor);
+      }
+      transplant(tree,nodeToDelete,successor);
+      successor->right = nodeToDelete->right;
+      setParent(successor->right,successor);
+      setColor(successor,nodeToDelete->parentAndColor & RED);
+    }
+    delete nodeToDelete;
+    if(removedBlack)
+      fixRemoval(tree,child,childParent);
+    return true;
+  }
+
+/*
+ * Function : transplant
+ * -----------------------------------------------------------------
+ * Replaces the subtree rooted at oldNode by the one rooted at newNode.
+ */
+
+  void transplant(BSTNode* &tree,BSTNode* oldNode,BSTNode* newNode){
+    BSTNode* parent = parentOf(oldNode);
+    if(parent==NULL)
+      tree = newNode;
+    else if(parent->left==oldNode)
+      parent->left = newNode;
+    else
+      parent->right = newNode;
+    if(newNode!=NULL)
+      setParent(newNode,parent);
+  }
+
+/*
+ * Function : fixRemoval
+ * -----------------------------------------------------------------------------------------
+ * node carries an extra black after a black node was removed above it. parent is passed
+ * separately since node may be NULL. A red sibling is first made black with one rotation.
+ * With a black sibling whose children are both black, recolouring pushes the extra black
+ * one level up, which costs no rotation. Otherwise one or two rotations end the walk, so
+ * a deletion never does more than three rotations.
+ */
+
+  void fixRemoval(BSTNode* &tree,BSTNode* node,BSTNode* parent){
+    while(node!=tree && !isRed(node)){
+      if(node==parent->left){
+        BSTNode* sibling = parent->right;
+        if(isRed(sibling)){
+          setColor(sibling,BLACK);
+          setColor(parent,RED);
+          rotateLeft(tree,parent);
+          sibling = parent->right;
+        }
+        if(!isRed(sibling->left) && !isRed(sibling->right)){
+          setColor(sibling,RED);
+          node = parent;
+          parent = parentOf(node);
+        }else{
+          if(!isRed(sibling->right)){
+            setColor(sibling->left,BLACK);
+            setColor(sibling,RED);
+            rotateRight(tree,sibling);
+            sibling = parent->right;
+          }
+          setColor(sibling,parent->parentAndColor & RED);
+          setColor(parent,BLACK);
+          setColor(sibling->right,BLACK);
+          rotateLeft(tree,parent);
+          node = tree;
+        }
+      }else{
+        BSTNode* sibling = parent->left;
+        if(isRed(sibling)){
+          setColor(sibling,BLACK);
+          setColor(parent,RED);
+          rotateRight(tree,parent);
+          sibling = parent->left;
+        }
+        if(!isRed(sibling->left) && !isRed(sibling->right)){
+          setColor(sibling,RED);
+          node = parent;
+          parent = parentOf(node);
+        }else{
+          if(!isRed(sibling->left)){
+            setColor(sibling->right,BLACK);
+            setColor(sibling,RED);
+            rotateLeft(tree,sibling);
+            sibling = parent->left;
+          }
+          setColor(sibling,parent->parentAndColor & RED);
+          setColor(parent,BLACK);
+          setColor(sibling->left,BLACK);
+          rotateRight(tree,parent);
+          node = tree;
+        }
+      }
+    }
+    if(node!=NULL)
+      setColor(node,BLACK);
+  }
+
+/*
+ * Function : rotateLeft,rotateRight
+ * -----------------------------------------------------------------------------
+ * Functions to perform single left or right rotations at node. They modify the
+ * left and right child of the nodes involved as well as the parent relationships,
+ * and update tree if node was the root. Colours are left untouched.
+ */
+
+  void rotateLeft(BSTNode* &tree,BSTNode* node){
+    BSTNode* child = node->right;
+    node->right = child->left;
+    if(node->right!=NULL)
+      setParent(node->right,node);
+    transplant(tree,node,child);
+    child->left = node;
+    setParent(node,child);
+  }
+
+  void rotateRight(BSTNode* &tree,BSTNode* node){
+    BSTNode* child = node->left;
+    node->left = child->right;
+    if(node->left!=NULL)
+      setParent(node->left,node);
+    transplant(tree,node,child);
+    child->right = node;
+    setParent(node,child);
+  }
+
+/*
+ * Function : blackHeight
+ * ----------------------------------------------------------------------------------------
+ * Returns the number of black nodes on every path from tree down to a leaf, counting the
+ * NULL leaf. Returns 0 if the paths disagree, a red node has a red child or the root is red.
+ */
+
+  int blackHeight(BSTNode *tree){
+    if(tree==NULL)
+      return 1;
+    if(parentOf(tree)==NULL && isRed(tree))
+      return 0;
+    if(isRed(tree) && (isRed(tree->left) || isRed(tree->right)))
+      return 0;
+    int leftHeight = blackHeight(tree->left);
+    int rightHeight = blackHeight(tree->right);
+    if(leftHeight==0 || leftHeight!=rightHeight)
+      return 0;
+    return leftHeight + (isRed(tree)?0:1);
+  }
+
+/*
+ * Function : isBST
+ * ---------------------------------------------------------
+ * Returns if the Binary Search property holds for the tree.
+ */
+
+  bool isBST(BSTNode* tree){
+    if(tree==NULL)
+      return true;
+    if(tree->left!=NULL && !(tree->left->key<tree->key))
+      return false;
+    if(tree->right!=NULL && !(tree->key<tree->right->key))
+      return false;
+    return isBST(tree->left) && isBST(tree->right);
+  }
+
+/*
+ * Function : height
+ * --------------------------------
+ * Determines the height of a tree
+ */
+
+  int height(BSTNode* tree){
+    if(tree==NULL)
+      return 0;
+    int leftheight = height(tree->left);
+    int rightheight = height(tree->right);
+    return 1 + (leftheight>rightheight?leftheight:rightheight);
+  }
+
+/*
+ * Function : displayTree
+ * -----------------------------------------------------------------
+ * Displays by inorder traversal, through the shared output buffer.
+ */
+
+  void displayTree(BSTNode* tree){
+    OutputBuffer &out = standardOutputBuffer();
+    renderInOrder(out,tree,describeNode);
+    out.flush();
+  }
+
+/*
+ * Function : exportTree
+ * ------------------------------------------------------------------------------------
+ * Writes the keys in pre order and indented by depth, then the tree as nested JSON objects
+ * and as a Graphviz digraph, through the shared output buffer, for viewing the shape of the
+ * tree outside the program.
+ */
+
+  void exportTree(BSTNode* tree){
+    OutputBuffer &out = standardOutputBuffer();
+    out<<"Tree in pre order :\n";
+    renderPreOrder(out,tree,describeKey<BSTNode>);
+    out<<"Tree as a hierarchy :\n";
+    renderIndented(out,tree,describeKey<BSTNode>);
+    out<<"Tree as JSON : ";
+    renderJSON(out,tree);
+    out<<"Tree as DOT :\n";
+    renderDOT(out,tree);
+    out.flush();
+  }
+
+/*
+ * Function : describeNode
+ * ---------------------------------------------------------------
+ * Writes the line of displayTree for one node, without its newline.
+ */
+
+  void describeNode(OutputBuffer &out,BSTNode* node){
+    out<<"Key : "<<node->key<<"  ";
+    if(parentOf(node)!=NULL)
+      out<<"Parent : "<<parentOf(node)->key<<"  ";
+    else
+      out<<"Parent : NULL"<<"  ";
+    if(node->left!=NULL)
+      out<<"Left Child : "<<node->left->key<<"  ";
+    else
+      out<<"Left Child : NULL"<<"  ";
+    if(node->right!=NULL)
+      out<<"Right Child : "<<node->right->key<<"  ";
+    else
+      out<<"Right Child : NULL"<<"  ";
+    out<<"Color : "<<(isRed(node)?"Red":"Black");
+  }
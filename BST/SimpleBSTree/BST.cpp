@@ -14,6 +14,7 @@
 #include <iomanip>
 #include <cstdlib>
 #include <vector>
+#include "../TreeExport.h"
 using namespace std;
 
 /* Necessary structs */
@@ -28,6 +29,7 @@ BSTNode *findNode(BSTNode* &tree,const int &key);
 void insertNode(BSTNode* &tree, const int &key);
 bool removeNode(BSTNode* &tree,const int &key);
 void displayTree(BSTNode* tree);
+void exportTree(BSTNode* tree);
 int height(BSTNode *tree);
 bool isBalanced(BSTNode *tree);
 bool isBST(BSTNode *tree);
@@ -67,7 +69,8 @@ int main(){
   /* Displaying the in-order traversal of the tree */
   displayTree(root);
   
-  
+  /* Displaying the shape of the tree */
+  exportTree(root);
   
   return 0;
 }
@@ -150,18 +153,34 @@ int main(){
 
 /* 
  * Function : displayTree
- * ------------------------------
- * Displays by inorder traversal.
+ * -----------------------------------------------------------------
+ * Displays by inorder traversal, through the shared output buffer.
  */
 
   void displayTree(BSTNode* tree){
-    if(tree==NULL)
-      return;
-    else{
-      displayTree(tree->left);
-      cout<<tree->key<<endl;
-      displayTree(tree->right);
-    }
+    OutputBuffer &out = standardOutputBuffer();
+    renderInOrder(out,tree,describeKey<BSTNode>);
+    out.flush();
+  }
+
+/*
+ * Function : exportTree
+ * ----------------------------------------------------------------------------------------
+ * Writes the keys in pre order and as an indented hierarchy, then the tree as JSON and as
+ * a Graphviz graph, through the shared output buffer.
+ */
+
+  void exportTree(BSTNode* tree){
+    OutputBuffer &out = standardOutputBuffer();
+    out<<"Tree in pre order :\n";
+    renderPreOrder(out,tree,describeKey<BSTNode>);
+    out<<"Tree as a hierarchy :\n";
+    renderIndented(out,tree,describeKey<BSTNode>);
+    out<<"Tree as JSON : ";
+    renderJSON(out,tree);
+    out<<"Tree as DOT :\n";
+    renderDOT(out,tree);
+    out.flush();
   }
 
 /*
@@ -0,0 +1,431 @@
+/*
+ * File : SplayBST.cpp (Splay Binary Search Tree)
+ * ------------------------------------------------------------------------------
+ * The file implements the self adjusting version of the binary search tree. Every
+ * access rotates the accessed node towards the root using the same rotateLeft and
+ * rotateRight procedures as the AVL tree, so frequently used keys stay near the top.
+ * Two adjusting modes are supported : full splaying, which moves the node all the
+ * way to the root, and semi-splaying, which only halves the depth of the access path
+ * and so performs fewer pointer writes per access.
+ * Programming Paradigm : Procedural.
+ */
+
+/* Including standard libraries */
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+#include <ctime>
+#include <vector>
+#include "../TreeBenchmark.h"
+#include "../TreeExport.h"
+using namespace std;
+
+/* Type definitions */
+  struct BSTNode{
+    int key;
+    BSTNode* parent;
+    BSTNode* left;
+    BSTNode* right;
+  };
+
+  enum SplayMode { FULL_SPLAY, SEMI_SPLAY };
+
+/* Global variables and constants */
+
+  //Adjusting strategy used by every access to the tree.
+  SplayMode splayMode = FULL_SPLAY;
+
+/* Function prototypes */
+void insertNode(BSTNode* &tree,const int &key);
+BSTNode *findNode(BSTNode* &tree,const int &key);
+bool removeNode(BSTNode* &tree,const int &key);
+  void splay(BSTNode* &tree,BSTNode* node);
+  void semiSplay(BSTNode* &tree,BSTNode* node);
+  void adjust(BSTNode* &tree,BSTNode* node);
+  void rotateLeft(BSTNode* &tree);
+  void rotateRight(BSTNode* &tree);
+
+int height(BSTNode *tree);
+bool isBST(BSTNode *tree);
+void displayTree(BSTNode* tree);
+  void describeNode(OutputBuffer &out,BSTNode* node);
+void runLookupBenchmark();
+
+/* The main program */
+  int main(){
+    cout<<"Program to test procedures on the Splay Binary Search tree"<<endl;
+    BSTNode* root = NULL;
+    for(int i=0;i<10;i++){
+      insertNode(root,i);
+    }
+
+    //Displaying the in-order traversal of the tree
+    displayTree(root);
+    cout<<"Height of tree : "<<height(root)<<endl;
+
+    //Accessing a deep key brings it to the root
+    findNode(root,0);
+    cout<<"Root after accessing 0 : "<<root->key<<endl;
+    cout<<"Height of tree : "<<height(root)<<endl;
+
+    //Testing whether the tree has binary search property.Expected Yes
+    cout<<"Maintains binary search property status : "<<isBST(root)<<endl;
+
+    //Removing certain nodes
+    removeNode(root,0);
+    removeNode(root,5);
+    removeNode(root,9);
+    cout<<"Tree after removal of 0,5,9"<<endl;
+    displayTree(root);
+    cout<<"Maintains binary search property status : "<<isBST(root)<<endl;
+
+    runLookupBenchmark();
+    return 0;
+  }
+
+/*
+ * Function : runLookupBenchmark
+ * ---------------------------------------------------------------------------------------
+ * Measures lookup throughput of the splay tree in both adjusting modes under the access
+ * patterns exported by TreeBenchmark.h. AVLBST.cpp runs the same workloads so that the
+ * two programs' output can be compared directly.
+ */
+
+  void runLookupBenchmark(){
+    const int N_KEYS = 100000;
+    const int N_ACCESSES = 2000000;
+    AccessPattern patterns[] = {UNIFORM,ZIPF,SLIDING_WINDOW};
+    SplayMode modes[] = {FULL_SPLAY,SEMI_SPLAY};
+    vector<int> keys;
+    shuffledKeys(keys,N_KEYS);
+
+    cout<<"Lookup benchmark : "<<N_KEYS<<" keys, "<<N_ACCESSES<<" lookups"<<endl;
+    for(int m=0;m<2;m++){
+      splayMode = modes[m];
+      for(int p=0;p<3;p++){
+        BSTNode* root = NULL;
+        for(int i=0;i<N_KEYS;i++)
+          insertNode(root,keys[i]);
+        vector<int> accesses;
+        generateAccessSequence(accesses,N_KEYS,N_ACCESSES,patterns[p]);
+
+        clock_t start = clock();
+        int found = 0;
+        for(int i=0;i<N_ACCESSES;i++)
+          if(findNode(root,accesses[i])!=NULL) found++;
+        double seconds = secondsSince(start);
+
+        cout<<(splayMode==FULL_SPLAY?"Splay":"Semi-splay")<<" ("<<patternName(patterns[p])<<") : ";
+        cout<<(seconds>0?N_ACCESSES/seconds:0)<<" lookups/sec, "<<found<<" found"<<endl;
+      }
+    }
+  }
+
+/*
+ * Function : insertNode
+ * ------------------------------------------------------------------------
+ * Inserts a node into the tree, preserving the binary search property, and
+ * brings the new node to the root. If the key is already present the node
+ * holding it is brought to the root instead.
+ */
+
+  void insertNode(BSTNode* &tree,const int &key){
+    BSTNode* parent = NULL;
+    BSTNode* current = tree;
+    while(current!=NULL && current->key!=key){
+      parent = current;
+      current = key<current->key?current->left:current->right;
+    }
+    if(current==NULL){
+      current = new BSTNode;
+      current->key = key;
+      current->parent = parent;
+      current->left = current->right = NULL;
+      if(parent==NULL)
+        tree = current;
+      else if(key<parent->key)
+        parent->left = current;
+      else
+        parent->right = current;
+    }
+    adjust(tree,current);
+  }
+
+/*
+ * Function : findNode
+ * ---------------------------------------------------------------------------------
+ * Finds the node with the specified key and returns a pointer to the same. The node
+ * found, or the last node visited if the key is absent, is moved towards the root.
+ */
+
+  BSTNode *findNode(BSTNode* &tree,const int &key){
+    BSTNode* last = NULL;
+    BSTNode* current = tree;
+    while(current!=NULL && current->key!=key){
+      last = current;
+      current = key<current->key?current->left:current->right;
+    }
+    if(current!=NULL)
+      adjust(tree,current);
+    else if(last!=NULL)
+      adjust(tree,last);
+    return current;
+  }
+
+/*
+ * Function : removeNode
+ * ---------------------------------------------------------------------------------
+ * Removes the node with the specified key. The node is first splayed to the root,
+ * then the largest node of its left subtree is splayed to the top of that subtree,
+ * which leaves it without a right child so the right subtree can be hung there.
+ * Returns a boolean value indicating if the node with the specified key was removed.
+ */
+
+  bool removeNode(BSTNode* &tree,const int &key){
+    BSTNode* nodeToDelete = findNode(tree,key);
+    if(nodeToDelete==NULL)
+      return false;
+    splay(tree,nodeToDelete);
+
+    BSTNode* leftTree = nodeToDelete->left;
+    BSTNode* rightTree = nodeToDelete->right;
+    if(leftTree==NULL){
+      tree = rightTree;
+      if(tree!=NULL)
+        tree->parent = NULL;
+    }else{
+      leftTree->parent = NULL;
+      BSTNode* maxNode = leftTree;
+      while(maxNode->right!=NULL)
+        maxNode = maxNode->right;
+      splay(leftTree,maxNode);
+      leftTree->right = rightTree;
+      if(rightTree!=NULL)
+        rightTree->parent = leftTree;
+      tree = leftTree;
+    }
+    delete nodeToDelete;
+    return true;
+  }
+
+/*
+ * Function : adjust
+ * -----------------------------------------------------------
+ * Moves node towards the root according to the current mode.
+ */
+
+  void adjust(BSTNode* &tree,BSTNode* node){
+    if(splayMode==FULL_SPLAY)
+      splay(tree,node);
+    else
+      semiSplay(tree,node);
+  }
+
+/*
+ * Function : splay
+ * -----------------------------------------------------------------------------------------
+ * Moves node to the root of tree by a sequence of zig, zig-zig and zig-zag steps.
+ * zig     : node is a child of the root. One rotation at the parent.
+ * zig-zig : node and its parent are both left (or both right) children. Rotate at the
+ *           grandparent first, then at the parent.
+ * zig-zag : node is a left child and its parent a right child (or vice versa). Rotate at
+ *           the parent, then at the grandparent.
+ */
+
+  void splay(BSTNode* &tree,BSTNode* node){
+    while(node->parent!=NULL){
+      BSTNode* parent = node->parent;
+      BSTNode* grandParent = parent->parent;
+      BSTNode* pivot;
+      bool nodeIsLeft = parent->left==node;
+      if(grandParent==NULL){
+        pivot = parent;
+        if(nodeIsLeft) rotateRight(pivot); else rotateLeft(pivot);
+      }else{
+        bool parentIsLeft = grandParent->left==parent;
+        if(nodeIsLeft && parentIsLeft){
+          pivot = grandParent; rotateRight(pivot);
+          pivot = parent; rotateRight(pivot);
+        }else if(!nodeIsLeft && !parentIsLeft){
+          pivot = grandParent; rotateLeft(pivot);
+          pivot = parent; rotateLeft(pivot);
+        }else if(!nodeIsLeft && parentIsLeft){
+          pivot = parent; rotateLeft(pivot);
+          pivot = grandParent; rotateRight(pivot);
+        }else{
+          pivot = parent; rotateRight(pivot);
+          pivot = grandParent; rotateLeft(pivot);
+        }
+      }
+    }
+    tree = node;
+  }
+
+/*
+ * Function : semiSplay
+ * -----------------------------------------------------------------------------------------
+ * Semi-splaying variant of splay. In the zig-zig case only the rotation at the grandparent
+ * is done and the walk continues from the parent, so the node climbs one level instead of
+ * two but the access path is still roughly halved in depth. This does about half the
+ * rotations of splay per access, which keeps hot keys near the root while writing to
+ * fewer nodes. The zig and zig-zag steps are the same as in splay.
+ */
+
+  void semiSplay(BSTNode* &tree,BSTNode* node){
+    BSTNode* current = node;
+    while(current->parent!=NULL){
+      BSTNode* parent = current->parent;
+      BSTNode* grandParent = parent->parent;
+      BSTNode* pivot;
+      bool nodeIsLeft = parent->left==current;
+      if(grandParent==NULL){
+        pivot = parent;
+        if(nodeIsLeft) rotateRight(pivot); else rotateLeft(pivot);
+      }else{
+        bool parentIsLeft = grandParent->left==parent;
+        if(nodeIsLeft==parentIsLeft){
+          pivot = grandParent;
+          if(nodeIsLeft) rotateRight(pivot); else rotateLeft(pivot);
+          current = parent;
+        }else if(!nodeIsLeft){
+          pivot = parent; rotateLeft(pivot);
+          pivot = grandParent; rotateRight(pivot);
+        }else{
+          pivot = parent; rotateRight(pivot);
+          pivot = grandParent; rotateLeft(pivot);
+        }
+      }
+    }
+    tree = current;
+  }
+
+/*
+ * Function : rotateLeft,rotateRight
+ * -----------------------------------------------------------------------------
+ * Functions to perform single left or right rotations.They modify the left and
+ * the right child of nodes involved in rotations as well as the parent
+ * relationships.
+ */
+
+  void rotateLeft(BSTNode* &tree){
+    //Recording the parent of the tree since we need a swap
+    BSTNode* treeParent = tree->parent;
+    bool isLeft = false;
+    if(treeParent!=NULL){
+      if(treeParent->left==tree)
+        isLeft=true;
+    }
+
+    BSTNode* child = tree->right;
+    //Modifying the tree structs members.
+    tree->right = child->left;
+    if(tree->right!=NULL)
+      tree->right->parent = tree;
+    tree->parent = child;
+    //Modifying the child structs members.
+    child->left = tree;
+    child->parent = treeParent;
+    //Assigning the child as the new Root i.e tree.
+
+    tree = child;
+    if(treeParent!=NULL){
+      if(isLeft)
+        treeParent->left = child;
+      else
+        treeParent->right = child;
+    }
+  }
+
+  void rotateRight(BSTNode* &tree){
+    //Recording the parent of the tree since we need a swap
+    BSTNode* treeParent = tree->parent;
+    bool isLeft = false;
+    if(treeParent!=NULL){
+      if(treeParent->left==tree)
+        isLeft=true;
+    }
+
+    BSTNode* child = tree->left;
+    //Modifying the tree structs members.
+    tree->left = child->right;
+    if(tree->left!=NULL)
+      tree->left->parent = tree;
+    tree->parent = child;
+    //Modifying the child structs members.
+    child->right = tree;
+    child->parent = treeParent;
+    //Assigning the child as the new Root i.e tree.
+    tree = child;
+    if(treeParent!=NULL){
+      if(isLeft)
+        treeParent->left = child;
+      else
+        treeParent->right = child;
+    }
+
+  }
+
+/*
+ * Function : isBST
+ * ---------------------------------------------------------
+ * Returns if the Binary Search property holds for the tree.
+ */
+
+  bool isBST(BSTNode* tree){
+    if(tree==NULL)
+      return true;
+    if(tree->left!=NULL && !(tree->left->key<tree->key))
+      return false;
+    if(tree->right!=NULL && !(tree->key<tree->right->key))
+      return false;
+    return isBST(tree->left) && isBST(tree->right);
+  }
+
+/*
+ * Function : height
+ * --------------------------------
+ * Determines the height of a tree
+ */
+
+  int height(BSTNode* tree){
+    if(tree==NULL)
+      return 0;
+    int leftheight = height(tree->left);
+    int rightheight = height(tree->right);
+    return 1 + (leftheight>rightheight?leftheight:rightheight);
+  }
+
+/*
+ * Function : displayTree
+ * -----------------------------------------------------------------
+ * Displays by inorder traversal, through the shared output buffer.
+ */
+
+  void displayTree(BSTNode* tree){
+    OutputBuffer &out = standardOutputBuffer();
+    renderInOrder(out,tree,describeNode);
+    out.flush();
+  }
+
+/*
+ * Function : describeNode
+ * ---------------------------------------------------------------
+ * Writes the line of displayTree for one node, without its newline.
+ */
+
+  void describeNode(OutputBuffer &out,BSTNode* node){
+    out<<"Key : "<<node->key<<"  ";
+    if(node->parent!=NULL)
+      out<<"Parent : "<<node->parent->key<<"  ";
+    else
+      out<<"Parent : NULL"<<"  ";
+    if(node->left!=NULL)
+      out<<"Left Child : "<<node->left->key<<"  ";
+    else
+      out<<"Left Child : NULL"<<"  ";
+    if(node->right!=NULL)
+      out<<"Right Child : "<<node->right->key;
+    else
+      out<<"Right Child : NULL";
+  }
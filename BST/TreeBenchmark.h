@@ -0,0 +1,193 @@
+/*
+ * File : TreeBenchmark.h
+ * -------------------------------------------------------------------------------------
+ * Helpers shared by the tree programs for timing lookups under different key access
+ * patterns and mixed insert/lookup/delete workloads. Each tree program builds its own
+ * tree and runs its own loop over the sequences generated here, so the procedural trees
+ * need not share a node type.
+ */
+
+#ifndef _TreeBenchmark_h
+#define _TreeBenchmark_h
+
+/* Including standard libraries */
+#include <vector>
+#include <cmath>
+#include <ctime>
+using namespace std;
+
+/*
+ * Enum : AccessPattern
+ * ---------------------------------------------------------------------------------------
+ * UNIFORM        : Every key is equally likely.
+ * ZIPF           : Key of rank r is picked with probability proportional to 1/r^0.99.
+ * SLIDING_WINDOW : Keys are uniform over a small window that slowly moves over the keys.
+ */
+
+  enum AccessPattern { UNIFORM, ZIPF, SLIDING_WINDOW };
+
+  const double ZIPF_EXPONENT = 0.99;
+  const int SLIDING_WINDOW_SIZE = 1000;
+
+/*
+ * Function : nextRandom
+ * ---------------------------------------------------------------------------------------
+ * Small xorshift generator so that every tree program sees the same key sequences.
+ */
+
+  inline unsigned int nextRandom(unsigned int &state){
+    state ^= state<<13;
+    state ^= state>>17;
+    state ^= state<<5;
+    return state;
+  }
+
+/*
+ * Function : shuffledKeys
+ * ---------------------------------------------------------------------------------------
+ * Fills keys with 0..nKeys-1 in a random order. Inserting keys in this order avoids the
+ * degenerate sorted insertion that the demo programs use.
+ */
+
+  inline void shuffledKeys(vector<int> &keys,int nKeys){
+    unsigned int state = 2463534242u;
+    keys.resize(nKeys);
+    for(int i=0;i<nKeys;i++)
+      keys[i] = i;
+    for(int i=nKeys-1;i>0;i--){
+      int j = nextRandom(state)%(i+1);
+      int temp = keys[i];
+      keys[i] = keys[j];
+      keys[j] = temp;
+    }
+  }
+
+/*
+ * Function : generateAccessSequence
+ * ---------------------------------------------------------------------------------------
+ * Fills accesses with nAccesses keys from 0..nKeys-1 drawn according to pattern. For the
+ * Zipf pattern, ranks are mapped to keys through a fixed permutation so that hot keys
+ * are scattered over the key space rather than being the smallest keys.
+ */
+
+  inline void generateAccessSequence(vector<int> &accesses,int nKeys,int nAccesses,AccessPattern pattern){
+    unsigned int state = 88172645u;
+    accesses.resize(nAccesses);
+    if(pattern==UNIFORM){
+      for(int i=0;i<nAccesses;i++)
+        accesses[i] = nextRandom(state)%nKeys;
+    }else if(pattern==ZIPF){
+      vector<double> cdf(nKeys);
+      double sum = 0;
+      for(int r=0;r<nKeys;r++){
+        sum += 1.0/pow(r+1.0,ZIPF_EXPONENT);
+        cdf[r] = sum;
+      }
+      vector<int> rankToKey;
+      shuffledKeys(rankToKey,nKeys);
+      for(int i=0;i<nAccesses;i++){
+        double u = (nextRandom(state)/4294967296.0)*sum;
+        int low = 0,high = nKeys-1;
+        while(low<high){
+          int mid = (low+high)/2;
+          if(cdf[mid]<u)
+            low = mid+1;
+          else
+            high = mid;
+        }
+        accesses[i] = rankToKey[low];
+      }
+    }else{
+      int window = SLIDING_WINDOW_SIZE<nKeys?SLIDING_WINDOW_SIZE:nKeys;
+      int start = 0;
+      for(int i=0;i<nAccesses;i++){
+        //The window advances by one key every 16 accesses and wraps around at the end.
+        if(i%16==15)
+          start = (start+1)%(nKeys-window+1);
+        accesses[i] = start + nextRandom(state)%window;
+      }
+    }
+  }
+
+/*
+ * Function : patternName
+ * ---------------------------------------------
+ * Returns a printable name for an access pattern.
+ */
+
+  inline const char *patternName(AccessPattern pattern){
+    switch(pattern){
+      case UNIFORM: return "uniform";
+      case ZIPF: return "zipf 0.99";
+      default: return "sliding window";
+    }
+  }
+
+/*
+ * Enum : WorkloadMix
+ * ---------------------------------------------------------------------------------------
+ * Proportions of inserts, lookups and deletes in a generated operation sequence.
+ * INSERT_HEAVY : 70% inserts, 20% lookups, 10% deletes.
+ * LOOKUP_HEAVY : 10% inserts, 80% lookups, 10% deletes.
+ * DELETE_HEAVY : 30% inserts, 30% lookups, 40% deletes.
+ */
+
+  enum WorkloadMix { INSERT_HEAVY, LOOKUP_HEAVY, DELETE_HEAVY };
+
+  enum OperationType { INSERT_OP, LOOKUP_OP, DELETE_OP };
+
+  struct TreeOperation{
+    OperationType type;
+    int key;
+  };
+
+/*
+ * Function : generateOperationMix
+ * ---------------------------------------------------------------------------------------
+ * Fills operations with nOperations operations of the given mix. Keys are uniform over
+ * 0..2*nKeys-1, so that about half of the lookups and deletes miss when the tree starts
+ * out holding nKeys keys.
+ */
+
+  inline void generateOperationMix(vector<TreeOperation> &operations,int nKeys,int nOperations,WorkloadMix mix){
+    unsigned int state = 521288629u;
+    int insertPercent = mix==INSERT_HEAVY?70:(mix==LOOKUP_HEAVY?10:30);
+    int lookupPercent = mix==INSERT_HEAVY?20:(mix==LOOKUP_HEAVY?80:30);
+    operations.resize(nOperations);
+    for(int i=0;i<nOperations;i++){
+      int roll = nextRandom(state)%100;
+      if(roll<insertPercent)
+        operations[i].type = INSERT_OP;
+      else if(roll<insertPercent+lookupPercent)
+        operations[i].type = LOOKUP_OP;
+      else
+        operations[i].type = DELETE_OP;
+      operations[i].key = nextRandom(state)%(2*nKeys);
+    }
+  }
+
+/*
+ * Function : mixName
+ * -------------------------------------------
+ * Returns a printable name for a workload mix.
+ */
+
+  inline const char *mixName(WorkloadMix mix){
+    switch(mix){
+      case INSERT_HEAVY: return "insert-heavy";
+      case LOOKUP_HEAVY: return "lookup-heavy";
+      default: return "delete-heavy";
+    }
+  }
+
+/*
+ * Function : secondsSince
+ * ---------------------------------------------------
+ * Returns the CPU time in seconds elapsed since start.
+ */
+
+  inline double secondsSince(clock_t start){
+    return double(clock()-start)/CLOCKS_PER_SEC;
+  }
+
+#endif
@@ -0,0 +1,363 @@
+/*
+ * File : TreeExport.h
+ * -------------------------------------------------------------------------------------
+ * Output helpers shared by the tree programs. Trees are rendered into a large buffer that
+ * is written out with a few write calls, instead of flushing cout after every node. The
+ * binary tree renderers work on any node type with key, left and right fields, and take
+ * the function that describes one node, so each program keeps its own display format.
+ */
+
+#ifndef _TreeExport_h
+#define _TreeExport_h
+
+/* Including standard libraries */
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+using namespace std;
+
+/*
+ * Class : OutputBuffer
+ * -----------------------------------------------------------------------------------------
+ * Collects text in memory and writes it to a file descriptor when the buffer is full, when
+ * flush is called and when the buffer is destroyed. A buffer can be kept and reused for any
+ * number of renders. Write errors do not stop the program, but are remembered for failed.
+ */
+
+class OutputBuffer{
+
+  public :
+
+  /*
+   * Constructor : OutputBuffer
+   * Usage       : OutputBuffer out(fd);
+   * ---------------------------------------------------------------------------------
+   * Creates a buffer of capacity bytes writing to fd, standard output by default.
+   */
+
+    OutputBuffer(int fd = STDOUT_FILENO,size_t capacity = DEFAULT_CAPACITY);
+    ~OutputBuffer();
+
+  /*
+   * Methods : append,operator<<
+   * Usage   : out<<"Key : "<<key<<'\n';
+   * -------------------------------------------------------------------------------
+   * Add text to the buffer. Integers are formatted by hand, without going through a
+   * stream or printf.
+   */
+
+    void append(const char *data,size_t length);
+    OutputBuffer &operator<<(const char *text);
+    OutputBuffer &operator<<(const string &text);
+    OutputBuffer &operator<<(char c);
+    OutputBuffer &operator<<(int n);
+    OutputBuffer &operator<<(long long n);
+
+  /*
+   * Method : flush
+   * Usage  : out.flush();
+   * -----------------------------------------------------------------------------------------
+   * Writes out whatever the buffer holds. Anything already sent to cout is flushed first, so
+   * that output mixed between cout and the buffer stays in order.
+   */
+
+    void flush();
+
+  /*
+   * Method : failed
+   * Usage  : if(out.failed()) cerr<<"Error : Output was lost"<<endl;
+   * -----------------------------------------------------------------------------------------
+   * Returns true if a write to the file descriptor has failed since the buffer was created,
+   * for instance because the disk is full or the reader of a pipe has gone. The text of the
+   * failed write is dropped; later writes are still attempted.
+   */
+
+    bool failed() const;
+
+  private :
+
+  /* Private constants */
+    static const size_t DEFAULT_CAPACITY = 1<<20;
+
+  /* Private instance variables */
+    int fd;
+    vector<char> buffer;
+    size_t used;
+    bool writeFailed;
+
+  /* Private methods */
+    void writeAll(const char *data,size_t length);
+
+  /* Making copying illegal */
+    OutputBuffer(const OutputBuffer &src);
+    OutputBuffer &operator=(const OutputBuffer &src);
+};
+
+/*
+ * Function : standardOutputBuffer
+ * Usage    : OutputBuffer &out = standardOutputBuffer();
+ * ----------------------------------------------------------------------------
+ * Returns a buffer on standard output shared by all display functions, so that
+ * its memory is allocated once per program.
+ */
+
+  inline OutputBuffer &standardOutputBuffer(){
+    static OutputBuffer out;
+    return out;
+  }
+
+/* Implementation of class OutputBuffer */
+
+  inline OutputBuffer::OutputBuffer(int fd,size_t capacity) : fd(fd),buffer(capacity),used(0),writeFailed(false){
+  }
+
+  inline OutputBuffer::~OutputBuffer(){
+    flush();
+  }
+
+  inline void OutputBuffer::append(const char *data,size_t length){
+    if(used+length>buffer.size()){
+      flush();
+      if(length>buffer.size()){
+        writeAll(data,length);
+        return;
+      }
+    }
+    memcpy(&buffer[used],data,length);
+    used += length;
+  }
+
+  inline OutputBuffer &OutputBuffer::operator<<(const char *text){
+    append(text,strlen(text));
+    return *this;
+  }
+
+  inline OutputBuffer &OutputBuffer::operator<<(const string &text){
+    append(text.data(),text.size());
+    return *this;
+  }
+
+  inline OutputBuffer &OutputBuffer::operator<<(char c){
+    if(used==buffer.size()) flush();
+    buffer[used++] = c;
+    return *this;
+  }
+
+  inline OutputBuffer &OutputBuffer::operator<<(int n){
+    return *this<<(long long)n;
+  }
+
+  inline OutputBuffer &OutputBuffer::operator<<(long long n){
+    char digits[24];
+    int count = 0;
+    unsigned long long value = n<0?0ULL-(unsigned long long)n:n;
+    do{
+      digits[sizeof(digits)-1-count++] = '0'+value%10;
+      value /= 10;
+    }while(value!=0);
+    if(n<0) digits[sizeof(digits)-1-count++] = '-';
+    append(digits+sizeof(digits)-count,count);
+    return *this;
+  }
+
+  inline void OutputBuffer::flush(){
+    cout.flush();
+    fflush(stdout);
+    writeAll(buffer.empty()?NULL:&buffer[0],used);
+    used = 0;
+  }
+
+  inline bool OutputBuffer::failed() const{
+    return writeFailed;
+  }
+
+/*
+ * Private method : writeAll
+ * ---------------------------------------------------------------------------------
+ * Calls write until every byte is written, retrying after interrupts. Any other error
+ * sets writeFailed and drops the rest of the data.
+ */
+
+  inline void OutputBuffer::writeAll(const char *data,size_t length){
+    while(length>0){
+      ssize_t written = write(fd,data,length);
+      if(written<0){
+        if(errno==EINTR) continue;
+        writeFailed = true;
+        return;
+      }
+      data += written;
+      length -= written;
+    }
+  }
+
+/*
+ * Functions : writeJSONString,writeDOTString
+ * Usage     : writeJSONString(out,name.data(),name.size());
+ * ----------------------------------------------------------------------------------
+ * Write text as a quoted string, escaping quotes, backslashes and control characters
+ * as JSON and DOT require.
+ */
+
+  inline void writeJSONString(OutputBuffer &out,const char *text,size_t length){
+    static const char hex[] = "0123456789abcdef";
+    out<<'"';
+    for(size_t i=0;i<length;i++){
+      unsigned char c = text[i];
+      if(c=='"' || c=='\\'){
+        out<<'\\'<<(char)c;
+      }else if(c<0x20){
+        out<<"\\u00"<<hex[c>>4]<<hex[c&15];
+      }else{
+        out<<(char)c;
+      }
+    }
+    out<<'"';
+  }
+
+  inline void writeDOTString(OutputBuffer &out,const char *text,size_t length){
+    out<<'"';
+    for(size_t i=0;i<length;i++){
+      if(text[i]=='"' || text[i]=='\\') out<<'\\';
+      out<<(text[i]=='\n'?' ':text[i]);
+    }
+    out<<'"';
+  }
+
+/*
+ * Function : describeKey
+ * ------------------------------------------------------------------
+ * Default node description for the renderers : just the node's key.
+ */
+
+  template<typename NodeType>
+  void describeKey(OutputBuffer &out,NodeType *node){
+    out<<node->key;
+  }
+
+/*
+ * Functions : renderInOrder,renderPreOrder,renderIndented
+ * Usage     : renderInOrder(out,root,describeNode);
+ * -----------------------------------------------------------------------------------------
+ * Write one line per node, described by describe, in order, in pre order, or in pre order
+ * indented by two spaces per level. All walks use an explicit stack, so degenerate trees
+ * cannot overflow the call stack.
+ */
+
+  template<typename NodeType,typename Describer>
+  void renderInOrder(OutputBuffer &out,NodeType *root,Describer describe){
+    vector<NodeType *> stack;
+    NodeType *node = root;
+    while(node!=NULL || !stack.empty()){
+      while(node!=NULL){
+        stack.push_back(node);
+        node = node->left;
+      }
+      node = stack.back();
+      stack.pop_back();
+      describe(out,node);
+      out<<'\n';
+      node = node->right;
+    }
+  }
+
+  template<typename NodeType,typename Describer>
+  void renderPreOrder(OutputBuffer &out,NodeType *root,Describer describe){
+    if(root==NULL) return;
+    vector<NodeType *> stack;
+    stack.push_back(root);
+    while(!stack.empty()){
+      NodeType *node = stack.back();
+      stack.pop_back();
+      describe(out,node);
+      out<<'\n';
+      if(node->right!=NULL) stack.push_back(node->right);
+      if(node->left!=NULL) stack.push_back(node->left);
+    }
+  }
+
+  template<typename NodeType,typename Describer>
+  void renderIndented(OutputBuffer &out,NodeType *root,Describer describe){
+    if(root==NULL) return;
+    vector<pair<NodeType *,int> > stack;
+    stack.push_back(make_pair(root,0));
+    while(!stack.empty()){
+      NodeType *node = stack.back().first;
+      int depth = stack.back().second;
+      stack.pop_back();
+      for(int i=0;i<depth;i++)
+        out<<"  ";
+      describe(out,node);
+      out<<'\n';
+      if(node->right!=NULL) stack.push_back(make_pair(node->right,depth+1));
+      if(node->left!=NULL) stack.push_back(make_pair(node->left,depth+1));
+    }
+  }
+
+/*
+ * Function : renderJSON
+ * Usage    : renderJSON(out,root);
+ * ----------------------------------------------------------------------------------------
+ * Writes the tree as nested objects {"key":k,"left":...,"right":...}, null for no child.
+ * The stack holds either a subtree still to be written or a piece of text to close one.
+ */
+
+  template<typename NodeType>
+  void renderJSON(OutputBuffer &out,NodeType *root){
+    vector<pair<NodeType *,const char *> > stack;
+    stack.push_back(make_pair(root,(const char *)NULL));
+    while(!stack.empty()){
+      NodeType *node = stack.back().first;
+      const char *text = stack.back().second;
+      stack.pop_back();
+      if(text!=NULL){
+        out<<text;
+      }else if(node==NULL){
+        out<<"null";
+      }else{
+        out<<"{\"key\":"<<node->key<<",\"left\":";
+        stack.push_back(make_pair((NodeType *)NULL,"}"));
+        stack.push_back(make_pair(node->right,(const char *)NULL));
+        stack.push_back(make_pair((NodeType *)NULL,",\"right\":"));
+        stack.push_back(make_pair(node->left,(const char *)NULL));
+      }
+    }
+    out<<'\n';
+  }
+
+/*
+ * Function : renderDOT
+ * Usage    : renderDOT(out,root);
+ * ---------------------------------------------------------------------------------------
+ * Writes the tree as a Graphviz digraph, with nodes named by their keys and edges to left
+ * and right children labelled L and R.
+ */
+
+  template<typename NodeType>
+  void renderDOT(OutputBuffer &out,NodeType *root){
+    out<<"digraph Tree {\n";
+    if(root!=NULL){
+      vector<NodeType *> stack;
+      stack.push_back(root);
+      while(!stack.empty()){
+        NodeType *node = stack.back();
+        stack.pop_back();
+        out<<"  "<<node->key<<";\n";
+        if(node->left!=NULL){
+          out<<"  "<<node->key<<" -> "<<node->left->key<<" [label=\"L\"];\n";
+          stack.push_back(node->left);
+        }
+        if(node->right!=NULL){
+          out<<"  "<<node->key<<" -> "<<node->right->key<<" [label=\"R\"];\n";
+          stack.push_back(node->right);
+        }
+      }
+    }
+    out<<"}\n";
+  }
+
+#endif
@@ -0,0 +1,626 @@
+/*
+ * File : BoundedCache.h
+ * ---------------------------------------------------------------------------------
+ * This file exports BoundedCache, a map that holds at most a fixed number of pairs
+ * and makes room for new ones by evicting old ones, and ConcurrentBoundedCache, a
+ * version that many threads can use at once. The pair to evict is chosen by one of
+ * three policies : least recently used, CLOCK, or S3-FIFO.
+ */
+
+#ifndef BoundedCache_h
+#define BoundedCache_h
+
+#include <mutex>
+#include <stdint.h>
+#include "HashMap.h"
+using namespace std;
+
+/*
+ * Type : CachePolicy
+ * ---------------------------------------------------------------------------------------------
+ * LRU evicts the pair used longest ago. CLOCK gives every pair used since it was last looked at
+ * a second chance, which is close to LRU but makes a hit only set a flag. S3-FIFO keeps new pairs
+ * in a small queue and only moves those used again into the main one, so a burst of keys seen
+ * once, such as a scan, cannot push out the pairs that are used often.
+ */
+
+  enum CachePolicy { LRU, CLOCK, S3FIFO };
+
+/*
+ * Type : CacheStats
+ * ---------------------------------------------------------------------------
+ * Counts of the lookups that found their key, those that did not, the pairs
+ * added and the pairs evicted to make room.
+ */
+
+  struct CacheStats{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t evictions;
+  };
+
+template<typename keyType, typename valueType> class BoundedCache{
+
+  /* The public interface for the BoundedCache class */
+
+  public :
+
+  /*
+   * Constructor : BoundedCache
+   * Usage       : BoundedCache<string,int> cache(10000,S3FIFO);
+   * ----------------------------------------------------------------------------
+   * Initialise an empty cache holding at most capacity pairs, evicting by policy.
+   * Throws if capacity is not positive.
+   */
+
+    BoundedCache(int capacity,CachePolicy policy = LRU);
+
+   /*
+    * Destructor : ~BoundedCache
+    * --------------------------------------------------
+    * Frees any heap memory associated with the cache.
+    */
+
+    ~BoundedCache();
+
+   /*
+    * Methods : size,capacity,stats,resetStats
+    * Usage   : CacheStats counts = cache.stats();
+    * ------------------------------------------------------------------------
+    * Return the number of pairs, the most there can be, and the counters, and
+    * set the counters back to zero.
+    */
+
+    int size() const;
+    int capacity() const;
+    CacheStats stats() const;
+    void resetStats();
+
+   /*
+    * Method : get
+    * Usage  : if(cache.get(key,value)) ...
+    * -------------------------------------------------------------------------------------------
+    * If key is cached, stores its value in value, marks the pair as used and returns true, else
+    * returns false. Either way the lookup is counted as a hit or a miss.
+    */
+
+    bool get(const keyType& key,valueType& value);
+
+   /*
+    * Method : put
+    * Usage  : cache.put(key,value);
+    * -------------------------------------------------------------------------------------------
+    * Stores value for key, marking the pair as used. If key is new and the cache is full, first
+    * evicts a pair chosen by the policy.
+    */
+
+    void put(const keyType& key,const valueType& value);
+
+   /*
+    * Methods : containsKey,remove,clear
+    * Usage   : cache.remove(key);
+    * -------------------------------------------------------------------------------------------
+    * containsKey tells whether key is cached without counting or marking anything. remove drops
+    * the pair of key, if any. clear drops every pair but keeps the counters.
+    */
+
+    bool containsKey(const keyType& key) const;
+    void remove(const keyType& key);
+    void clear();
+
+   /*
+    * Methods : Precomputed hash overloads
+    * Usage   : cache.get(key,value,hash);
+    * ---------------------------------------------------------------------------
+    * Same as the methods above, given hash==HashTraits<keyType>::hash(key), which is the code an
+    * unhardened HashMap uses.
+    */
+
+    bool get(const keyType& key,valueType& value,uint64_t hash);
+    void put(const keyType& key,const valueType& value,uint64_t hash);
+
+  private :
+
+  /*
+   * Representational Notes :
+   * -----------------------------------------------------------------------------------------
+   * The pairs are stored in a HashMap whose values are Entry structures. Besides the value, an
+   * entry holds the hash code of its key and the links that put it in a doubly linked queue.
+   * Cells of a HashMap never move, so the links can point straight into the map, and a hit
+   * allocates nothing; an entry is removed through removeFound, from its own address and hash
+   * code, so it needs no second copy of the key, which for long keys would double their memory
+   * use. frequency counts uses since the policy last looked at the entry : LRU ignores it, CLOCK
+   * uses it as the referenced flag and S3-FIFO counts up to 3.
+   *
+   * LRU and CLOCK use the main queue only, newest at the head. LRU moves an entry to the head on
+   * every use and evicts the tail. CLOCK evicts the tail unless its flag is set, in which case it
+   * clears the flag and moves it to the head, which is the hand of a clock sweeping the entries.
+   *
+   * S3-FIFO adds new entries to the small queue, holding a tenth of the capacity. An entry leaving
+   * the small queue moves to the main queue if it was used while there, or else is evicted and
+   * its hash code remembered in the ghost ring. A new key found in the ghost ring was evicted too
+   * soon, and goes straight to the main queue. Entries leaving the main queue go back to its head
+   * with their count lowered by one while it is above 0. The ghost ring is a circular array of
+   * hash codes, with a HashMap counting how many times each appears in it for quick lookup.
+   */
+
+  /* Private constants */
+    static const int MAX_FREQUENCY = 3;
+    static const int SMALL_QUEUE = 0;
+    static const int MAIN_QUEUE = 1;
+
+  /* Structures for entries and queues */
+    struct Entry{
+      valueType value;
+      uint64_t hash;
+      Entry *prev;
+      Entry *next;
+      int frequency;
+      int queue;
+    };
+
+    struct Queue{
+      Entry *head;
+      Entry *tail;
+      int size;
+    };
+
+  /* Instance variables */
+    HashMap<keyType,Entry> entries;
+    CachePolicy policy;
+    int maxSize;
+    int smallCapacity;
+    Queue queues[2];
+    uint64_t *ghostRing;
+    int ghostCapacity;
+    int ghostNext;
+    int ghostSize;
+    HashMap<uint64_t,int> ghostCounts;
+    CacheStats counters;
+
+  /* Private methods */
+    void touch(Entry *entry);
+    void evict();
+    void erase(Entry *entry);
+    void pushFront(int queue,Entry *entry);
+    void unlink(Entry *entry);
+    void rememberGhost(uint64_t hash);
+    bool isGhost(uint64_t hash) const;
+
+  /* Making copying illegal */
+    BoundedCache(const BoundedCache<keyType,valueType>& cache);
+    BoundedCache<keyType,valueType>& operator=(const BoundedCache<keyType,valueType>& cache);
+};
+
+/*
+ * Implementation Notes : Constructor and Destructor
+ * -------------------------------------------------------------------------------------
+ * The map is sized for a full cache up front, so it never rehashes once warm. Only the
+ * S3-FIFO policy has a ghost ring, as long as the main queue.
+ */
+
+template<typename keyType,typename valueType>
+BoundedCache<keyType,valueType>::BoundedCache(int capacity,CachePolicy policy) : entries(capacity),ghostCounts(1){
+  if(capacity<=0) throw "Error : the capacity of a cache must be positive";
+  this->policy = policy;
+  maxSize = capacity;
+  smallCapacity = capacity/10>0?capacity/10:1;
+  for(int q=0;q<2;q++){
+    queues[q].head = queues[q].tail = NULL;
+    queues[q].size = 0;
+  }
+  ghostCapacity = policy==S3FIFO?capacity-smallCapacity+1:0;
+  ghostRing = ghostCapacity>0?new uint64_t[ghostCapacity]:NULL;
+  ghostNext = ghostSize = 0;
+  if(ghostCapacity>0) ghostCounts.reserve(ghostCapacity);
+  resetStats();
+}
+
+template<typename keyType,typename valueType>
+BoundedCache<keyType,valueType>::~BoundedCache(){
+  delete[] ghostRing;
+}
+
+template<typename keyType,typename valueType>
+int BoundedCache<keyType,valueType>::size() const{
+  return entries.size();
+}
+
+template<typename keyType,typename valueType>
+int BoundedCache<keyType,valueType>::capacity() const{
+  return maxSize;
+}
+
+template<typename keyType,typename valueType>
+CacheStats BoundedCache<keyType,valueType>::stats() const{
+  return counters;
+}
+
+template<typename keyType,typename valueType>
+void BoundedCache<keyType,valueType>::resetStats(){
+  counters.hits = counters.misses = counters.insertions = counters.evictions = 0;
+}
+
+/*
+ * Implementation Notes : get, put
+ * -----------------------------------------------------------------------------------------
+ * Both look the key up once through find, which hands back the entry inside the map cell.
+ * put evicts before inserting, so the cache never holds more than capacity pairs.
+ */
+
+template<typename keyType,typename valueType>
+bool BoundedCache<keyType,valueType>::get(const keyType& key,valueType& value){
+  return get(key,value,entries.hashOf(key));
+}
+
+template<typename keyType,typename valueType>
+bool BoundedCache<keyType,valueType>::get(const keyType& key,valueType& value,uint64_t hash){
+  Entry *entry = entries.find(key,hash);
+  if(entry==NULL){
+    counters.misses++;
+    return false;
+  }
+  counters.hits++;
+  touch(entry);
+  value = entry->value;
+  return true;
+}
+
+template<typename keyType,typename valueType>
+void BoundedCache<keyType,valueType>::put(const keyType& key,const valueType& value){
+  put(key,value,entries.hashOf(key));
+}
+
+template<typename keyType,typename valueType>
+void BoundedCache<keyType,valueType>::put(const keyType& key,const valueType& value,uint64_t hash){
+  Entry *entry = entries.find(key,hash);
+  if(entry!=NULL){
+    entry->value = value;
+    touch(entry);
+    return;
+  }
+  if(entries.size()>=maxSize) evict();
+  entry = &entries.getOrInsert(key,hash);
+  entry->value = value;
+  entry->hash = hash;
+  entry->frequency = 0;
+  pushFront(policy==S3FIFO && !isGhost(hash)?SMALL_QUEUE:MAIN_QUEUE,entry);
+  counters.insertions++;
+}
+
+template<typename keyType,typename valueType>
+bool BoundedCache<keyType,valueType>::containsKey(const keyType& key) const{
+  return entries.containsKey(key);
+}
+
+template<typename keyType,typename valueType>
+void BoundedCache<keyType,valueType>::remove(const keyType& key){
+  Entry *entry = entries.find(key);
+  if(entry!=NULL) erase(entry);
+}
+
+template<typename keyType,typename valueType>
+void BoundedCache<keyType,valueType>::clear(){
+  entries.clear();
+  for(int q=0;q<2;q++){
+    queues[q].head = queues[q].tail = NULL;
+    queues[q].size = 0;
+  }
+  ghostNext = ghostSize = 0;
+  ghostCounts.clear();
+}
+
+/*
+ * Implementation Notes : touch
+ * ------------------------------------------------------------------
+ * Records a use of entry in the way its policy needs, in O(1) time.
+ */
+
+template<typename keyType,typename valueType>
+void BoundedCache<keyType,valueType>::touch(Entry *entry){
+  if(policy==LRU){
+    unlink(entry);
+    pushFront(MAIN_QUEUE,entry);
+  }else if(policy==CLOCK){
+    entry->frequency = 1;
+  }else if(entry->frequency<MAX_FREQUENCY){
+    entry->frequency++;
+  }
+}
+
+/*
+ * Implementation Notes : evict
+ * --------------------------------------------------------------------------------------------
+ * Evicts exactly one entry. CLOCK and S3-FIFO may first move entries that earned another chance;
+ * each move lowers a count that never rises during the call, so the loop ends. Amortised O(1).
+ */
+
+template<typename keyType,typename valueType>
+void BoundedCache<keyType,valueType>::evict(){
+  Queue& smallQueue = queues[SMALL_QUEUE];
+  Queue& mainQueue = queues[MAIN_QUEUE];
+  while(true){
+    if(policy==S3FIFO && (smallQueue.size>=smallCapacity || mainQueue.size==0)){
+      Entry *entry = smallQueue.tail;
+      if(entry->frequency>0){
+        unlink(entry);
+        entry->frequency = 0;
+        pushFront(MAIN_QUEUE,entry);
+        continue;
+      }
+      rememberGhost(entry->hash);
+      erase(entry);
+      break;
+    }
+    Entry *entry = mainQueue.tail;
+    if(policy!=LRU && entry->frequency>0){
+      unlink(entry);
+      entry->frequency--;
+      pushFront(MAIN_QUEUE,entry);
+      continue;
+    }
+    erase(entry);
+    break;
+  }
+  counters.evictions++;
+}
+
+/*
+ * Implementation Notes : erase, pushFront, unlink
+ * -------------------------------------------------------------------------------------
+ * erase takes the entry off its queue and out of the map, which frees it, using the hash
+ * code stored in it so that the key is neither needed nor hashed again.
+ */
+
+template<typename keyType,typename valueType>
+void BoundedCache<keyType,valueType>::erase(Entry *entry){
+  unlink(entry);
+  entries.removeFound(entry,entry->hash);
+}
+
+template<typename keyType,typename valueType>
+void BoundedCache<keyType,valueType>::pushFront(int queue,Entry *entry){
+  Queue& q = queues[queue];
+  entry->queue = queue;
+  entry->prev = NULL;
+  entry->next = q.head;
+  if(q.head!=NULL) q.head->prev = entry;
+  else q.tail = entry;
+  q.head = entry;
+  q.size++;
+}
+
+template<typename keyType,typename valueType>
+void BoundedCache<keyType,valueType>::unlink(Entry *entry){
+  Queue& q = queues[entry->queue];
+  if(entry->prev!=NULL) entry->prev->next = entry->next;
+  else q.head = entry->next;
+  if(entry->next!=NULL) entry->next->prev = entry->prev;
+  else q.tail = entry->prev;
+  q.size--;
+}
+
+/*
+ * Implementation Notes : rememberGhost, isGhost
+ * -----------------------------------------------------------------------------------------
+ * When the ring is full the oldest hash code is overwritten, and its count lowered. A ghost
+ * is matched by hash code alone; a rare false match only sends a key to the main queue.
+ */
+
+template<typename keyType,typename valueType>
+void BoundedCache<keyType,valueType>::rememberGhost(uint64_t hash){
+  if(ghostSize==ghostCapacity){
+    uint64_t oldest = ghostRing[ghostNext];
+    int *count = ghostCounts.find(oldest);
+    if(--*count==0) ghostCounts.remove(oldest);
+  }else{
+    ghostSize++;
+  }
+  ghostRing[ghostNext] = hash;
+  ghostNext = (ghostNext+1)%ghostCapacity;
+  ghostCounts.getOrInsert(hash)++;
+}
+
+template<typename keyType,typename valueType>
+bool BoundedCache<keyType,valueType>::isGhost(uint64_t hash) const{
+  return ghostCounts.containsKey(hash);
+}
+
+template<typename keyType, typename valueType> class ConcurrentBoundedCache{
+
+  /* The public interface for the ConcurrentBoundedCache class */
+
+  public :
+
+  /*
+   * Constructor : ConcurrentBoundedCache
+   * Usage       : ConcurrentBoundedCache<string,int> cache(1000000,S3FIFO,64);
+   * -------------------------------------------------------------------------------------------
+   * Initialise an empty cache holding at most capacity pairs, split evenly between nShards
+   * BoundedCache shards, rounded up to a power of two, each with its own lock. Threads only wait
+   * for each other when their keys fall in the same shard. Eviction is decided per shard, so the
+   * pair evicted is the one the policy picks among its shard, not the whole cache.
+   */
+
+    ConcurrentBoundedCache(int capacity,CachePolicy policy = LRU,int nShards = 16);
+
+   /*
+    * Destructor : ~ConcurrentBoundedCache
+    * --------------------------------------------------
+    * Frees any heap memory associated with the cache.
+    */
+
+    ~ConcurrentBoundedCache();
+
+   /*
+    * Methods : get,put,containsKey,remove,clear
+    * Usage   : if(cache.get(key,value)) ...
+    * ----------------------------------------------------------------------------------------
+    * Same as the methods of BoundedCache, and safe to call from several threads at once.
+    */
+
+    bool get(const keyType& key,valueType& value);
+    void put(const keyType& key,const valueType& value);
+    bool containsKey(const keyType& key) const;
+    void remove(const keyType& key);
+    void clear();
+
+   /*
+    * Methods : size,capacity,stats,resetStats
+    * Usage   : CacheStats counts = cache.stats();
+    * ---------------------------------------------------------------------------------
+    * Same as for BoundedCache, summed over the shards one at a time, so while threads
+    * are using the cache the totals may mix shard values read at different moments.
+    */
+
+    int size() const;
+    int capacity() const;
+    CacheStats stats() const;
+    void resetStats();
+
+  private :
+
+  /*
+   * Representational Notes :
+   * -------------------------------------------------------------------------------------
+   * Each shard is a mutex and a BoundedCache, aligned to a cache line so that locks of
+   * neighbouring shards do not share one. The top bits of a key's hash code choose its
+   * shard, and the hash code is passed on so the shard does not compute it again.
+   */
+
+  /* Structure for a shard */
+    struct alignas(64) Shard{
+      mutable mutex lock;
+      BoundedCache<keyType,valueType> *cache;
+    };
+
+  /* Instance variables */
+    Shard *shards;
+    int nShards;
+    int shardBits;
+    int maxSize;
+
+  /* Private methods */
+    Shard& shardOf(uint64_t hash) const;
+
+  /* Making copying illegal */
+    ConcurrentBoundedCache(const ConcurrentBoundedCache<keyType,valueType>& cache);
+    ConcurrentBoundedCache<keyType,valueType>& operator=(const ConcurrentBoundedCache<keyType,valueType>& cache);
+};
+
+/*
+ * Implementation Notes : ConcurrentBoundedCache
+ * ------------------------------------------------------------------------------------------
+ * The first capacity%nShards shards get one extra pair, so the shard capacities add up to
+ * capacity. There are never more shards than pairs, so each shard holds at least one.
+ */
+
+template<typename keyType,typename valueType>
+ConcurrentBoundedCache<keyType,valueType>::ConcurrentBoundedCache(int capacity,CachePolicy policy,int nShards){
+  if(capacity<=0) throw "Error : the capacity of a cache must be positive";
+  maxSize = capacity;
+  shardBits = shardBitsFor(nShards);
+  while((1<<shardBits)>capacity)
+    shardBits--;
+  this->nShards = 1<<shardBits;
+  shards = new Shard[this->nShards];
+  for(int i=0;i<this->nShards;i++)
+    shards[i].cache = new BoundedCache<keyType,valueType>(capacity/this->nShards+(i<capacity%this->nShards),policy);
+}
+
+template<typename keyType,typename valueType>
+ConcurrentBoundedCache<keyType,valueType>::~ConcurrentBoundedCache(){
+  for(int i=0;i<nShards;i++)
+    delete shards[i].cache;
+  delete[] shards;
+}
+
+template<typename keyType,typename valueType>
+bool ConcurrentBoundedCache<keyType,valueType>::get(const keyType& key,valueType& value){
+  uint64_t hash = HashTraits<keyType>::hash(key);
+  Shard& shard = shardOf(hash);
+  lock_guard<mutex> guard(shard.lock);
+  return shard.cache->get(key,value,hash);
+}
+
+template<typename keyType,typename valueType>
+void ConcurrentBoundedCache<keyType,valueType>::put(const keyType& key,const valueType& value){
+  uint64_t hash = HashTraits<keyType>::hash(key);
+  Shard& shard = shardOf(hash);
+  lock_guard<mutex> guard(shard.lock);
+  shard.cache->put(key,value,hash);
+}
+
+template<typename keyType,typename valueType>
+bool ConcurrentBoundedCache<keyType,valueType>::containsKey(const keyType& key) const{
+  Shard& shard = shardOf(HashTraits<keyType>::hash(key));
+  lock_guard<mutex> guard(shard.lock);
+  return shard.cache->containsKey(key);
+}
+
+template<typename keyType,typename valueType>
+void ConcurrentBoundedCache<keyType,valueType>::remove(const keyType& key){
+  Shard& shard = shardOf(HashTraits<keyType>::hash(key));
+  lock_guard<mutex> guard(shard.lock);
+  shard.cache->remove(key);
+}
+
+template<typename keyType,typename valueType>
+void ConcurrentBoundedCache<keyType,valueType>::clear(){
+  for(int i=0;i<nShards;i++){
+    lock_guard<mutex> guard(shards[i].lock);
+    shards[i].cache->clear();
+  }
+}
+
+template<typename keyType,typename valueType>
+int ConcurrentBoundedCache<keyType,valueType>::size() const{
+  int total = 0;
+  for(int i=0;i<nShards;i++){
+    lock_guard<mutex> guard(shards[i].lock);
+    total += shards[i].cache->size();
+  }
+  return total;
+}
+
+template<typename keyType,typename valueType>
+int ConcurrentBoundedCache<keyType,valueType>::capacity() const{
+  return maxSize;
+}
+
+template<typename keyType,typename valueType>
+CacheStats ConcurrentBoundedCache<keyType,valueType>::stats() const{
+  CacheStats total = {0,0,0,0};
+  for(int i=0;i<nShards;i++){
+    lock_guard<mutex> guard(shards[i].lock);
+    CacheStats counts = shards[i].cache->stats();
+    total.hits += counts.hits;
+    total.misses += counts.misses;
+    total.insertions += counts.insertions;
+    total.evictions += counts.evictions;
+  }
+  return total;
+}
+
+template<typename keyType,typename valueType>
+void ConcurrentBoundedCache<keyType,valueType>::resetStats(){
+  for(int i=0;i<nShards;i++){
+    lock_guard<mutex> guard(shards[i].lock);
+    shards[i].cache->resetStats();
+  }
+}
+
+/*
+ * Implementation Notes : shardOf
+ * ---------------------------------------------------------------------------------
+ * Takes the top bits of the hash code, through topBits, as the HashMap inside each shard
+ * uses the low bits for its buckets.
+ */
+
+template<typename keyType,typename valueType>
+typename ConcurrentBoundedCache<keyType,valueType>::Shard& ConcurrentBoundedCache<keyType,valueType>::shardOf(uint64_t hash) const{
+  return shards[topBits(hash,shardBits)];
+}
+
+#endif
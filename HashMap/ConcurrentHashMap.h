@@ -0,0 +1,483 @@
+/*
+ * File : ConcurrentHashMap.h
+ * ---------------------------------------------------------------------------------
+ * This file exports a templatized hashmap that many threads can use at once. The key
+ * space is split into shards, each an independent table with its own lock, so writers
+ * only wait for writers of the same shard, and readers of small key and value types
+ * take no lock at all. Only allows unique keys.
+ */
+
+#ifndef ConcurrentHashMap_h
+#define ConcurrentHashMap_h
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <type_traits>
+#include "hashfunctions.h"
+#include "hashfunctions.cpp"
+#include "linearprobing.h"
+using namespace std;
+
+template<typename keyType, typename valueType> class ConcurrentHashMap{
+
+  /* The public interface for the ConcurrentHashMap class */
+
+  public :
+
+  /*
+   * Constructors : ConcurrentHashMap
+   * Usage        : ConcurrentHashMap<int,int> map(64);
+   * -------------------------------------------------------------------------------------
+   * Initialise an empty map with nShards shards, rounded up to a power of two. More shards
+   * than writer threads keep two writers from meeting on the same lock most of the time.
+   */
+
+    ConcurrentHashMap(int nShards = DEFAULT_SHARDS);
+
+   /*
+    * Destructor : ~ConcurrentHashMap
+    * ---------------------------------------------------------------------------
+    * Frees any heap memory associated with the map. No thread may be using it.
+    */
+
+    ~ConcurrentHashMap();
+
+   /*
+    * Method : size
+    * Usage  : int n = map.size();
+    * ---------------------------------------------------------------------------------
+    * Returns the number of key value pairs. While other threads write, the count of each
+    * shard is exact but the total may mix counts taken at slightly different times.
+    */
+
+    int size() const;
+
+   /*
+    * Methods : get,tryGet,containsKey
+    * Usage   : if(map.tryGet(key,value)) ...
+    * ---------------------------------------------------------------------------------------
+    * get returns the value stored for key, or valueType() if key is absent. tryGet stores
+    * the value in value and returns true if key is present, and returns false otherwise, so
+    * that an absent key can be told apart from a stored valueType(). Safe to call while other
+    * threads write; the result is the state of the map at some moment during the call.
+    */
+
+    valueType get(const keyType& key) const;
+    bool tryGet(const keyType& key,valueType& value) const;
+    bool containsKey(const keyType& key) const;
+
+   /*
+    * Methods : put,remove,clear
+    * Usage   : map.put(key,value);
+    * ----------------------------------------------------------------------------------------
+    * put inserts the key value pair, overwriting any value stored for key. remove deletes the
+    * pair of key, if any. clear deletes every pair, one shard at a time.
+    */
+
+    void put(const keyType& key,const valueType& value);
+    void remove(const keyType& key);
+    void clear();
+
+   /*
+    * Method : forEach
+    * Usage  : map.forEach(printPair);
+    * ----------------------------------------------------------------------------------------
+    * Calls function(key,value) for every pair. Each shard is copied under its lock, then the
+    * function is called on the copy with no lock held, so it may use the map itself. Pairs of
+    * one shard are a consistent snapshot; different shards are snapshotted at different times.
+    */
+
+    template<typename Function> void forEach(Function function) const;
+
+  private :
+
+  /*
+   * Representational Notes :
+   * -----------------------------------------------------------------------------------------
+   * The top bits of a key's hash code choose its shard and the low bits its slot. A shard is
+   * an open addressing table with linear probing : a key sits in the first free slot at or
+   * after its home slot, and removal shifts later keys of the same run back, so no tombstones
+   * are needed. A slot whose hash field is 0 is free; a real hash code of 0 is changed to 1.
+   *
+   * Writers of a shard take its mutex and make the shard's sequence number odd while they
+   * change anything (a seqlock). When keys and values can be copied as plain bytes, readers
+   * take no lock : they note the sequence number, search the table, and start again if the
+   * number was odd or has changed, since a writer may have been halfway through. A table that
+   * is replaced by a larger one is kept until the map is destroyed rather than freed, so a
+   * reader still searching it never touches freed memory; as tables only double, and clear
+   * empties the current table in place, the old ones together are never bigger than the
+   * current one. Other key and value types, such as strings, could be torn apart by a
+   * concurrent writer while being copied, so their readers take the shard's mutex instead.
+   *
+   * The hash field of a slot is atomic, read and written with relaxed ordering, so a reader
+   * always sees a whole code and the sequence number alone orders everything else. The key
+   * and value fields are plain, and an optimistic read of them while a writer changes them
+   * is formally a data race, which tools such as ThreadSanitizer report : it is the race
+   * every seqlock has, and the value read is thrown away unless the sequence number shows
+   * that no writer ran, which is safe on the machines and compilers this code targets.
+   */
+
+  /* Private constants */
+    static const int DEFAULT_SHARDS = 64;
+    static const int INITIAL_SLOTS = 16;
+    static const bool OPTIMISTIC_READS = is_trivially_copyable<keyType>::value &&
+                                         is_trivially_copyable<valueType>::value;
+
+  /* Structures for slots, tables and shards */
+    struct Slot{
+      atomic<uint64_t> hash;
+      keyType key;
+      valueType value;
+    };
+
+    struct Table{
+      size_t mask;
+      Slot *slots;
+    };
+
+    struct alignas(64) Shard{
+      mutable mutex lock;
+      atomic<unsigned> sequence;
+      atomic<Table *> table;
+      atomic<int> count;
+      vector<Table *> retired;
+    };
+
+  /* Instance variables */
+    Shard *shards;
+    int nShards;
+    int shardBits;
+
+  /* Private methods */
+    static uint64_t hashOf(const keyType& key);
+    Shard& shardOf(uint64_t hash) const;
+    static Table *newTable(size_t nSlots);
+    static void deleteTable(Table *table);
+    static bool findSlot(const Table *table,uint64_t hash,const keyType& key,size_t& index);
+    static void beginWrite(Shard& shard);
+    static void endWrite(Shard& shard);
+    static void insertSlot(Table *table,uint64_t hash,const keyType& key,const valueType& value);
+    static void eraseSlot(Table *table,size_t index);
+    static void freeSlot(Slot& slot);
+    static void grow(Shard& shard);
+
+  /* Making copying illegal */
+    ConcurrentHashMap(const ConcurrentHashMap<keyType,valueType>& map);
+    ConcurrentHashMap<keyType,valueType>& operator=(const ConcurrentHashMap<keyType,valueType>& map);
+};
+
+/*
+ * Implementation Notes : Constructor and Destructor
+ * ----------------------------------------------------------------------------------------
+ * shardBits is the number of top hash bits that pick a shard, 0 when there is a single
+ * shard.
+ */
+
+template<typename keyType,typename valueType>
+ConcurrentHashMap<keyType,valueType>::ConcurrentHashMap(int nShards){
+  shardBits = shardBitsFor(nShards);
+  this->nShards = 1<<shardBits;
+  shards = new Shard[this->nShards];
+  for(int i=0;i<this->nShards;i++){
+    shards[i].sequence.store(0);
+    shards[i].table.store(newTable(INITIAL_SLOTS));
+    shards[i].count.store(0);
+  }
+}
+
+template<typename keyType,typename valueType>
+ConcurrentHashMap<keyType,valueType>::~ConcurrentHashMap(){
+  for(int i=0;i<nShards;i++){
+    deleteTable(shards[i].table.load());
+    for(size_t t=0;t<shards[i].retired.size();t++)
+      deleteTable(shards[i].retired[t]);
+  }
+  delete[] shards;
+}
+
+/*
+ * Implementation Notes : size
+ * ----------------------------------------------------------------
+ * Adds up the shard counts, which writers update under their lock.
+ */
+
+template<typename keyType,typename valueType>
+int ConcurrentHashMap<keyType,valueType>::size() const{
+  int total = 0;
+  for(int i=0;i<nShards;i++)
+    total += shards[i].count.load(memory_order_relaxed);
+  return total;
+}
+
+/*
+ * Implementation Notes : get, tryGet, containsKey
+ * ------------------------------------------------------------------------------------------
+ * The optimistic read copies the value out of the table before checking the sequence number
+ * again, as the slot may change as soon as the check passes. The acquire fence keeps the
+ * reads of the table from moving after that second load.
+ */
+
+template<typename keyType,typename valueType>
+valueType ConcurrentHashMap<keyType,valueType>::get(const keyType& key) const{
+  valueType value = valueType();
+  tryGet(key,value);
+  return value;
+}
+
+template<typename keyType,typename valueType>
+bool ConcurrentHashMap<keyType,valueType>::tryGet(const keyType& key,valueType& value) const{
+  uint64_t hash = hashOf(key);
+  Shard& shard = shardOf(hash);
+  size_t index;
+  if(!OPTIMISTIC_READS){
+    lock_guard<mutex> guard(shard.lock);
+    const Table *table = shard.table.load(memory_order_relaxed);
+    if(!findSlot(table,hash,key,index)) return false;
+    value = table->slots[index].value;
+    return true;
+  }
+  while(true){
+    unsigned before = shard.sequence.load(memory_order_acquire);
+    if(before&1){
+      this_thread::yield();
+      continue;
+    }
+    const Table *table = shard.table.load(memory_order_acquire);
+    bool found = findSlot(table,hash,key,index);
+    valueType copy = found?table->slots[index].value:valueType();
+    atomic_thread_fence(memory_order_acquire);
+    if(shard.sequence.load(memory_order_relaxed)==before){
+      if(found) value = copy;
+      return found;
+    }
+  }
+}
+
+template<typename keyType,typename valueType>
+bool ConcurrentHashMap<keyType,valueType>::containsKey(const keyType& key) const{
+  valueType value;
+  return tryGet(key,value);
+}
+
+/*
+ * Implementation Notes : put, remove, clear
+ * ------------------------------------------------------------------------------------------
+ * Every change to a shard happens between beginWrite and endWrite, with the shard's mutex
+ * held. put grows the shard's table first when one more key would fill more than 70% of it.
+ * clear frees every slot of each table in place, keeping its size, rather than retiring the
+ * table; readers searching it meanwhile start again, as the sequence number changes.
+ */
+
+template<typename keyType,typename valueType>
+void ConcurrentHashMap<keyType,valueType>::put(const keyType& key,const valueType& value){
+  uint64_t hash = hashOf(key);
+  Shard& shard = shardOf(hash);
+  lock_guard<mutex> guard(shard.lock);
+  Table *table = shard.table.load(memory_order_relaxed);
+  size_t index;
+  beginWrite(shard);
+  if(findSlot(table,hash,key,index)){
+    table->slots[index].value = value;
+  }else{
+    int count = shard.count.load(memory_order_relaxed);
+    if((size_t)(count+1)*10>(table->mask+1)*7){
+      grow(shard);
+      table = shard.table.load(memory_order_relaxed);
+    }
+    insertSlot(table,hash,key,value);
+    shard.count.store(count+1,memory_order_relaxed);
+  }
+  endWrite(shard);
+}
+
+template<typename keyType,typename valueType>
+void ConcurrentHashMap<keyType,valueType>::remove(const keyType& key){
+  uint64_t hash = hashOf(key);
+  Shard& shard = shardOf(hash);
+  lock_guard<mutex> guard(shard.lock);
+  Table *table = shard.table.load(memory_order_relaxed);
+  size_t index;
+  if(!findSlot(table,hash,key,index)) return;
+  beginWrite(shard);
+  eraseSlot(table,index);
+  shard.count.store(shard.count.load(memory_order_relaxed)-1,memory_order_relaxed);
+  endWrite(shard);
+}
+
+template<typename keyType,typename valueType>
+void ConcurrentHashMap<keyType,valueType>::clear(){
+  for(int i=0;i<nShards;i++){
+    Shard& shard = shards[i];
+    lock_guard<mutex> guard(shard.lock);
+    Table *table = shard.table.load(memory_order_relaxed);
+    beginWrite(shard);
+    for(size_t s=0;s<=table->mask;s++){
+      if(table->slots[s].hash.load(memory_order_relaxed)!=0)
+        freeSlot(table->slots[s]);
+    }
+    shard.count.store(0,memory_order_relaxed);
+    endWrite(shard);
+  }
+}
+
+/*
+ * Implementation Notes : forEach
+ * ------------------------------------------------------------------------------
+ * Reuses one vector for the snapshots of all shards, so it is allocated once per
+ * call rather than once per shard.
+ */
+
+template<typename keyType,typename valueType> template<typename Function>
+void ConcurrentHashMap<keyType,valueType>::forEach(Function function) const{
+  vector<pair<keyType,valueType> > snapshot;
+  for(int i=0;i<nShards;i++){
+    snapshot.clear();
+    {
+      lock_guard<mutex> guard(shards[i].lock);
+      const Table *table = shards[i].table.load(memory_order_relaxed);
+      for(size_t s=0;s<=table->mask;s++){
+        if(table->slots[s].hash.load(memory_order_relaxed)!=0)
+          snapshot.push_back(make_pair(table->slots[s].key,table->slots[s].value));
+      }
+    }
+    for(size_t p=0;p<snapshot.size();p++)
+      function(snapshot[p].first,snapshot[p].second);
+  }
+}
+
+/*
+ * Implementation Notes : hashOf, shardOf
+ * ----------------------------------------------------------------------------------
+ * Hash codes of 0 become 1, as 0 marks a free slot. The shard comes from the top bits of
+ * the code, through topBits, and the slot within it from the low bits.
+ */
+
+template<typename keyType,typename valueType>
+uint64_t ConcurrentHashMap<keyType,valueType>::hashOf(const keyType& key){
+  uint64_t hash = HashTraits<keyType>::hash(key);
+  return hash==0?1:hash;
+}
+
+template<typename keyType,typename valueType>
+typename ConcurrentHashMap<keyType,valueType>::Shard& ConcurrentHashMap<keyType,valueType>::shardOf(uint64_t hash) const{
+  return shards[topBits(hash,shardBits)];
+}
+
+/*
+ * Implementation Notes : newTable, deleteTable
+ * ---------------------------------------------------------------------
+ * nSlots is a power of two. Value initialisation zeroes the hash fields.
+ */
+
+template<typename keyType,typename valueType>
+typename ConcurrentHashMap<keyType,valueType>::Table *ConcurrentHashMap<keyType,valueType>::newTable(size_t nSlots){
+  Table *table = new Table;
+  table->mask = nSlots-1;
+  table->slots = new Slot[nSlots]();
+  return table;
+}
+
+template<typename keyType,typename valueType>
+void ConcurrentHashMap<keyType,valueType>::deleteTable(Table *table){
+  delete[] table->slots;
+  delete table;
+}
+
+/*
+ * Implementation Notes : findSlot
+ * ---------------------------------------------------------------------------------------
+ * Probes from the home slot until the key or a free slot is found. Stops after a full turn
+ * as well, which can only happen to an optimistic reader seeing a table being changed; the
+ * sequence check then makes it start again.
+ */
+
+template<typename keyType,typename valueType>
+bool ConcurrentHashMap<keyType,valueType>::findSlot(const Table *table,uint64_t hash,const keyType& key,size_t& index){
+  size_t mask = table->mask;
+  size_t i = hash&mask;
+  for(size_t probes=0;probes<=mask;probes++){
+    const Slot& slot = table->slots[i];
+    uint64_t slotHash = slot.hash.load(memory_order_relaxed);
+    if(slotHash==0) return false;
+    if(slotHash==hash && slot.key==key){
+      index = i;
+      return true;
+    }
+    i = (i+1)&mask;
+  }
+  return false;
+}
+
+/*
+ * Implementation Notes : beginWrite, endWrite
+ * ------------------------------------------------------------------------------------
+ * Make the sequence number odd, then even again. The release fence keeps the changes
+ * from becoming visible before the number is odd; the release store, before it is even.
+ */
+
+template<typename keyType,typename valueType>
+void ConcurrentHashMap<keyType,valueType>::beginWrite(Shard& shard){
+  shard.sequence.store(shard.sequence.load(memory_order_relaxed)+1,memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+}
+
+template<typename keyType,typename valueType>
+void ConcurrentHashMap<keyType,valueType>::endWrite(Shard& shard){
+  shard.sequence.store(shard.sequence.load(memory_order_relaxed)+1,memory_order_release);
+}
+
+/*
+ * Implementation Notes : insertSlot, eraseSlot, freeSlot
+ * -----------------------------------------------------------------------------------------
+ * Called only inside a write section of the shard. insertSlot fills in the key and value
+ * before the hash, and closeGap moves the hash last, so a slot only looks used once its key
+ * is in place; a reader that still sees a half moved slot fails its sequence check. freeSlot
+ * also resets the key and value, so that a string or other owner of memory in a free slot
+ * does not hold on to it.
+ */
+
+template<typename keyType,typename valueType>
+void ConcurrentHashMap<keyType,valueType>::insertSlot(Table *table,uint64_t hash,const keyType& key,const valueType& value){
+  Slot& slot = table->slots[probeFreeSlot(table->slots,table->mask,hash)];
+  slot.key = key;
+  slot.value = value;
+  slot.hash.store(hash,memory_order_relaxed);
+}
+
+template<typename keyType,typename valueType>
+void ConcurrentHashMap<keyType,valueType>::eraseSlot(Table *table,size_t index){
+  freeSlot(table->slots[closeGap(table->slots,table->mask,index)]);
+}
+
+template<typename keyType,typename valueType>
+void ConcurrentHashMap<keyType,valueType>::freeSlot(Slot& slot){
+  slot.hash.store(0,memory_order_relaxed);
+  slot.key = keyType();
+  slot.value = valueType();
+}
+
+/*
+ * Implementation Notes : grow
+ * -----------------------------------------------------------------------------------
+ * Copies every key into a table twice the size, publishes it and retires the old one.
+ * Called inside a write section, so no reader can accept a result read during the copy.
+ */
+
+template<typename keyType,typename valueType>
+void ConcurrentHashMap<keyType,valueType>::grow(Shard& shard){
+  Table *oldTable = shard.table.load(memory_order_relaxed);
+  Table *table = newTable(2*(oldTable->mask+1));
+  for(size_t i=0;i<=oldTable->mask;i++){
+    const Slot& slot = oldTable->slots[i];
+    uint64_t hash = slot.hash.load(memory_order_relaxed);
+    if(hash!=0)
+      insertSlot(table,hash,slot.key,slot.value);
+  }
+  shard.table.store(table,memory_order_release);
+  shard.retired.push_back(oldTable);
+}
+
+#endif
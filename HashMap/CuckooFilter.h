@@ -0,0 +1,254 @@
+/*
+ * File : CuckooFilter.h
+ * ---------------------------------------------------------------------------------
+ * This file exports a cuckoo filter : a compact summary of a set of hash codes that
+ * answers "certainly absent" or "maybe present". It is never wrong about an absent
+ * answer, and says "maybe" for a hash code that was never added only at a small,
+ * configurable rate. Unlike a Bloom filter it supports removal. HashMap can keep one
+ * in front of its buckets, so that most lookups of absent keys read a single cache
+ * line instead of a chain.
+ */
+
+#ifndef CuckooFilter_h
+#define CuckooFilter_h
+
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+#include <stdint.h>
+using namespace std;
+
+class CuckooFilter{
+
+  /* The public interface for the CuckooFilter class */
+
+  public :
+
+  /*
+   * Constructor : CuckooFilter
+   * Usage       : CuckooFilter filter(1000000,0.01);
+   * -------------------------------------------------------------------------------------------
+   * Initialise an empty filter sized for capacity hash codes, answering "maybe" for absent ones
+   * at about falsePositiveRate. Rates below about 1 in 4000 are rounded up to that. Holding more
+   * than capacity codes still works, but the false positive rate rises.
+   */
+
+    CuckooFilter(uint64_t capacity,double falsePositiveRate);
+
+   /*
+    * Destructor : ~CuckooFilter
+    * --------------------------------------------------
+    * Frees any heap memory associated with the filter.
+    */
+
+    ~CuckooFilter();
+
+   /*
+    * Methods : insert,remove,mayContain
+    * Usage   : if(!filter.mayContain(hash)) return NULL;
+    * -------------------------------------------------------------------------------------------
+    * insert adds a hash code; adding it twice keeps two copies. remove deletes one copy of a hash
+    * code that was inserted, and returns false if none is found; removing a code that was never
+    * inserted may remove another's and cause false negatives. mayContain returns false only if
+    * hash is certainly not in the filter.
+    */
+
+    void insert(uint64_t hash);
+    bool remove(uint64_t hash);
+    bool mayContain(uint64_t hash) const;
+
+   /*
+    * Methods : clear,memoryUsage
+    * Usage   : filter.clear();
+    * ----------------------------------------------------------------------
+    * clear empties the filter. memoryUsage returns its size in bytes.
+    */
+
+    void clear();
+    size_t memoryUsage() const;
+
+  private :
+
+  /*
+   * Representational Notes :
+   * -----------------------------------------------------------------------------------------
+   * The filter is an array of 64 byte blocks, as many as keep them 40% full at capacity, each
+   * aligned to a cache line and holding 8 buckets of 4 sixteen bit slots. A hash code picks a
+   * block from its high bits, a bucket in the block, and a fingerprint of up to 15 bits from its
+   * low bits; 0 marks a free slot, so a fingerprint of 0 is stored as 1. The code may sit in its
+   * first bucket or in the other bucket of the same block found by xoring the first with a number
+   * from 1 to 7 derived from the fingerprint, so each one can be found again from the fingerprint
+   * alone. Inserting into two full buckets evicts a fingerprint to its other bucket, and so on up
+   * to MAX_KICKS times.
+   *
+   * Keeping both buckets in one block is what lets a lookup read a single cache line, and the
+   * 8 slots it compares are contiguous runs that compilers turn into vector compares. The price
+   * is that fingerprints cannot leave their block, so the filter is sized to keep blocks under
+   * half full. If a block still overflows, the fingerprint left over is dropped and the top bit
+   * of the block's first slot is set, after which every lookup in that block answers "maybe";
+   * there are never false negatives.
+   *
+   * A lookup compares against the 8 slots of two buckets, so with f bit fingerprints a false
+   * positive happens about 8 times in 2^f; the constructor picks the smallest f that meets the
+   * requested rate.
+   */
+
+  /* Private constants */
+    static const int SLOTS_PER_BUCKET = 4;
+    static const int SLOTS_PER_BLOCK = 32;
+    static const uint16_t OVERFLOW_BIT = 0x8000;
+    static const int MAX_FINGERPRINT_BITS = 15;
+    static const int MIN_FINGERPRINT_BITS = 4;
+    static const int MAX_KICKS = 64;
+    static const int MAX_LOAD_PERCENT = 40;
+
+  /* Instance variables */
+    uint16_t *storage;
+    uint16_t *blocks;
+    uint64_t nBlocks;
+    uint16_t fingerprintMask;
+    uint64_t kickState;
+
+  /* Private methods */
+    uint16_t *blockOf(uint64_t hash) const;
+    uint16_t fingerprintOf(uint64_t hash) const;
+    static int firstBucket(uint64_t hash);
+    static int otherBucket(int bucket,uint16_t fingerprint);
+    bool insertIntoBucket(uint16_t *block,int bucket,uint16_t fingerprint);
+
+  /* Making copying illegal */
+    CuckooFilter(const CuckooFilter& filter);
+    CuckooFilter& operator=(const CuckooFilter& filter);
+};
+
+/*
+ * Implementation Notes : Constructor and Destructor
+ * ------------------------------------------------------------------------------------------
+ * The array is allocated one block too long and the blocks start at the first 64 byte boundary.
+ */
+
+inline CuckooFilter::CuckooFilter(uint64_t capacity,double falsePositiveRate){
+  int bits = MIN_FINGERPRINT_BITS;
+  while(bits<MAX_FINGERPRINT_BITS && 2.0*SLOTS_PER_BUCKET/ldexp(1.0,bits)>falsePositiveRate)
+    bits++;
+  fingerprintMask = (uint16_t)((1u<<bits)-1);
+  nBlocks = (capacity*100+SLOTS_PER_BLOCK*MAX_LOAD_PERCENT-1)/(SLOTS_PER_BLOCK*MAX_LOAD_PERCENT);
+  if(nBlocks==0) nBlocks = 1;
+  storage = new uint16_t[(nBlocks+1)*SLOTS_PER_BLOCK];
+  uintptr_t address = ((uintptr_t)storage+63)&~(uintptr_t)63;
+  blocks = (uint16_t *)address;
+  kickState = 0x9e3779b97f4a7c15ULL;
+  clear();
+}
+
+inline CuckooFilter::~CuckooFilter(){
+  delete[] storage;
+}
+
+/*
+ * Implementation Notes : insert
+ * ------------------------------------------------------------------------------------------
+ * Tries both buckets, then evicts a pseudo-randomly chosen slot's fingerprint, moving it to
+ * its other bucket, until one fits or MAX_KICKS is reached and the block is marked as full.
+ */
+
+inline void CuckooFilter::insert(uint64_t hash){
+  uint16_t *block = blockOf(hash);
+  uint16_t fingerprint = fingerprintOf(hash);
+  int bucket = firstBucket(hash);
+  if(insertIntoBucket(block,bucket,fingerprint)) return;
+  bucket = otherBucket(bucket,fingerprint);
+  if(insertIntoBucket(block,bucket,fingerprint)) return;
+  for(int kick=0;kick<MAX_KICKS;kick++){
+    kickState ^= kickState<<13;
+    kickState ^= kickState>>7;
+    kickState ^= kickState<<17;
+    uint16_t *slot = &block[bucket*SLOTS_PER_BUCKET+(kickState&(SLOTS_PER_BUCKET-1))];
+    uint16_t evicted = *slot&~OVERFLOW_BIT;
+    *slot = (uint16_t)((*slot&OVERFLOW_BIT)|fingerprint);
+    fingerprint = evicted;
+    bucket = otherBucket(bucket,fingerprint);
+    if(insertIntoBucket(block,bucket,fingerprint)) return;
+  }
+  block[0] |= OVERFLOW_BIT;
+}
+
+inline bool CuckooFilter::remove(uint64_t hash){
+  uint16_t *block = blockOf(hash);
+  uint16_t fingerprint = fingerprintOf(hash);
+  int buckets[2] = {firstBucket(hash),otherBucket(firstBucket(hash),fingerprint)};
+  for(int b=0;b<2;b++){
+    uint16_t *slots = &block[buckets[b]*SLOTS_PER_BUCKET];
+    for(int i=0;i<SLOTS_PER_BUCKET;i++){
+      if((slots[i]&~OVERFLOW_BIT)==fingerprint){
+        slots[i] &= OVERFLOW_BIT;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/*
+ * Implementation Notes : mayContain
+ * -----------------------------------------------------------------------------------------
+ * Compares every slot of both buckets without stopping early, which compilers vectorize.
+ */
+
+inline bool CuckooFilter::mayContain(uint64_t hash) const{
+  const uint16_t *block = blockOf(hash);
+  uint16_t fingerprint = fingerprintOf(hash);
+  const uint16_t *first = &block[firstBucket(hash)*SLOTS_PER_BUCKET];
+  const uint16_t *other = &block[otherBucket(firstBucket(hash),fingerprint)*SLOTS_PER_BUCKET];
+  bool found = (block[0]&OVERFLOW_BIT)!=0;
+  for(int i=0;i<SLOTS_PER_BUCKET;i++)
+    found |= ((first[i]&~OVERFLOW_BIT)==fingerprint) | ((other[i]&~OVERFLOW_BIT)==fingerprint);
+  return found;
+}
+
+inline void CuckooFilter::clear(){
+  memset(blocks,0,nBlocks*SLOTS_PER_BLOCK*sizeof(uint16_t));
+}
+
+inline size_t CuckooFilter::memoryUsage() const{
+  return sizeof(CuckooFilter)+(nBlocks+1)*SLOTS_PER_BLOCK*sizeof(uint16_t);
+}
+
+/*
+ * Implementation Notes : blockOf, fingerprintOf, firstBucket, otherBucket
+ * -----------------------------------------------------------------------------------------
+ * The block comes from bits 32 and up of the hash code, scaled to the number of blocks by a
+ * multiply and shift rather than a division, the bucket from bits 29 to 31 and the fingerprint
+ * from the lowest bits, so the three are independent. otherBucket xors with a value depending
+ * only on the fingerprint, so applying it twice gives the first bucket.
+ */
+
+inline uint16_t *CuckooFilter::blockOf(uint64_t hash) const{
+  return &blocks[(((hash>>32)*nBlocks)>>32)*SLOTS_PER_BLOCK];
+}
+
+inline uint16_t CuckooFilter::fingerprintOf(uint64_t hash) const{
+  uint16_t fingerprint = (uint16_t)(hash&fingerprintMask);
+  return fingerprint==0?1:fingerprint;
+}
+
+inline int CuckooFilter::firstBucket(uint64_t hash){
+  return (int)((hash>>29)&7);
+}
+
+inline int CuckooFilter::otherBucket(int bucket,uint16_t fingerprint){
+  return bucket^(1+(int)((fingerprint*0x9e37u>>8)%7));
+}
+
+inline bool CuckooFilter::insertIntoBucket(uint16_t *block,int bucket,uint16_t fingerprint){
+  uint16_t *slots = &block[bucket*SLOTS_PER_BUCKET];
+  for(int i=0;i<SLOTS_PER_BUCKET;i++){
+    if((slots[i]&~OVERFLOW_BIT)==0){
+      slots[i] = (uint16_t)((slots[i]&OVERFLOW_BIT)|fingerprint);
+      return true;
+    }
+  }
+  return false;
+}
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * File : EpochReclaimer.h
+ * ---------------------------------------------------------------------------------
+ * This file exports epoch based memory reclamation for lock-free data structures.
+ * A thread that unlinks a node cannot delete it at once, since another thread may
+ * still be reading it. It retires the node instead, and the node is deleted once
+ * every thread that could have seen it has finished the operation it was in.
+ */
+
+#ifndef EpochReclaimer_h
+#define EpochReclaimer_h
+
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+using namespace std;
+
+class EpochReclaimer{
+
+  /* The public interface for the EpochReclaimer class */
+
+  public :
+
+   /*
+    * Method : instance
+    * Usage  : EpochReclaimer& reclaimer = EpochReclaimer::instance();
+    * ----------------------------------------------------------------------------------
+    * Returns the reclaimer shared by every lock-free structure of the program. It is
+    * never destroyed, so nodes retired by a structure may outlive the structure.
+    */
+
+    static EpochReclaimer& instance(){
+      static EpochReclaimer *reclaimer = new EpochReclaimer;
+      return *reclaimer;
+    }
+
+   /*
+    * Methods : enter,leave
+    * Usage   : reclaimer.enter(); ... reclaimer.leave();
+    * ----------------------------------------------------------------------------------
+    * Bracket every operation that reads shared nodes. Nodes retired while a thread is
+    * between enter and leave are not deleted before it leaves. Calls may nest. The
+    * EpochGuard class below calls them from a constructor and destructor.
+    */
+
+    void enter(){
+      Record *record = ownRecord();
+      if(record->nesting++==0){
+        record->state.store((epoch.load(memory_order_acquire)<<1)|1,memory_order_release);
+        atomic_thread_fence(memory_order_seq_cst);
+      }
+    }
+
+    void leave(){
+      Record *record = ownRecord();
+      if(--record->nesting==0)
+        record->state.store(0,memory_order_release);
+    }
+
+   /*
+    * Method : retire
+    * Usage  : reclaimer.retire(node,deleteNode);
+    * ----------------------------------------------------------------------------------
+    * Arranges for deleter(pointer) to be called once no thread can still be reading the
+    * object. The object must already be unreachable from the shared structure. Must be
+    * called between enter and leave.
+    */
+
+    void retire(void *pointer,void (*deleter)(void *)){
+      Record *record = ownRecord();
+      Retired retired = {pointer,deleter,epoch.load(memory_order_acquire)};
+      record->retired.push_back(retired);
+      if(record->retired.size()>=record->collectAt) collect(record);
+    }
+
+  private :
+
+  /*
+   * Representational Notes :
+   * ---------------------------------------------------------------------------------------
+   * There is a global epoch number, and a record for each thread holding its state : 0 when
+   * the thread is outside any operation, otherwise the epoch it saw on entering shifted left
+   * by one with the low bit set. The epoch moves from e to e+1 only when every thread inside
+   * an operation has announced e. A node retired during epoch e was unlinked before any thread
+   * that announces e+1 entered, so once the epoch reaches e+2 no thread can still hold it.
+   *
+   * Each thread keeps its own list of retired nodes, and now and then tries to advance the
+   * epoch and deletes the nodes that have become safe. Records are never freed : when a thread
+   * exits, its record, together with any nodes it still holds, is handed to the next new thread.
+   */
+
+  /* Structures for retired nodes and thread records */
+    struct Retired{
+      void *pointer;
+      void (*deleter)(void *);
+      uint64_t epoch;
+    };
+
+    struct Record{
+      atomic<uint64_t> state;
+      atomic<bool> owned;
+      Record *next;
+      vector<Retired> retired;
+      size_t collectAt;
+      int nesting;
+    };
+
+    struct Owner{
+      Record *record;
+      ~Owner(){
+        if(record!=NULL) record->owned.store(false,memory_order_release);
+      }
+    };
+
+  /* Private constants */
+    static const size_t COLLECT_BATCH = 64;
+
+  /* Instance variables */
+    atomic<uint64_t> epoch;
+    atomic<Record *> records;
+
+    EpochReclaimer(){
+      epoch.store(0);
+      records.store(NULL);
+    }
+
+  /*
+   * Implementation Notes : ownRecord
+   * ------------------------------------------------------------------------------------
+   * Returns the calling thread's record, taking over a record left by an exited thread
+   * or else pushing a new one on the front of the list the first time it is called.
+   */
+
+    Record *ownRecord(){
+      static thread_local Owner owner = {NULL};
+      if(owner.record!=NULL) return owner.record;
+      for(Record *record=records.load(memory_order_acquire);record!=NULL;record=record->next){
+        bool expected = false;
+        if(!record->owned.load(memory_order_relaxed) &&
+           record->owned.compare_exchange_strong(expected,true,memory_order_acquire)){
+          owner.record = record;
+          return record;
+        }
+      }
+      Record *record = new Record;
+      record->state.store(0);
+      record->owned.store(true);
+      record->collectAt = COLLECT_BATCH;
+      record->nesting = 0;
+      record->next = records.load(memory_order_relaxed);
+      while(!records.compare_exchange_weak(record->next,record,memory_order_release,memory_order_relaxed));
+      owner.record = record;
+      return record;
+    }
+
+  /*
+   * Implementation Notes : collect
+   * ------------------------------------------------------------------------------------
+   * Advances the epoch if every thread inside an operation has caught up with it, then
+   * deletes the retired nodes at least two epochs old. The next collection is put off
+   * until the list has doubled, so nodes held back by a slow thread are not rescanned
+   * on every retirement.
+   */
+
+    void collect(Record *record){
+      uint64_t current = epoch.load(memory_order_acquire);
+      atomic_thread_fence(memory_order_seq_cst);
+      bool caughtUp = true;
+      for(Record *other=records.load(memory_order_acquire);other!=NULL;other=other->next){
+        uint64_t state = other->state.load(memory_order_acquire);
+        if((state&1) && (state>>1)!=current){
+          caughtUp = false;
+          break;
+        }
+      }
+      if(caughtUp && epoch.compare_exchange_strong(current,current+1,memory_order_acq_rel))
+        current++;
+      vector<Retired>& retired = record->retired;
+      size_t kept = 0;
+      for(size_t i=0;i<retired.size();i++){
+        if(retired[i].epoch+2<=current) retired[i].deleter(retired[i].pointer);
+        else retired[kept++] = retired[i];
+      }
+      retired.resize(kept);
+      record->collectAt = kept*2>COLLECT_BATCH?kept*2:COLLECT_BATCH;
+    }
+
+  /* Making copying illegal */
+    EpochReclaimer(const EpochReclaimer& reclaimer);
+    EpochReclaimer& operator=(const EpochReclaimer& reclaimer);
+};
+
+/*
+ * Class : EpochGuard
+ * Usage : { EpochGuard guard; ... }
+ * ---------------------------------------------------------------------------
+ * Enters the shared reclaimer on construction and leaves it on destruction.
+ */
+
+class EpochGuard{
+  public :
+    EpochGuard(){ EpochReclaimer::instance().enter(); }
+    ~EpochGuard(){ EpochReclaimer::instance().leave(); }
+  private :
+    EpochGuard(const EpochGuard& guard);
+    EpochGuard& operator=(const EpochGuard& guard);
+};
+
+#endif
@@ -0,0 +1,292 @@
+/*
+ * File : FlatMap.h
+ * ---------------------------------------------------------------------------------
+ * This file exports FlatMap, a map kept as two sorted Vectors, one of keys and one
+ * of values. It has the get, put, remove and containsKey of HashMap and is meant for
+ * small maps, up to a few hundred pairs, that are built once and then read many
+ * times : lookups touch a few contiguous cache lines and no pointers, and each pair
+ * costs only its key and value. A put or remove of a single pair shifts the pairs
+ * after it, so takes O(N) time; putBatch adds many at once.
+ */
+
+#ifndef FlatMap_h
+#define FlatMap_h
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include "../Vector/Vector.h"
+using namespace std;
+
+template<typename keyType,typename valueType> class FlatMap{
+
+  /* The public interface for the FlatMap class */
+
+  public :
+
+  /*
+   * Constructor : FlatMap
+   * Usage       : FlatMap<int,string> map;
+   * -------------------------------------
+   * Initialise an empty map.
+   */
+
+    FlatMap();
+
+  /*
+   * Constructor : FlatMap
+   * Usage       : FlatMap<string,int> map(keys,values,n);
+   * -------------------------------------------------------------------------------------------
+   * Initialise a map holding the n key value pairs keys[i],values[i], as if put in order, in
+   * O(n log n) time rather than the O(n^2) of n puts.
+   */
+
+    FlatMap(const keyType *keys,const valueType *values,int n);
+
+   /*
+    * Methods : size,isEmpty,clear
+    * Usage   : if(map.isEmpty()) ...
+    * -------------------------------------------------------------------------
+    * Return the number of pairs, whether there are none, and remove them all.
+    */
+
+    int size() const;
+    bool isEmpty() const;
+    void clear();
+
+   /*
+    * Methods : get,put,remove,containsKey
+    * Usage   : map.put(key,value);
+    * ------------------------------------------------------------------------------------------
+    * As for HashMap : get returns the value of key, or valueType() if it is absent; put inserts
+    * or overwrites the pair; remove deletes it if present. Lookups take O(log N) time.
+    */
+
+    valueType get(const keyType& key) const;
+    void put(const keyType& key,const valueType& value);
+    void remove(const keyType& key);
+    bool containsKey(const keyType& key) const;
+
+   /*
+    * Method : find
+    * Usage  : int *count = map.find(key);
+    * -------------------------------------------------------------------------------------------
+    * Returns a pointer to the value stored for key, or NULL if key is absent. Unlike HashMap's,
+    * the pointer is only valid until the next put, putBatch or remove, which move values.
+    */
+
+    valueType *find(const keyType& key);
+    const valueType *find(const keyType& key) const;
+
+   /*
+    * Method : putBatch
+    * Usage  : map.putBatch(keys,values,n);
+    * -------------------------------------------------------------------------------------------
+    * Puts keys[i],values[i] for i from 0 to n-1, in order, by sorting the batch and merging it
+    * with the pairs already there, in O(N + n log n) time.
+    */
+
+    void putBatch(const keyType *keys,const valueType *values,int n);
+
+  private :
+
+  /*
+   * Representational Notes :
+   * -------------------------------------------------------------------------------------------
+   * keys holds the keys in increasing order, by operator<, and values[i] is the value of keys[i].
+   * Keeping the keys apart from the values packs as many keys as possible into each cache line a
+   * search reads. Every lookup finds the lower bound of its key, the first index whose key is not
+   * less than it. Up to LINEAR_SEARCH_LIMIT arithmetic keys are counted in a single pass with no
+   * branches, which compilers turn into vector compares, and is faster than any search at that
+   * size. Above it, or for other key types, the search halves the range without branches, so it
+   * never mispredicts. Past about a hundred pairs a HashMap overtakes it.
+   */
+
+  /* Private constants */
+    static const int LINEAR_SEARCH_LIMIT = 32;
+
+  /* Instance variables */
+    Vector<keyType> keys;
+    Vector<valueType> values;
+
+  /* Private methods */
+    int lowerBound(const keyType& key) const;
+    bool holds(int index,const keyType& key) const;
+};
+
+/*
+ * Implementation Notes : Constructors
+ * ------------------------------------------------------------------------------------------
+ * The bulk constructor is putBatch on an empty map.
+ */
+
+template<typename keyType,typename valueType>
+FlatMap<keyType,valueType>::FlatMap(){
+}
+
+template<typename keyType,typename valueType>
+FlatMap<keyType,valueType>::FlatMap(const keyType *keys,const valueType *values,int n){
+  putBatch(keys,values,n);
+}
+
+/*
+ * Implementation Notes : size, isEmpty, clear
+ * ------------------------------------------------------
+ * Run in constant time, using the size of the key Vector.
+ */
+
+template<typename keyType,typename valueType>
+int FlatMap<keyType,valueType>::size() const{
+  return keys.size();
+}
+
+template<typename keyType,typename valueType>
+bool FlatMap<keyType,valueType>::isEmpty() const{
+  return keys.isEmpty();
+}
+
+template<typename keyType,typename valueType>
+void FlatMap<keyType,valueType>::clear(){
+  keys.clear();
+  values.clear();
+}
+
+/*
+ * Implementation Notes : get, put, remove, containsKey, find
+ * ------------------------------------------------------------------------------------------
+ * All find the lower bound of key first. put inserts a new key there, which keeps the keys
+ * sorted, and remove deletes the pair there, both shifting the pairs after it.
+ */
+
+template<typename keyType,typename valueType>
+valueType FlatMap<keyType,valueType>::get(const keyType& key) const{
+  int index = lowerBound(key);
+  return holds(index,key)?values.data()[index]:valueType();
+}
+
+template<typename keyType,typename valueType>
+void FlatMap<keyType,valueType>::put(const keyType& key,const valueType& value){
+  int index = lowerBound(key);
+  if(holds(index,key)){
+    values.data()[index] = value;
+  }else{
+    keys.insert(index,key);
+    values.insert(index,value);
+  }
+}
+
+template<typename keyType,typename valueType>
+void FlatMap<keyType,valueType>::remove(const keyType& key){
+  int index = lowerBound(key);
+  if(holds(index,key)){
+    keys.remove(index);
+    values.remove(index);
+  }
+}
+
+template<typename keyType,typename valueType>
+bool FlatMap<keyType,valueType>::containsKey(const keyType& key) const{
+  return holds(lowerBound(key),key);
+}
+
+template<typename keyType,typename valueType>
+valueType *FlatMap<keyType,valueType>::find(const keyType& key){
+  int index = lowerBound(key);
+  return holds(index,key)?&values.data()[index]:NULL;
+}
+
+template<typename keyType,typename valueType>
+const valueType *FlatMap<keyType,valueType>::find(const keyType& key) const{
+  int index = lowerBound(key);
+  return holds(index,key)?&values.data()[index]:NULL;
+}
+
+/*
+ * Implementation Notes : putBatch
+ * ------------------------------------------------------------------------------------------
+ * The batch is sorted through an array of indices, stably, so that of several pairs with the
+ * same key the last one given wins. The sorted batch and the map are then merged into new
+ * Vectors allocated at their final size, a batch pair replacing a map pair with the same key.
+ */
+
+template<typename keyType,typename valueType>
+void FlatMap<keyType,valueType>::putBatch(const keyType *keys,const valueType *values,int n){
+  if(n<=0) return;
+  vector<int> order(n);
+  for(int i=0;i<n;i++)
+    order[i] = i;
+  stable_sort(order.begin(),order.end(),[keys](int a,int b){ return keys[a]<keys[b]; });
+  int unique = 0;
+  for(int i=0;i<n;i++){
+    if(i+1<n && !(keys[order[i]]<keys[order[i+1]])) continue;
+    order[unique++] = order[i];
+  }
+  int oldSize = this->keys.size();
+  const keyType *oldKeys = this->keys.data();
+  const valueType *oldValues = this->values.data();
+  Vector<keyType> mergedKeys(oldSize+unique);
+  Vector<valueType> mergedValues(oldSize+unique);
+  keyType *outKeys = mergedKeys.data();
+  valueType *outValues = mergedValues.data();
+  int count = 0, i = 0, j = 0;
+  while(i<oldSize || j<unique){
+    if(j==unique || (i<oldSize && oldKeys[i]<keys[order[j]])){
+      outKeys[count] = oldKeys[i];
+      outValues[count++] = oldValues[i++];
+    }else{
+      if(i<oldSize && !(keys[order[j]]<oldKeys[i])) i++;
+      outKeys[count] = keys[order[j]];
+      outValues[count++] = values[order[j++]];
+    }
+  }
+  while(mergedKeys.size()>count){
+    mergedKeys.remove(mergedKeys.size()-1);
+    mergedValues.remove(mergedValues.size()-1);
+  }
+  this->keys = mergedKeys;
+  this->values = mergedValues;
+}
+
+/*
+ * Implementation Notes : lowerBound, holds
+ * ------------------------------------------------------------------------------------------
+ * The linear count adds up the comparisons with every key, which is the lower bound as the keys
+ * are sorted; it goes 8 keys at a time, as compilers only vectorize loops of a fixed length at
+ * -O2. The halving search keeps the lower bound within the n keys from base on; each step moves
+ * base past the first half if the key before the second half is less than key, written as a
+ * product with the comparison so that it compiles to arithmetic rather than a branch. The last
+ * key left decides between it and the one after. holds checks that the lower bound is key.
+ */
+
+template<typename keyType,typename valueType>
+int FlatMap<keyType,valueType>::lowerBound(const keyType& key) const{
+  const keyType *first = keys.data();
+  int n = keys.size();
+  if(is_arithmetic<keyType>::value && n<=LINEAR_SEARCH_LIMIT){
+    int below = 0, i = 0;
+    for(;i+8<=n;i+=8){
+      int block = 0;
+      for(int j=0;j<8;j++)
+        block += first[i+j]<key;
+      below += block;
+    }
+    for(;i<n;i++)
+      below += first[i]<key;
+    return below;
+  }
+  if(n==0) return 0;
+  const keyType *base = first;
+  while(n>1){
+    int half = n/2;
+    base += half*(int)(base[half-1]<key);
+    n -= half;
+  }
+  return (int)(base-first)+(*base<key);
+}
+
+template<typename keyType,typename valueType>
+bool FlatMap<keyType,valueType>::holds(int index,const keyType& key) const{
+  return index<keys.size() && !(key<keys.data()[index]);
+}
+
+#endif
@@ -9,10 +9,47 @@
 #ifndef HashMap_h
 #define HashMap_h
 
+#include <vector>
 #include "hashfunctions.h"
 #include "hashfunctions.cpp"
+#include "CuckooFilter.h"
+#ifdef HASHMAP_STATS
+#include <atomic>
+#include <chrono>
+#endif
 using namespace std;//This is important incase one of key/Val pairs is string.
 
+/*
+ * Type : HashMapStats
+ * ---------------------------------------------------------------------------------------------
+ * A report on the shape and use of a HashMap, returned by its stats method. chainLengths[k] is
+ * the number of buckets holding k cells, so its last index is the longest chain; with a good hash
+ * function it falls off quickly, and a long tail points to keys that collide. bytesUsed counts the
+ * buckets, cells and filter, and payloadBytes only the keys and values themselves, neither counting
+ * memory that keys or values own, such as the characters of long strings.
+ *
+ * The remaining fields are counted as the map is used, and only when the program is compiled with
+ * HASHMAP_STATS defined, as in g++ -DHASHMAP_STATS; otherwise countersEnabled is false and they are
+ * 0. Every lookup counts, including the one a put makes to find out whether its key is new, and a
+ * probe is one cell compared. rehashSeconds is the total time spent rehashing.
+ */
+
+  struct HashMapStats{
+    int size;
+    int buckets;
+    double loadFactor;
+    vector<int> chainLengths;
+    size_t bytesUsed;
+    size_t payloadBytes;
+    bool countersEnabled;
+    uint64_t hits;
+    uint64_t misses;
+    double probesPerHit;
+    double probesPerMiss;
+    int rehashes;
+    double rehashSeconds;
+  };
+
 template<typename keyType, typename valueType> class HashMap{
 
   /* The public interface for the HashMap class */
@@ -28,6 +65,28 @@ template<typename keyType, typename valueType> class HashMap{
    
     HashMap();
 
+  /*
+   * Constructor : HashMap
+   * Usage       : HashMap<int,int> hashmap(keys,values,n);
+   * -------------------------------------------------------------------------------------------
+   * Initialise a hashmap holding the n key value pairs keys[i],values[i], as if put in order.
+   * The bucket array is allocated at its final size up front, so it is never rehashed while the
+   * pairs are added.
+   */
+
+    HashMap(const keyType *keys,const valueType *values,int n);
+
+  /*
+   * Constructor : HashMap
+   * Usage       : HashMap<string,int> hashmap(50000000,0.5);
+   * -------------------------------------------------------------------------------------------
+   * Initialise an empty hashmap with room for expectedSize pairs, so that adding that many never
+   * rehashes, and that grows whenever the number of pairs per bucket would exceed maxLoadFactor.
+   * A lower maxLoadFactor gives shorter chains for more memory. Throws if it is not positive.
+   */
+
+    HashMap(int expectedSize,double maxLoadFactor = REHASH_THRESHHOLD);
+
    /* 
     * Destructor : ~HashMap
     * --------------------------------------------------
@@ -63,6 +122,57 @@ template<typename keyType, typename valueType> class HashMap{
 
     void clear();
 
+   /*
+    * Methods : reserve,shrinkToFit
+    * Usage   : hashmap.reserve(n);
+    * -------------------------------------------------------------------------------------------
+    * reserve grows the table at once to hold n pairs without further rehashing, which is cheaper
+    * than the repeated doublings of adding them one by one. shrinkToFit makes the table as small
+    * as the current pairs allow, for instance after many removals. Both keep cells in place.
+    */
+
+    void reserve(int n);
+    void shrinkToFit();
+
+   /*
+    * Methods : enableFilter,disableFilter
+    * Usage   : hashmap.enableFilter(0.01);
+    * -------------------------------------------------------------------------------------------
+    * enableFilter makes the map keep a CuckooFilter of its keys, which lets get, containsKey and
+    * find reject most absent keys after reading one cache line, without walking a chain. An
+    * absent key gets past the filter at about falsePositiveRate. Worth it when most lookups miss;
+    * it costs about 5 bytes per key and a little time on every put and remove. disableFilter
+    * frees the filter.
+    */
+
+    void enableFilter(double falsePositiveRate = 0.01);
+    void disableFilter();
+
+   /*
+    * Method : harden
+    * Usage  : hashmap.harden();
+    * -------------------------------------------------------------------------------------------
+    * Makes the map hash its keys with KeyedHashTraits under a seed drawn at random for this map,
+    * for maps whose keys come from untrusted input. The ordinary hash functions are public, so an
+    * attacker can compute many keys that fall into one bucket; without the seed they cannot. Keyed
+    * hashing is a few times slower. The pairs already in the map are rehashed, in O(N) time, and
+    * hashOf changes, so codes it returned before must not be passed to the overloads taking a hash.
+    */
+
+    void harden();
+
+   /*
+    * Methods : stats,resetStats
+    * Usage   : HashMapStats report = hashmap.stats();
+    * -------------------------------------------------------------------------------------------
+    * stats describes the map as it is now, as explained with HashMapStats, in O(N) time. The
+    * counters it reports, when enabled, run from the creation of the map or the last resetStats.
+    * Threads may read one map at once with the counters enabled, but may then lose some counts.
+    */
+
+    HashMapStats stats() const;
+    void resetStats();
+
    /*
     * Method : get
     * Usage  : hashmap.get(keyValue);
@@ -98,6 +208,107 @@ template<typename keyType, typename valueType> class HashMap{
     */
 
     bool containsKey(const keyType& key) const;
+
+   /*
+    * Method : hashOf
+    * Usage  : uint64_t hash = hashmap.hashOf(key);
+    * ------------------------------------------------------------------------------------------
+    * Returns the hash code the map uses for key. Passing it to the overloads below that take a
+    * hash saves hashing the same key again; it must be the hashOf of that very key by the same
+    * map. Maps that are not hardened all return HashTraits<keyType>::hash(key).
+    */
+
+    uint64_t hashOf(const keyType& key) const;
+
+   /*
+    * Method : find
+    * Usage  : int *count = hashmap.find(key);
+    * -------------------------------------------------------------------------------------------
+    * Returns a pointer to the value stored for key, or NULL if key is absent. The pointer stays
+    * valid until key is removed or the map is cleared, as cells never move, so the value can be
+    * read and updated through it without looking key up again.
+    */
+
+    valueType *find(const keyType& key);
+    const valueType *find(const keyType& key) const;
+
+   /*
+    * Methods : insertOrAssign,tryEmplace
+    * Usage   : if(hashmap.tryEmplace(key,value)) ...
+    * -------------------------------------------------------------------------------------------
+    * Both return true if key was absent and has been inserted with value. If key is present,
+    * insertOrAssign overwrites its value, as put does, while tryEmplace leaves it unchanged.
+    */
+
+    bool insertOrAssign(const keyType& key,const valueType& value);
+    bool tryEmplace(const keyType& key,const valueType& value);
+
+   /*
+    * Method : getOrInsert
+    * Usage  : hashmap.getOrInsert(word)++;
+    * -------------------------------------------------------------------------------------------
+    * Returns a reference to the value stored for key, first inserting key with valueType() if
+    * it is absent. The reference stays valid as long as find's pointer would. This replaces a
+    * get followed by a put with a single lookup.
+    */
+
+    valueType& getOrInsert(const keyType& key);
+
+   /*
+    * Methods : Precomputed hash overloads
+    * Usage   : hashmap.getOrInsert(key,hash)++;
+    * -------------------------------------------------------------------------------------------
+    * Same as the methods above, given hash==hashOf(key).
+    */
+
+    valueType get(const keyType& key,uint64_t hash) const;
+    void put(const keyType& key,const valueType& value,uint64_t hash);
+    void remove(const keyType& key,uint64_t hash);
+    bool containsKey(const keyType& key,uint64_t hash) const;
+    valueType *find(const keyType& key,uint64_t hash);
+    const valueType *find(const keyType& key,uint64_t hash) const;
+    bool insertOrAssign(const keyType& key,const valueType& value,uint64_t hash);
+    bool tryEmplace(const keyType& key,const valueType& value,uint64_t hash);
+    valueType& getOrInsert(const keyType& key,uint64_t hash);
+
+   /*
+    * Method : removeFound
+    * Usage  : hashmap.removeFound(hashmap.find(key,hash),hash);
+    * -------------------------------------------------------------------------------------------
+    * Removes the pair whose value is at value, a pointer returned by find or getOrInsert, given
+    * the hash of its key. Cells are matched by address, so structures that keep pointers into
+    * the map can remove a pair without keeping their own copy of its key.
+    */
+
+    void removeFound(const valueType *value,uint64_t hash);
+
+   /*
+    * Methods : Transparent lookups
+    * Usage   : int *count = hashmap.find(string_view(line.data(),length));
+    * -------------------------------------------------------------------------------------------
+    * Look up a key given as another type that compares equal to keyType and that HashTraits and
+    * KeyedHashTraits of keyType can hash the same way, without converting it to keyType. For
+    * string keys this means string_view and const char*, so no string is built to look it up.
+    */
+
+    template<typename lookupType> valueType get(const lookupType& key) const;
+    template<typename lookupType> bool containsKey(const lookupType& key) const;
+    template<typename lookupType> valueType *find(const lookupType& key);
+    template<typename lookupType> const valueType *find(const lookupType& key) const;
+
+   /*
+    * Methods : putBatch,getBatch
+    * Usage   : hashmap.getBatch(keys,values,n);
+    * -------------------------------------------------------------------------------------------
+    * putBatch puts keys[i],values[i] for i from 0 to n-1, in order. getBatch stores get(keys[i])
+    * in values[i]. Looking many keys up one by one, every probe waits for its bucket and cell to
+    * arrive from memory; these hash a block of keys first, then ask the processor to fetch the
+    * buckets and cells of keys a few places ahead, so that the waits overlap. Best for batches of
+    * hundreds of keys or more on a map much larger than the cache.
+    */
+
+    void putBatch(const keyType *keys,const valueType *values,int n);
+    void getBatch(const keyType *keys,valueType *values,int n) const;
    
   private : 
 
@@ -108,38 +319,109 @@ template<typename keyType, typename valueType> class HashMap{
    * start of linked lists of structures containing the key value pairs which are to be stored in 
    * the hashmap. This kind of strategy allows for get and put to operate in O(1) time, given there
    * are no collisions. In case of collisions, the time is O(N) in worst case, where all keys are 
-   * hashed to the same bucket. The Implementation makes use of hash functions for all primitive 
-   * types exported by the hashfunctions.h interface, as included in the beginning.The represent
-   * -ation also allows for rehashing using dynamic array size expansion capabilties.Keep the 
-   * nBuckets such that nBuckets is a prime number/ it has no factor in 1 to 20 in order to
-   * help uniform distribution of hash codes.
+   * hashed to the same bucket. The Implementation makes use of the HashTraits of the key type
+   * exported by the hashfunctions.h interface, as included in the beginning.The represent
+   * -ation also allows for rehashing using dynamic array size expansion capabilties. nBuckets is
+   * always a power of two, so the bucket of a hash code is its low bits, found with a mask rather
+   * than a division; the hash functions mix every key bit into the low bits to allow this. Each
+   * cell keeps the hash code of its key, so chains are searched by comparing codes before keys
+   * and rehashing never calls the hash function again.
+   *
+   * Should a chain grow past TREEIFY_THRESHOLD cells, which with a good hash function happens only
+   * when the keys were chosen to collide, its bucket is turned into an AVL tree ordered by hash
+   * code, as Java's HashMap does. Its slot in buckets is then NULL and its slot in trees, an array
+   * of nBuckets pointers allocated when the first bucket is turned, points to the tree. Cells with
+   * the same code share a node, chained through their links. Keys that only share the low bits of
+   * their codes then cost O(log N) to find rather than O(N); keys with wholly equal codes still
+   * share a chain, which harden guards against for keys from untrusted input. A tree whose cells
+   * fall to UNTREEIFY_THRESHOLD goes back to being a chain, and rehash turns trees back into chains
+   * and only turns those chains that are still too long into trees again.
    */
    
-  static const int INITIAL_BUCKETS = 13;
-  static const double REHASH_THRESHHOLD = 0.7;
+  static const int INITIAL_BUCKETS = 16;
+  static const int MAX_BUCKETS = 1<<30;
+  static const double REHASH_THRESHHOLD;
+  static const int BATCH_BLOCK = 256;
+  static const int PREFETCH_DISTANCE = 8;
+  static const int TREEIFY_THRESHOLD = 8;
+  static const int UNTREEIFY_THRESHOLD = 6;
 
   /* Structure to store key value pairs */
   struct Cell{
     keyType key;
     valueType value;
+    uint64_t hash;
     Cell* link;  
   };
 
+  /* Structures for the buckets turned into trees */
+  struct TreeNode{
+    uint64_t hash;
+    Cell *cells;
+    TreeNode *left;
+    TreeNode *right;
+    int height;
+  };
+
+  struct TreeBin{
+    TreeNode *root;
+    int count;
+  };
+
   /* Instance variables */
   Cell **buckets;
   int nBuckets;
   int cellCount;
+  double maxLoadFactor;
+  CuckooFilter *filter;
+  double filterRate;
+  TreeBin **trees;
+  bool hardened;
+  HashSeed seed;
+#ifdef HASHMAP_STATS
+  mutable atomic<uint64_t> hitCount,missCount,hitProbes,missProbes;
+  int rehashCount;
+  double rehashSeconds;
+#endif
 
   /* Private methods */  
-  Cell *findCell(int bucket,const keyType& key) const;
-  void expandAndRehash();
+  int bucketOf(uint64_t hash) const;
+  template<typename lookupType> Cell *findCell(uint64_t hash,const lookupType& key) const;
+  Cell *findOrCreateCell(uint64_t hash,const keyType& key,bool& created);
+  int bucketsFor(int nCells) const;
+  void prefetchBucket(uint64_t hash) const;
+  void prefetchChain(uint64_t hash) const;
+  void rehash(int newnBuckets,bool newHashes = false);
+  void rebuildFilter();
+  void recordLookup(bool hit,int probes) const;
+  template<typename lookupType> uint64_t hashLookup(const lookupType& key) const;
+  Cell *detachCells(int bucket);
+  void treeify(int bucket);
+  void untreeify(int bucket);
+  void treeifyLongChains();
+  template<typename lookupType> static Cell *findInTree(const TreeNode *node,uint64_t hash,const lookupType& key,int& probes);
+  void removeCell(uint64_t hash,const keyType *key,const valueType *value);
+  static bool isCellOf(const Cell *cp,const keyType *key,const valueType *value);
+  Cell *unlinkFromTree(int bucket,uint64_t hash,const keyType *key,const valueType *value);
+  void addTreeToFilter(const TreeNode *node);
+  static void insertNode(TreeNode* &tree,Cell *cp);
+  static void removeNode(TreeNode* &tree,uint64_t hash);
+  static Cell *flattenTree(TreeNode *tree,Cell *list);
+  static int height(const TreeNode *tree);
+  static void fixHeight(TreeNode *tree);
+  static void rebalance(TreeNode* &tree);
+  static void rotateLeft(TreeNode* &tree);
+  static void rotateRight(TreeNode* &tree);
 
   /* Making copying illegal */
-  HashMap(const Hashmap<keyType,valueType>& hashmap){};
-  HashMap<keyType,valueType>& operator=(const Hashmap<keyType,valueType>& hashmap){return *this;};
+  HashMap(const HashMap<keyType,valueType>& hashmap){};
+  HashMap<keyType,valueType>& operator=(const HashMap<keyType,valueType>& hashmap){return *this;};
 
 };
 
+template<typename keyType,typename valueType>
+const double HashMap<keyType,valueType>::REHASH_THRESHHOLD = 0.7;
+
 /* 
  * Implementation Notes : Constructor and Destructor
  * -----------------------------------------------------------------------------------
@@ -149,6 +431,11 @@ template<typename keyType, typename valueType> class HashMap{
 template<typename keyType,typename valueType>
 HashMap<keyType,valueType>::HashMap(){
   cellCount = 0;
+  maxLoadFactor = REHASH_THRESHHOLD;
+  filter = NULL;
+  trees = NULL;
+  hardened = false;
+  resetStats();
   nBuckets = INITIAL_BUCKETS;
   buckets = new Cell*[nBuckets];
   for(int i=0;i<nBuckets;i++)
@@ -156,31 +443,202 @@ HashMap<keyType,valueType>::HashMap(){
   return;
 }
 
+template<typename keyType,typename valueType>
+HashMap<keyType,valueType>::HashMap(const keyType *keys,const valueType *values,int n){
+  cellCount = 0;
+  maxLoadFactor = REHASH_THRESHHOLD;
+  filter = NULL;
+  trees = NULL;
+  hardened = false;
+  resetStats();
+  nBuckets = bucketsFor(n);
+  buckets = new Cell*[nBuckets];
+  for(int i=0;i<nBuckets;i++)
+    buckets[i] = NULL;
+  putBatch(keys,values,n);
+}
+
+template<typename keyType,typename valueType>
+HashMap<keyType,valueType>::HashMap(int expectedSize,double maxLoadFactor){
+  if(!(maxLoadFactor>0)) throw "Error : maxLoadFactor must be positive";
+  cellCount = 0;
+  this->maxLoadFactor = maxLoadFactor;
+  filter = NULL;
+  trees = NULL;
+  hardened = false;
+  resetStats();
+  nBuckets = bucketsFor(expectedSize);
+  buckets = new Cell*[nBuckets];
+  for(int i=0;i<nBuckets;i++)
+    buckets[i] = NULL;
+}
+
 template<typename keyType,typename valueType>
 HashMap<keyType,valueType>::~HashMap(){
   clear();
+  delete[] buckets;
+  delete filter;
 }
 
 /* 
  * Implementation Notes : clear
  * --------------------------------------------------------------------------------------------------
  * Freez the heap memory associated with the entire HashMap by looping through it and freeing memory 
- * associated with every linked list whose starting address is stored at every bucket. Runs in O(N)
- * time.
+ * associated with every linked list whose starting address is stored at every bucket. Trees are
+ * flattened into lists first, and the array of trees is freed. Runs in O(N) time.
  */
 
 template<typename keyType,typename valueType>
 void HashMap<keyType,valueType>::clear(){
  for(int i=0;i<nBuckets;i++){
-    Cell *cp = buckets[i];
+    Cell *cp = detachCells(i);
     while(cp!=NULL){
       Cell *oldCell = cp;
       cp = cp->link;
       delete oldCell;
     }
-    buckets[i] = cp;
   } 
+  delete[] trees;
+  trees = NULL;
   cellCount = 0;
+  if(filter!=NULL) filter->clear();
+}
+
+/*
+ * Implementation Notes : reserve, shrinkToFit
+ * ----------------------------------------------------------------------------------------------
+ * Both rehash to bucketsFor the wanted number of pairs, if that differs from the current size in
+ * the direction asked for. Take O(N) time when they rehash.
+ */
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::reserve(int n){
+  int needed = bucketsFor(n);
+  if(needed>nBuckets) rehash(needed);
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::shrinkToFit(){
+  int needed = bucketsFor(cellCount);
+  if(needed<nBuckets) rehash(needed);
+}
+
+/*
+ * Implementation Notes : enableFilter, disableFilter
+ * ----------------------------------------------------------------------------------------------
+ * The filter holds the stored hash codes of the cells. It is rebuilt from them whenever the table
+ * is rehashed, sized for the cells the new table holds before its next rehash.
+ */
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::enableFilter(double falsePositiveRate){
+  filterRate = falsePositiveRate;
+  rebuildFilter();
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::disableFilter(){
+  delete filter;
+  filter = NULL;
+}
+
+/*
+ * Implementation Notes : harden, hashLookup
+ * ----------------------------------------------------------------------------------------------
+ * harden draws a new seed and has rehash recompute every stored hash code at the same table size.
+ * hashLookup is hashOf for keys of any type the traits accept, used by the transparent lookups.
+ */
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::harden(){
+  seed = randomHashSeed();
+  hardened = true;
+  rehash(nBuckets,true);
+}
+
+template<typename keyType,typename valueType> template<typename lookupType>
+uint64_t HashMap<keyType,valueType>::hashLookup(const lookupType& key) const{
+  return hardened?KeyedHashTraits<keyType>::hash(key,seed):HashTraits<keyType>::hash(key);
+}
+
+/*
+ * Implementation Notes : stats, resetStats, recordLookup
+ * ----------------------------------------------------------------------------------------------
+ * stats walks every chain to build the histogram, and takes the size of a tree from its bin; every
+ * cell of a tree is counted with a node, which is exact unless cells share codes.
+ *
+ * recordLookup is called by findCell; without HASHMAP_STATS it is empty, and the compiler removes
+ * it and the probe count that feeds it, so lookups cost nothing extra. The lookup counters are
+ * atomic, as const lookups may run on several threads at once, but are bumped with a relaxed load
+ * and store rather than a locked add, which keeps a counted lookup as cheap as a plain one on one
+ * thread; concurrent lookups can then overwrite each other's counts, making the figures a lower
+ * bound, but never race.
+ */
+
+template<typename keyType,typename valueType>
+HashMapStats HashMap<keyType,valueType>::stats() const{
+  HashMapStats report;
+  report.size = cellCount;
+  report.buckets = nBuckets;
+  report.loadFactor = (double)cellCount/nBuckets;
+  report.bytesUsed = sizeof(*this)+nBuckets*sizeof(Cell *)+cellCount*sizeof(Cell);
+  if(trees!=NULL) report.bytesUsed += nBuckets*sizeof(TreeBin *);
+  for(int i=0;i<nBuckets;i++){
+    int length = 0;
+    if(trees!=NULL && trees[i]!=NULL){
+      length = trees[i]->count;
+      report.bytesUsed += sizeof(TreeBin)+length*sizeof(TreeNode);
+    }
+    for(Cell *cp=buckets[i];cp!=NULL;cp=cp->link)
+      length++;
+    if(length>=(int)report.chainLengths.size()) report.chainLengths.resize(length+1,0);
+    report.chainLengths[length]++;
+  }
+  if(filter!=NULL) report.bytesUsed += filter->memoryUsage();
+  report.payloadBytes = cellCount*(sizeof(keyType)+sizeof(valueType));
+#ifdef HASHMAP_STATS
+  report.countersEnabled = true;
+  uint64_t hits = hitCount.load(memory_order_relaxed);
+  uint64_t misses = missCount.load(memory_order_relaxed);
+  report.hits = hits;
+  report.misses = misses;
+  report.probesPerHit = hits==0?0:(double)hitProbes.load(memory_order_relaxed)/hits;
+  report.probesPerMiss = misses==0?0:(double)missProbes.load(memory_order_relaxed)/misses;
+  report.rehashes = rehashCount;
+  report.rehashSeconds = rehashSeconds;
+#else
+  report.countersEnabled = false;
+  report.hits = report.misses = 0;
+  report.probesPerHit = report.probesPerMiss = 0;
+  report.rehashes = 0;
+  report.rehashSeconds = 0;
+#endif
+  return report;
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::resetStats(){
+#ifdef HASHMAP_STATS
+  hitCount.store(0,memory_order_relaxed);
+  missCount.store(0,memory_order_relaxed);
+  hitProbes.store(0,memory_order_relaxed);
+  missProbes.store(0,memory_order_relaxed);
+  rehashCount = 0;
+  rehashSeconds = 0;
+#endif
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::recordLookup(bool hit,int probes) const{
+#ifdef HASHMAP_STATS
+  atomic<uint64_t>& count = hit?hitCount:missCount;
+  atomic<uint64_t>& total = hit?hitProbes:missProbes;
+  count.store(count.load(memory_order_relaxed)+1,memory_order_relaxed);
+  total.store(total.load(memory_order_relaxed)+probes,memory_order_relaxed);
+#else
+  (void)hit;
+  (void)probes;
+#endif
 }
 
 /* 
@@ -202,42 +660,41 @@ bool HashMap<keyType,valueType>::isEmpty() const{
 /* 
  * Implementation Notes : get.
  * ----------------------------------------------------------------------------------------
- * Uses the hash function for the keyType and generates a hash code. Sees to it if it can 
+ * Uses the HashTraits of the keyType to generate a hash code. Sees to it if it can 
  * find value for corresponding key in linked list corresponding to bucket which the key is
  * hashed to.Get takes worst case O(N), max time for findcell.Usually expected time is much 
- * less due to loading factor. Expected time is O(1). 1 + REHASH_THRESHOLD/2.
+ * less due to loading factor. Expected time is O(1). 1 + maxLoadFactor/2.
  */
 
 template<typename keyType,typename valueType>
 valueType HashMap<keyType,valueType>::get(const keyType& key) const{
-  int bucket = hashfunction(key)%nBuckets;
-  Cell *cp = findCell(bucket,key);
+  return get(key,hashOf(key));
+}
+
+template<typename keyType,typename valueType>
+valueType HashMap<keyType,valueType>::get(const keyType& key,uint64_t hash) const{
+  Cell *cp = findCell(hash,key);
   return cp==NULL?valueType():cp->value;
 }
 
 /* 
  * Implementation Notes : put
  * ------------------------------------------------------------------------------------------
- * Checks if REHASH THRESHOLD is reached. If yes, expands capacity by approximately doubling 
- * the array size, and updates the nBuckets variable. Rehashing is handles by the expandAndRehash
- * function. puts the the key value pair in apt bucket later.Note that any new element is added
- * to the start of the linked list so that addition operation takes constant time.So, in turn,
- * put takes worst case O(N)[max for find Cell] + O(1) time.Expected time is O(1). 
+ * Same as insertOrAssign. If the key is new, findOrCreateCell checks if REHASH THRESHOLD is
+ * reached and if yes, expands capacity by doubling the array size. Rehashing is handled by the
+ * rehash function. Note that any new element is added to the start of the linked list
+ * so that addition operation takes constant time.So, in turn, put takes worst case O(N)[max for
+ * find Cell] + O(1) time.Expected time is O(1). 
  */
 
 template<typename keyType,typename valueType>
 void HashMap<keyType,valueType>::put(const keyType& key,const valueType& value) {
-  if(cellCount/nBuckets>=REHASH_THRESHHOLD) expandAndRehash();
-  int bucket = hashfunction(key)%nBuckets;
-  Cell *cp = findCell(bucket,key);
-  if(cp==NULL){
-    cp = new Cell;
-    cp->key = key;
-    cp->link = buckets[bucket];
-    buckets[bucket] = cp;
-  }
-  cp->value = value;
-  cellCount++;
+  insertOrAssign(key,value,hashOf(key));
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::put(const keyType& key,const valueType& value,uint64_t hash) {
+  insertOrAssign(key,value,hash);
 }
 
 /*
@@ -248,75 +705,625 @@ void HashMap<keyType,valueType>::put(const keyType& key,const valueType& value)
 
 template<typename keyType,typename valueType>
 bool HashMap<keyType,valueType>::containsKey(const keyType& key) const {
-  int bucket = hashfunction(key)%nBuckets;
-  return findCell(bucket,key)!=NULL;
+  return findCell(hashOf(key),key)!=NULL;
+}
+
+template<typename keyType,typename valueType>
+bool HashMap<keyType,valueType>::containsKey(const keyType& key,uint64_t hash) const {
+  return findCell(hash,key)!=NULL;
 }
 
 /*
- * Implementation Notes : remove
+ * Implementation Notes : remove, removeFound
  * -------------------------------------------------------------------------------------------
- * Removes a particular key by first finding it using findCell. Takes O(N) time in worst case.
- * Expected time is 1+REHASH_THRESHHOLD. O(1).
+ * Removes a particular key by walking its chain with a pointer to the link that points at the
+ * current cell, so the first cell of a chain needs no special case, or by unlinking it from the
+ * bucket's tree. Does nothing if the key is absent. Takes O(log N) time in worst case, thanks to
+ * the trees. Expected time is 1+maxLoadFactor. O(1). Both go through removeCell, which matches
+ * cells by key when given one and by the address of their value otherwise.
  */
 
 template<typename keyType,typename valueType>
 void HashMap<keyType,valueType>::remove(const keyType& key){
-  int bucket = hashfunction(key)%nBuckets;
-  Cell *cp = findCell(bucket,key);
-  Cell *prevCell;
-  for(prevCell = buckets[bucket];(prevCell->link)!=cp;prevCell = prevCell->link){}
-  prevCell->link = cp->link;
+  remove(key,hashOf(key));
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::remove(const keyType& key,uint64_t hash){
+  removeCell(hash,&key,NULL);
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::removeFound(const valueType *value,uint64_t hash){
+  removeCell(hash,NULL,value);
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::removeCell(uint64_t hash,const keyType *key,const valueType *value){
+  int bucket = bucketOf(hash);
+  Cell *cp = NULL;
+  if(trees!=NULL && trees[bucket]!=NULL){
+    cp = unlinkFromTree(bucket,hash,key,value);
+  }else{
+    for(Cell **link = &buckets[bucket];*link!=NULL;link = &(*link)->link){
+      if((*link)->hash==hash && isCellOf(*link,key,value)){
+        cp = *link;
+        *link = cp->link;
+        break;
+      }
+    }
+  }
+  if(cp==NULL) return;
   delete cp;
+  cellCount--;
+  if(filter!=NULL) filter->remove(hash);
+}
+
+template<typename keyType,typename valueType>
+bool HashMap<keyType,valueType>::isCellOf(const Cell *cp,const keyType *key,const valueType *value){
+  return key!=NULL?cp->key==*key:&cp->value==value;
+}
+
+/*
+ * Implementation Notes : hashOf, find
+ * ----------------------------------------------------------------------------------------
+ * find returns the address of the value inside the key's cell, which never moves, as
+ * rehash relinks cells instead of copying them.
+ */
+
+template<typename keyType,typename valueType>
+uint64_t HashMap<keyType,valueType>::hashOf(const keyType& key) const{
+  return hashLookup(key);
+}
+
+template<typename keyType,typename valueType>
+valueType *HashMap<keyType,valueType>::find(const keyType& key){
+  return find(key,hashOf(key));
+}
+
+template<typename keyType,typename valueType>
+const valueType *HashMap<keyType,valueType>::find(const keyType& key) const{
+  return find(key,hashOf(key));
+}
+
+template<typename keyType,typename valueType>
+valueType *HashMap<keyType,valueType>::find(const keyType& key,uint64_t hash){
+  Cell *cp = findCell(hash,key);
+  return cp==NULL?NULL:&cp->value;
+}
+
+template<typename keyType,typename valueType>
+const valueType *HashMap<keyType,valueType>::find(const keyType& key,uint64_t hash) const{
+  Cell *cp = findCell(hash,key);
+  return cp==NULL?NULL:&cp->value;
+}
+
+/*
+ * Implementation Notes : insertOrAssign, tryEmplace, getOrInsert
+ * ----------------------------------------------------------------------------------------
+ * All three make one pass over the key's chain through findOrCreateCell, then decide what
+ * to do with the value depending on whether the cell is new.
+ */
+
+template<typename keyType,typename valueType>
+bool HashMap<keyType,valueType>::insertOrAssign(const keyType& key,const valueType& value){
+  return insertOrAssign(key,value,hashOf(key));
+}
+
+template<typename keyType,typename valueType>
+bool HashMap<keyType,valueType>::insertOrAssign(const keyType& key,const valueType& value,uint64_t hash){
+  bool created;
+  findOrCreateCell(hash,key,created)->value = value;
+  return created;
+}
+
+template<typename keyType,typename valueType>
+bool HashMap<keyType,valueType>::tryEmplace(const keyType& key,const valueType& value){
+  return tryEmplace(key,value,hashOf(key));
+}
+
+template<typename keyType,typename valueType>
+bool HashMap<keyType,valueType>::tryEmplace(const keyType& key,const valueType& value,uint64_t hash){
+  bool created;
+  Cell *cp = findOrCreateCell(hash,key,created);
+  if(created) cp->value = value;
+  return created;
+}
+
+template<typename keyType,typename valueType>
+valueType& HashMap<keyType,valueType>::getOrInsert(const keyType& key){
+  return getOrInsert(key,hashOf(key));
+}
+
+template<typename keyType,typename valueType>
+valueType& HashMap<keyType,valueType>::getOrInsert(const keyType& key,uint64_t hash){
+  bool created;
+  return findOrCreateCell(hash,key,created)->value;
+}
+
+/*
+ * Implementation Notes : Transparent lookups
+ * ----------------------------------------------------------------------------------------
+ * The key is hashed by hashLookup, through the traits of keyType, which must give the same code
+ * as for the equal keyType, and is compared with the stored keys using ==.
+ */
+
+template<typename keyType,typename valueType> template<typename lookupType>
+valueType HashMap<keyType,valueType>::get(const lookupType& key) const{
+  Cell *cp = findCell(hashLookup(key),key);
+  return cp==NULL?valueType():cp->value;
+}
+
+template<typename keyType,typename valueType> template<typename lookupType>
+bool HashMap<keyType,valueType>::containsKey(const lookupType& key) const{
+  return findCell(hashLookup(key),key)!=NULL;
+}
+
+template<typename keyType,typename valueType> template<typename lookupType>
+valueType *HashMap<keyType,valueType>::find(const lookupType& key){
+  Cell *cp = findCell(hashLookup(key),key);
+  return cp==NULL?NULL:&cp->value;
+}
+
+template<typename keyType,typename valueType> template<typename lookupType>
+const valueType *HashMap<keyType,valueType>::find(const lookupType& key) const{
+  Cell *cp = findCell(hashLookup(key),key);
+  return cp==NULL?NULL:&cp->value;
+}
+
+/*
+ * Implementation Notes : putBatch, getBatch
+ * ----------------------------------------------------------------------------------------------
+ * Keys are hashed BATCH_BLOCK at a time into an array on the stack. While key i is probed, the
+ * bucket of key i+2*PREFETCH_DISTANCE is prefetched, and so is the first cell of key
+ * i+PREFETCH_DISTANCE, whose bucket was prefetched earlier and so can be read cheaply by then.
+ * putBatch first grows the table to hold every key of the batch, so that no rehash happens half
+ * way and moves the buckets from under the prefetches; if many keys repeat, the table may be
+ * left larger than put alone would have made it.
+ */
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::putBatch(const keyType *keys,const valueType *values,int n){
+  reserve(cellCount+n);
+  uint64_t hashes[BATCH_BLOCK];
+  for(int start=0;start<n;start+=BATCH_BLOCK){
+    int length = n-start<BATCH_BLOCK?n-start:BATCH_BLOCK;
+    for(int i=0;i<length;i++)
+      hashes[i] = hashOf(keys[start+i]);
+    for(int i=0;i<2*PREFETCH_DISTANCE && i<length;i++)
+      prefetchBucket(hashes[i]);
+    for(int i=0;i<length;i++){
+      if(i+2*PREFETCH_DISTANCE<length) prefetchBucket(hashes[i+2*PREFETCH_DISTANCE]);
+      if(i+PREFETCH_DISTANCE<length) prefetchChain(hashes[i+PREFETCH_DISTANCE]);
+      insertOrAssign(keys[start+i],values[start+i],hashes[i]);
+    }
+  }
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::getBatch(const keyType *keys,valueType *values,int n) const{
+  uint64_t hashes[BATCH_BLOCK];
+  for(int start=0;start<n;start+=BATCH_BLOCK){
+    int length = n-start<BATCH_BLOCK?n-start:BATCH_BLOCK;
+    for(int i=0;i<length;i++)
+      hashes[i] = hashOf(keys[start+i]);
+    for(int i=0;i<2*PREFETCH_DISTANCE && i<length;i++)
+      prefetchBucket(hashes[i]);
+    for(int i=0;i<length;i++){
+      if(i+2*PREFETCH_DISTANCE<length) prefetchBucket(hashes[i+2*PREFETCH_DISTANCE]);
+      if(i+PREFETCH_DISTANCE<length) prefetchChain(hashes[i+PREFETCH_DISTANCE]);
+      Cell *cp = findCell(hashes[i],keys[start+i]);
+      values[start+i] = cp==NULL?valueType():cp->value;
+    }
+  }
+}
+
+/* 
+ * Implementation Notes : bucketOf
+ * ------------------------------------------------------------------------------
+ * Keeps the low bits of the hash code. nBuckets-1 is a mask as nBuckets is a power
+ * of two.
+ */
+
+template<typename keyType,typename valueType>
+int HashMap<keyType,valueType>::bucketOf(uint64_t hash) const{
+  return (int)(hash&(uint64_t)(nBuckets-1));
 }
 
 /* 
  * Implementation Notes : findCell
  * ------------------------------------------------------------------------------------------------
- * Loops to find the address of cell having key attribute equal to passed key in the given bucket.
+ * Loops to find the address of cell having key attribute equal to passed key in the bucket of the
+ * hash code. The chain of a bucket turned into a tree is empty, so the trees are only looked at after
+ * a miss, and hits cost nothing extra. Keys are only compared when the hash codes match. If there is
+ * a filter, hash codes it rules out return NULL before the bucket is read.
  */
 
-template<typename keyType,typename valueType>
-Cell *HashMap<keyType,valueType>::findCell(int bucket,const keyType& key){
+template<typename keyType,typename valueType> template<typename lookupType>
+typename HashMap<keyType,valueType>::Cell *HashMap<keyType,valueType>::findCell(uint64_t hash,const lookupType& key) const{
+  if(filter!=NULL && !filter->mayContain(hash)){
+    recordLookup(false,0);
+    return NULL;
+  }
+  int probes = 0;
+  int bucket = bucketOf(hash);
   Cell *start = buckets[bucket];
   while(start!=NULL){
-    if((start->key)==key)
+    probes++;
+    if(start->hash==hash && (start->key)==key)
       break;
     start = start->link;
   }
+  if(start==NULL && trees!=NULL && trees[bucket]!=NULL)
+    start = findInTree(trees[bucket]->root,hash,key,probes);
+  recordLookup(start!=NULL,probes);
   return start;    
 }
 
 /*
- * Implementation Notes : expandAndRehash
+ * Implementation Notes : findOrCreateCell
+ * ------------------------------------------------------------------------------------------------
+ * Returns the cell of key, creating it at the start of its chain with a default value if there is
+ * none, and sets created accordingly. The table is only expanded when a cell is actually added, and
+ * before adding it, so that the bucket is computed for the new size; it stops doubling at
+ * MAX_BUCKETS, as bucketsFor does, past which chains simply grow. A new cell goes into the tree
+ * of its bucket if there is one; otherwise the chain it lengthened is counted up to just past
+ * TREEIFY_THRESHOLD, and turned into a tree if it got that far.
+ */
+
+template<typename keyType,typename valueType>
+typename HashMap<keyType,valueType>::Cell *HashMap<keyType,valueType>::findOrCreateCell(uint64_t hash,const keyType& key,bool& created){
+  Cell *cp = findCell(hash,key);
+  created = cp==NULL;
+  if(created){
+    if(cellCount>=nBuckets*maxLoadFactor && nBuckets<MAX_BUCKETS) rehash(2*nBuckets);
+    int bucket = bucketOf(hash);
+    cp = new Cell;
+    cp->key = key;
+    cp->value = valueType();
+    cp->hash = hash;
+    cellCount++;
+    if(filter!=NULL) filter->insert(hash);
+    if(trees!=NULL && trees[bucket]!=NULL){
+      insertNode(trees[bucket]->root,cp);
+      trees[bucket]->count++;
+    }else{
+      cp->link = buckets[bucket];
+      buckets[bucket] = cp;
+      int length = 0;
+      for(Cell *next=cp;next!=NULL && length<=TREEIFY_THRESHOLD;next=next->link)
+        length++;
+      if(length>TREEIFY_THRESHOLD) treeify(bucket);
+    }
+  }
+  return cp;
+}
+
+/*
+ * Implementation Notes : bucketsFor, prefetchBucket, prefetchChain
+ * ------------------------------------------------------------------------------------------------
+ * bucketsFor returns the smallest power of two number of buckets, at least INITIAL_BUCKETS, that
+ * holds nCells cells below maxLoadFactor, stopping at MAX_BUCKETS so that the count fits in an int.
+ * The prefetches are only hints, and compile to nothing on compilers without __builtin_prefetch;
+ * prefetchChain reads the bucket, so it is best called once prefetchBucket has brought it in.
+ */
+
+template<typename keyType,typename valueType>
+int HashMap<keyType,valueType>::bucketsFor(int nCells) const{
+  int count = INITIAL_BUCKETS;
+  while(count*maxLoadFactor<=nCells && count<MAX_BUCKETS)
+    count *= 2;
+  return count;
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::prefetchBucket(uint64_t hash) const{
+#ifdef __GNUC__
+  __builtin_prefetch(&buckets[bucketOf(hash)]);
+#endif
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::prefetchChain(uint64_t hash) const{
+#ifdef __GNUC__
+  __builtin_prefetch(buckets[bucketOf(hash)]);
+#endif
+}
+
+/*
+ * Implementation Notes : rehash
  * ------------------------------------------------------------------------------------------------
- * Expands the capacity of the dynamic array of buckets and rehsashes the table.Called in case the
- * REHASH_THRESHHOLD is exceeded. Takes O(N) time.
+ * Resizes the dynamic array of buckets to newnBuckets, a power of two, and rehsashes the table.
+ * Called when maxLoadFactor would be exceeded, and by reserve and shrinkToFit. The existing cells
+ * are moved onto the chains of the new buckets rather than copied, so a cell keeps its address for
+ * as long as its key is in the map. The stored hash codes are reused, unless newHashes asks for them
+ * to be recomputed with hashOf, as harden does. Trees are flattened into the new chains. When the
+ * table grows with no trees and the same codes, each new chain holds part of an old one, so none
+ * can be too long; otherwise every chain is checked afterwards and the long ones are turned into
+ * trees. Takes O(N) time.
  */
 
 template<typename keyType,typename valueType>
-void HashMap<keyType,valueType>::expandAndRehash(){
+void HashMap<keyType,valueType>::rehash(int newnBuckets,bool newHashes){
+#ifdef HASHMAP_STATS
+  chrono::steady_clock::time_point started = chrono::steady_clock::now();
+#endif
   int oldnBuckets = nBuckets;
-  int nBuckets *= 1.0/REHASH_THRESHHOLD;
+  bool checkChains = trees!=NULL || newHashes || newnBuckets<oldnBuckets;
+  nBuckets = newnBuckets;
   Cell **bucketsNew = new Cell*[nBuckets];
+  for(int i=0;i<nBuckets;i++)
+    bucketsNew[i] = NULL;
   for(int i=0;i<oldnBuckets;i++){
-    Cell *start = buckets[i];
+    Cell *start = detachCells(i);
     while(start!=NULL){ 
-      keyType key = start->key;
+      Cell *next = start->link;
+      if(newHashes) start->hash = hashOf(start->key);
+      int bucket = bucketOf(start->hash);
+      start->link = bucketsNew[bucket];
+      bucketsNew[bucket] = start;
+      start = next;
+    }    
+  }
+  delete[] buckets;
+  buckets = bucketsNew;
+  delete[] trees;
+  trees = NULL;
+  if(checkChains) treeifyLongChains();
+  if(filter!=NULL) rebuildFilter();
+#ifdef HASHMAP_STATS
+  rehashCount++;
+  rehashSeconds += chrono::duration<double>(chrono::steady_clock::now()-started).count();
+#endif
+}
 
-      int bucket = hashfunction(key)%nBuckets;
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::rebuildFilter(){
+  int capacity = (int)(nBuckets*maxLoadFactor);
+  delete filter;
+  filter = new CuckooFilter(capacity>cellCount?capacity:cellCount,filterRate);
+  for(int i=0;i<nBuckets;i++){
+    for(Cell *cp=buckets[i];cp!=NULL;cp=cp->link)
+      filter->insert(cp->hash);
+    if(trees!=NULL && trees[i]!=NULL) addTreeToFilter(trees[i]->root);
+  }
+}
 
-      Cell *cp = new Cell;
-      cp->key = key;
-      cp->link = bucketsNew[bucket];
-      cp->value = value;
-      bucketsNew[bucket] = cp;
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::addTreeToFilter(const TreeNode *node){
+  for(;node!=NULL;node=node->right){
+    addTreeToFilter(node->left);
+    for(Cell *cp=node->cells;cp!=NULL;cp=cp->link)
+      filter->insert(cp->hash);
+  }
+}
 
-      start = start->link;
-    }    
+/*
+ * Implementation Notes : detachCells, treeify, untreeify, treeifyLongChains
+ * ------------------------------------------------------------------------------------------------
+ * detachCells empties a bucket and returns its cells as one list, flattening and freeing its tree
+ * if it has one; it only uses the bucket's slots, so rehash can call it on the old arrays. treeify
+ * inserts the cells of a chain into a new tree, allocating the array of trees the first time, and
+ * untreeify puts a tree's cells back on the chain.
+ */
+
+template<typename keyType,typename valueType>
+typename HashMap<keyType,valueType>::Cell *HashMap<keyType,valueType>::detachCells(int bucket){
+  Cell *list = buckets[bucket];
+  buckets[bucket] = NULL;
+  if(trees!=NULL && trees[bucket]!=NULL){
+    list = flattenTree(trees[bucket]->root,list);
+    delete trees[bucket];
+    trees[bucket] = NULL;
   }
-  Cell **oldBuckets = buckets;
-  delete oldBuckets[];
-  buckets = bucketsNew;
+  return list;
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::treeify(int bucket){
+  if(trees==NULL){
+    trees = new TreeBin*[nBuckets];
+    for(int i=0;i<nBuckets;i++)
+      trees[i] = NULL;
+  }
+  TreeBin *bin = new TreeBin;
+  bin->root = NULL;
+  bin->count = 0;
+  Cell *cp = buckets[bucket];
+  buckets[bucket] = NULL;
+  while(cp!=NULL){
+    Cell *next = cp->link;
+    insertNode(bin->root,cp);
+    bin->count++;
+    cp = next;
+  }
+  trees[bucket] = bin;
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::untreeify(int bucket){
+  buckets[bucket] = detachCells(bucket);
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::treeifyLongChains(){
+  for(int i=0;i<nBuckets;i++){
+    int length = 0;
+    for(Cell *cp=buckets[i];cp!=NULL && length<=TREEIFY_THRESHOLD;cp=cp->link)
+      length++;
+    if(length>TREEIFY_THRESHOLD) treeify(i);
+  }
+}
+
+/*
+ * Implementation Notes : findInTree, unlinkFromTree
+ * ------------------------------------------------------------------------------------------------
+ * findInTree descends to the node of the hash code, counting a probe per node, then compares the
+ * keys of its cells. unlinkFromTree removes the cell matched as in removeCell from its node, deletes
+ * the node once it has no cells left, and turns a tree that has become small back into a chain. It
+ * returns the cell, or NULL if there is none.
+ */
+
+template<typename keyType,typename valueType> template<typename lookupType>
+typename HashMap<keyType,valueType>::Cell *HashMap<keyType,valueType>::findInTree(const TreeNode *node,uint64_t hash,const lookupType& key,int& probes){
+  while(node!=NULL){
+    probes++;
+    if(hash<node->hash){
+      node = node->left;
+    }else if(hash>node->hash){
+      node = node->right;
+    }else{
+      for(Cell *cp=node->cells;cp!=NULL;cp=cp->link){
+        if(cp->key==key) return cp;
+        probes++;
+      }
+      return NULL;
+    }
+  }
+  return NULL;
+}
+
+template<typename keyType,typename valueType>
+typename HashMap<keyType,valueType>::Cell *HashMap<keyType,valueType>::unlinkFromTree(int bucket,uint64_t hash,const keyType *key,const valueType *value){
+  TreeBin *bin = trees[bucket];
+  TreeNode *node = bin->root;
+  while(node!=NULL && node->hash!=hash)
+    node = hash<node->hash?node->left:node->right;
+  if(node==NULL) return NULL;
+  for(Cell **link = &node->cells;*link!=NULL;link = &(*link)->link){
+    if(isCellOf(*link,key,value)){
+      Cell *cp = *link;
+      *link = cp->link;
+      if(node->cells==NULL) removeNode(bin->root,hash);
+      if(--bin->count<=UNTREEIFY_THRESHOLD) untreeify(bucket);
+      return cp;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Implementation Notes : insertNode, removeNode, flattenTree
+ * ------------------------------------------------------------------------------------------------
+ * insertNode adds a cell to the node of its hash code, creating the node as a new leaf if there is
+ * none, and removeNode deletes the node of a hash code, replacing a node with two children by the
+ * smallest node of its right subtree. Both recurse down one path and rebalance each node on the way
+ * back, so they take O(log N) time. flattenTree frees the nodes of a tree and returns their cells
+ * pushed onto the front of list.
+ */
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::insertNode(TreeNode* &tree,Cell *cp){
+  if(tree==NULL){
+    tree = new TreeNode;
+    tree->hash = cp->hash;
+    tree->left = tree->right = NULL;
+    tree->height = 1;
+    cp->link = NULL;
+    tree->cells = cp;
+    return;
+  }
+  if(cp->hash==tree->hash){
+    cp->link = tree->cells;
+    tree->cells = cp;
+    return;
+  }
+  insertNode(cp->hash<tree->hash?tree->left:tree->right,cp);
+  rebalance(tree);
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::removeNode(TreeNode* &tree,uint64_t hash){
+  if(tree==NULL) return;
+  if(hash<tree->hash){
+    removeNode(tree->left,hash);
+  }else if(hash>tree->hash){
+    removeNode(tree->right,hash);
+  }else if(tree->left==NULL || tree->right==NULL){
+    TreeNode *oldNode = tree;
+    tree = tree->left!=NULL?tree->left:tree->right;
+    delete oldNode;
+    return;
+  }else{
+    TreeNode *successor = tree->right;
+    while(successor->left!=NULL)
+      successor = successor->left;
+    tree->hash = successor->hash;
+    tree->cells = successor->cells;
+    removeNode(tree->right,successor->hash);
+  }
+  rebalance(tree);
+}
+
+template<typename keyType,typename valueType>
+typename HashMap<keyType,valueType>::Cell *HashMap<keyType,valueType>::flattenTree(TreeNode *tree,Cell *list){
+  while(tree!=NULL){
+    list = flattenTree(tree->left,list);
+    Cell *cp = tree->cells;
+    while(cp!=NULL){
+      Cell *next = cp->link;
+      cp->link = list;
+      list = cp;
+      cp = next;
+    }
+    TreeNode *oldNode = tree;
+    tree = tree->right;
+    delete oldNode;
+  }
+  return list;
+}
+
+/*
+ * Implementation Notes : height, fixHeight, rebalance, rotateLeft, rotateRight
+ * ------------------------------------------------------------------------------------------------
+ * Each node keeps the height of its subtree. rebalance restores the AVL condition at a node whose
+ * subtrees differ in height by two, with a single rotation, or a double one when the taller subtree
+ * leans the other way.
+ */
+
+template<typename keyType,typename valueType>
+int HashMap<keyType,valueType>::height(const TreeNode *tree){
+  return tree==NULL?0:tree->height;
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::fixHeight(TreeNode *tree){
+  int left = height(tree->left), right = height(tree->right);
+  tree->height = 1+(left>right?left:right);
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::rebalance(TreeNode* &tree){
+  int balance = height(tree->right)-height(tree->left);
+  if(balance>1){
+    if(height(tree->right->left)>height(tree->right->right)) rotateRight(tree->right);
+    rotateLeft(tree);
+  }else if(balance<-1){
+    if(height(tree->left->right)>height(tree->left->left)) rotateLeft(tree->left);
+    rotateRight(tree);
+  }else{
+    fixHeight(tree);
+  }
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::rotateLeft(TreeNode* &tree){
+  TreeNode *child = tree->right;
+  tree->right = child->left;
+  child->left = tree;
+  fixHeight(tree);
+  fixHeight(child);
+  tree = child;
+}
+
+template<typename keyType,typename valueType>
+void HashMap<keyType,valueType>::rotateRight(TreeNode* &tree){
+  TreeNode *child = tree->left;
+  tree->left = child->right;
+  child->right = tree;
+  fixHeight(tree);
+  fixHeight(child);
+  tree = child;
 }
 
 
@@ -0,0 +1,464 @@
+/*
+ * File : PersistentHashMap.h
+ * ---------------------------------------------------------------------------------
+ * This file exports a templatized hashmap that lives in a file, so that a map built
+ * once can be reopened by later runs of a program instead of being rebuilt. The file
+ * is mapped into memory, so opening even a very large map takes no time : its pages
+ * are read from disk only when they are first used. Keys and values must be plain
+ * data, copyable byte by byte, such as numbers, structs without pointers and fixed size
+ * character arrays. Only allows unique keys. Needs a POSIX system.
+ */
+
+#ifndef PersistentHashMap_h
+#define PersistentHashMap_h
+
+#include <string>
+#include <random>
+#include <cstring>
+#include <cstddef>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "hashfunctions.h"
+#include "hashfunctions.cpp"
+#include "linearprobing.h"
+using namespace std;
+
+template<typename keyType, typename valueType> class PersistentHashMap{
+
+  static_assert(is_trivially_copyable<keyType>::value && is_trivially_copyable<valueType>::value,
+                "PersistentHashMap needs trivially copyable keys and values");
+
+  /* The public interface for the PersistentHashMap class */
+
+  public :
+
+  /*
+   * Constructor : PersistentHashMap
+   * Usage       : PersistentHashMap<long long,double> prices("prices.map");
+   * ---------------------------------------------------------------------------------------------
+   * Opens the map stored in the file at path, creating an empty one if the file does not exist or
+   * is empty, and makes room for expectedSize pairs. Throws if the file cannot be opened, or holds
+   * something other than a map of these key and value types.
+   */
+
+    PersistentHashMap(const string& path,uint64_t expectedSize = 0);
+
+   /*
+    * Destructor : ~PersistentHashMap
+    * ---------------------------------------------------------------------------------------
+    * Unmaps and closes the file. The operating system still writes changed pages back to the
+    * file afterwards, but only flush guarantees they are on disk.
+    */
+
+    ~PersistentHashMap();
+
+   /*
+    * Methods : size,isEmpty
+    * Usage   : uint64_t n = map.size();
+    * --------------------------------------------------------
+    * Return the number of pairs, and whether there are none.
+    */
+
+    uint64_t size() const;
+    bool isEmpty() const;
+
+   /*
+    * Methods : get,containsKey,find
+    * Usage   : double *price = map.find(id);
+    * -------------------------------------------------------------------------------------------
+    * get returns the value stored for key, or valueType() if key is absent. find returns a
+    * pointer to the value inside the mapped file, or NULL; writing through it changes the file.
+    * The pointer is valid until the next put, reserve or clear, any of which may move the table.
+    * Two keys are equal when their bytes are, so key types must not contain padding bytes.
+    */
+
+    valueType get(const keyType& key) const;
+    bool containsKey(const keyType& key) const;
+    valueType *find(const keyType& key);
+    const valueType *find(const keyType& key) const;
+
+   /*
+    * Methods : put,remove,clear,reserve
+    * Usage   : map.put(key,value);
+    * -------------------------------------------------------------------------------------------
+    * put inserts the pair, overwriting any value stored for key. remove deletes the pair of key,
+    * returning whether there was one. clear deletes all pairs. reserve grows the table at once to
+    * hold n pairs, which saves the repeated doublings of a large load.
+    */
+
+    void put(const keyType& key,const valueType& value);
+    bool remove(const keyType& key);
+    void clear();
+    void reserve(uint64_t n);
+
+   /*
+    * Method : flush
+    * Usage  : map.flush();
+    * ------------------------------------------------------------------------------------
+    * Returns once every change made so far is written to disk, using msync. Throws if the
+    * operating system reports an error.
+    */
+
+    void flush();
+
+  private :
+
+  /*
+   * Representational Notes :
+   * -----------------------------------------------------------------------------------------
+   * The file starts with a Header, padded to DATA_OFFSET bytes, followed by the slot array :
+   * an open addressing table with linear probing, whose capacity is a power of two. A slot
+   * with a hash field of 0 is free; a real hash code of 0 is stored as 1. Removal shifts the
+   * later keys of a run back, so there are no tombstones. Keys are hashed as raw bytes with a
+   * seed picked at random when the file is created and kept in the header.
+   *
+   * The header also records the key and value sizes, so that a file is not opened as a map of
+   * other types, and a checksum of the other header fields, updated with every change, so that
+   * a damaged or foreign file is refused. Slot contents are not checksummed, as that would mean
+   * reading the whole file on opening.
+   *
+   * Growing builds the larger table in a second file, path followed by ".grow", syncs it and
+   * then renames it over the original. A crash in the middle leaves the original file as it
+   * was. The file is created sparse, so the free slots of a new table take no disk space until
+   * written.
+   */
+
+  /* Structures for the file header and slots */
+    struct Header{
+      uint64_t magic;
+      uint32_t version;
+      uint32_t slotSize;
+      uint32_t keySize;
+      uint32_t valueSize;
+      uint64_t capacity;
+      uint64_t count;
+      uint64_t seed;
+      uint64_t checksum;
+    };
+
+    struct Slot{
+      uint64_t hash;
+      keyType key;
+      valueType value;
+    };
+
+  /* Private constants */
+    static const uint64_t MAGIC = 0x50414d4853414850ULL;
+    static const uint32_t VERSION = 1;
+    static const size_t DATA_OFFSET = 64;
+    static const uint64_t INITIAL_SLOTS = 16;
+
+  /* Instance variables */
+    string path;
+    int fd;
+    char *base;
+    size_t mappedBytes;
+    Header *header;
+    Slot *slots;
+
+  /* Private methods */
+    static uint64_t capacityFor(uint64_t n);
+    static size_t fileSize(uint64_t capacity);
+    static char *mapFile(int fd,size_t bytes);
+    uint64_t hashOf(const keyType& key) const;
+    bool findSlot(uint64_t hash,const keyType& key,uint64_t& index) const;
+    void insertSlot(uint64_t hash,const keyType& key,const valueType& value);
+    void eraseSlot(uint64_t index);
+    void updateChecksum();
+    void rebuild(uint64_t newCapacity);
+    void release();
+    void fail(const char *message);
+
+  /* Making copying illegal */
+    PersistentHashMap(const PersistentHashMap<keyType,valueType>& map);
+    PersistentHashMap<keyType,valueType>& operator=(const PersistentHashMap<keyType,valueType>& map);
+};
+
+/*
+ * Implementation Notes : Constructor and Destructor
+ * ----------------------------------------------------------------------------------------
+ * A new file is sized with ftruncate, which fills it with zeros, so every slot starts free.
+ * An existing file is mapped as it is and its header checked before anything else is read.
+ */
+
+template<typename keyType,typename valueType>
+PersistentHashMap<keyType,valueType>::PersistentHashMap(const string& path,uint64_t expectedSize){
+  static_assert(sizeof(Header)<=DATA_OFFSET,"Header does not fit before the slots");
+  this->path = path;
+  base = NULL;
+  mappedBytes = 0;
+  fd = open(path.c_str(),O_RDWR|O_CREAT,0644);
+  if(fd<0) throw "Error : cannot open the map file";
+  struct stat status;
+  if(fstat(fd,&status)!=0) fail("Error : cannot read the size of the map file");
+  if(status.st_size==0){
+    uint64_t capacity = capacityFor(expectedSize);
+    mappedBytes = fileSize(capacity);
+    if(ftruncate(fd,mappedBytes)!=0) fail("Error : cannot size the map file");
+    base = mapFile(fd,mappedBytes);
+    if(base==NULL) fail("Error : cannot map the map file");
+    header = (Header *)base;
+    header->magic = MAGIC;
+    header->version = VERSION;
+    header->slotSize = sizeof(Slot);
+    header->keySize = sizeof(keyType);
+    header->valueSize = sizeof(valueType);
+    header->capacity = capacity;
+    header->count = 0;
+    random_device device;
+    header->seed = ((uint64_t)device()<<32)^device();
+    updateChecksum();
+  }else{
+    mappedBytes = status.st_size;
+    if(mappedBytes<DATA_OFFSET) fail("Error : the file is not a map");
+    base = mapFile(fd,mappedBytes);
+    if(base==NULL) fail("Error : cannot map the map file");
+    header = (Header *)base;
+    if(header->magic!=MAGIC || header->checksum!=hashBytes(header,offsetof(Header,checksum)))
+      fail("Error : the file is not a map, or its header is damaged");
+    if(header->version!=VERSION || header->slotSize!=sizeof(Slot) ||
+       header->keySize!=sizeof(keyType) || header->valueSize!=sizeof(valueType))
+      fail("Error : the file holds a map of other types");
+    uint64_t capacity = header->capacity;
+    if(capacity==0 || (capacity&(capacity-1))!=0 || mappedBytes!=fileSize(capacity))
+      fail("Error : the map file has the wrong size");
+  }
+  slots = (Slot *)(base+DATA_OFFSET);
+  reserve(expectedSize);
+}
+
+template<typename keyType,typename valueType>
+PersistentHashMap<keyType,valueType>::~PersistentHashMap(){
+  release();
+}
+
+template<typename keyType,typename valueType>
+uint64_t PersistentHashMap<keyType,valueType>::size() const{
+  return header->count;
+}
+
+template<typename keyType,typename valueType>
+bool PersistentHashMap<keyType,valueType>::isEmpty() const{
+  return header->count==0;
+}
+
+template<typename keyType,typename valueType>
+valueType PersistentHashMap<keyType,valueType>::get(const keyType& key) const{
+  const valueType *value = find(key);
+  return value==NULL?valueType():*value;
+}
+
+template<typename keyType,typename valueType>
+bool PersistentHashMap<keyType,valueType>::containsKey(const keyType& key) const{
+  return find(key)!=NULL;
+}
+
+template<typename keyType,typename valueType>
+valueType *PersistentHashMap<keyType,valueType>::find(const keyType& key){
+  uint64_t index;
+  return findSlot(hashOf(key),key,index)?&slots[index].value:NULL;
+}
+
+template<typename keyType,typename valueType>
+const valueType *PersistentHashMap<keyType,valueType>::find(const keyType& key) const{
+  uint64_t index;
+  return findSlot(hashOf(key),key,index)?&slots[index].value:NULL;
+}
+
+/*
+ * Implementation Notes : put, remove, clear, reserve
+ * -----------------------------------------------------------------------------------------
+ * The table grows by doubling before a new key would fill more than 70% of it. clear zeroes
+ * the slot array rather than rebuilding the file.
+ */
+
+template<typename keyType,typename valueType>
+void PersistentHashMap<keyType,valueType>::put(const keyType& key,const valueType& value){
+  uint64_t hash = hashOf(key);
+  uint64_t index;
+  if(findSlot(hash,key,index)){
+    slots[index].value = value;
+    return;
+  }
+  if((header->count+1)*10>header->capacity*7){
+    rebuild(2*header->capacity);
+  }
+  insertSlot(hash,key,value);
+  header->count++;
+  updateChecksum();
+}
+
+template<typename keyType,typename valueType>
+bool PersistentHashMap<keyType,valueType>::remove(const keyType& key){
+  uint64_t index;
+  if(!findSlot(hashOf(key),key,index)) return false;
+  eraseSlot(index);
+  header->count--;
+  updateChecksum();
+  return true;
+}
+
+template<typename keyType,typename valueType>
+void PersistentHashMap<keyType,valueType>::clear(){
+  memset((void *)slots,0,header->capacity*sizeof(Slot));
+  header->count = 0;
+  updateChecksum();
+}
+
+template<typename keyType,typename valueType>
+void PersistentHashMap<keyType,valueType>::reserve(uint64_t n){
+  uint64_t capacity = capacityFor(n);
+  if(capacity>header->capacity) rebuild(capacity);
+}
+
+template<typename keyType,typename valueType>
+void PersistentHashMap<keyType,valueType>::flush(){
+  updateChecksum();
+  if(msync(base,mappedBytes,MS_SYNC)!=0) throw "Error : cannot write the map to disk";
+}
+
+/*
+ * Implementation Notes : capacityFor, fileSize, mapFile
+ * -----------------------------------------------------------------------------------------
+ * capacityFor returns the smallest power of two, at least INITIAL_SLOTS, that holds n keys
+ * at a load of at most 70%. mapFile returns NULL rather than MAP_FAILED on failure.
+ */
+
+template<typename keyType,typename valueType>
+uint64_t PersistentHashMap<keyType,valueType>::capacityFor(uint64_t n){
+  uint64_t capacity = INITIAL_SLOTS;
+  while(capacity*7<n*10)
+    capacity *= 2;
+  return capacity;
+}
+
+template<typename keyType,typename valueType>
+size_t PersistentHashMap<keyType,valueType>::fileSize(uint64_t capacity){
+  return DATA_OFFSET+capacity*sizeof(Slot);
+}
+
+template<typename keyType,typename valueType>
+char *PersistentHashMap<keyType,valueType>::mapFile(int fd,size_t bytes){
+  void *address = mmap(NULL,bytes,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+  return address==MAP_FAILED?NULL:(char *)address;
+}
+
+/*
+ * Implementation Notes : hashOf, findSlot
+ * ---------------------------------------------------------------------------------------
+ * The table is never full, so the probe in findSlot always ends at a free slot if the key
+ * is absent.
+ */
+
+template<typename keyType,typename valueType>
+uint64_t PersistentHashMap<keyType,valueType>::hashOf(const keyType& key) const{
+  uint64_t hash = hashBytes(&key,sizeof(keyType),header->seed);
+  return hash==0?1:hash;
+}
+
+template<typename keyType,typename valueType>
+bool PersistentHashMap<keyType,valueType>::findSlot(uint64_t hash,const keyType& key,uint64_t& index) const{
+  uint64_t mask = header->capacity-1;
+  for(uint64_t i=hash&mask;slots[i].hash!=0;i=(i+1)&mask){
+    if(slots[i].hash==hash && memcmp(&slots[i].key,&key,sizeof(keyType))==0){
+      index = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * Implementation Notes : insertSlot, eraseSlot
+ * -----------------------------------------------------------------------------------------
+ * Both work on the mapped slots in place, so a change reaches the file when the pages are
+ * written back. eraseSlot zeroes the slot closeGap leaves over with memset, which clears any
+ * padding in it too, so that the file holds no stale bytes of a removed pair.
+ */
+
+template<typename keyType,typename valueType>
+void PersistentHashMap<keyType,valueType>::insertSlot(uint64_t hash,const keyType& key,const valueType& value){
+  Slot& slot = slots[probeFreeSlot(slots,header->capacity-1,hash)];
+  slot.hash = hash;
+  slot.key = key;
+  slot.value = value;
+}
+
+template<typename keyType,typename valueType>
+void PersistentHashMap<keyType,valueType>::eraseSlot(uint64_t index){
+  memset((void *)&slots[closeGap(slots,header->capacity-1,index)],0,sizeof(Slot));
+}
+
+template<typename keyType,typename valueType>
+void PersistentHashMap<keyType,valueType>::updateChecksum(){
+  header->checksum = hashBytes(header,offsetof(Header,checksum));
+}
+
+/*
+ * Implementation Notes : rebuild
+ * -----------------------------------------------------------------------------------------
+ * Copies every pair into a new file of newCapacity slots, then swaps it in. The stored hash
+ * codes are reused, as the seed does not change. If anything fails before the rename, the
+ * new file is removed and the map is left as it was.
+ */
+
+template<typename keyType,typename valueType>
+void PersistentHashMap<keyType,valueType>::rebuild(uint64_t newCapacity){
+  string newPath = path+".grow";
+  int newFd = open(newPath.c_str(),O_RDWR|O_CREAT|O_TRUNC,0644);
+  if(newFd<0) throw "Error : cannot create the file to grow the map into";
+  size_t newBytes = fileSize(newCapacity);
+  char *newBase = ftruncate(newFd,newBytes)==0?mapFile(newFd,newBytes):NULL;
+  if(newBase==NULL){
+    close(newFd);
+    unlink(newPath.c_str());
+    throw "Error : cannot size the file to grow the map into";
+  }
+  Header *newHeader = (Header *)newBase;
+  Slot *newSlots = (Slot *)(newBase+DATA_OFFSET);
+  *newHeader = *header;
+  newHeader->capacity = newCapacity;
+  newHeader->checksum = hashBytes(newHeader,offsetof(Header,checksum));
+  for(uint64_t s=0;s<header->capacity;s++){
+    if(slots[s].hash!=0)
+      newSlots[probeFreeSlot(newSlots,newCapacity-1,slots[s].hash)] = slots[s];
+  }
+  if(msync(newBase,newBytes,MS_SYNC)!=0 || rename(newPath.c_str(),path.c_str())!=0){
+    munmap(newBase,newBytes);
+    close(newFd);
+    unlink(newPath.c_str());
+    throw "Error : cannot replace the map file with the grown one";
+  }
+  release();
+  fd = newFd;
+  base = newBase;
+  mappedBytes = newBytes;
+  header = newHeader;
+  slots = newSlots;
+}
+
+/*
+ * Implementation Notes : release, fail
+ * ------------------------------------------------------------------------------
+ * release unmaps and closes the file, if open. fail does so and throws message,
+ * for errors found while opening.
+ */
+
+template<typename keyType,typename valueType>
+void PersistentHashMap<keyType,valueType>::release(){
+  if(base!=NULL) munmap(base,mappedBytes);
+  if(fd>=0) close(fd);
+  base = NULL;
+  fd = -1;
+}
+
+template<typename keyType,typename valueType>
+void PersistentHashMap<keyType,valueType>::fail(const char *message){
+  release();
+  throw message;
+}
+
+#endif
@@ -0,0 +1,451 @@
+/*
+ * File : SplitOrderedHashMap.h
+ * ---------------------------------------------------------------------------------
+ * This file exports a templatized lock-free hashmap. put, get and remove never wait
+ * for another thread : a thread that is delayed or descheduled in the middle of an
+ * operation cannot hold the others up. Only allows unique keys.
+ */
+
+#ifndef SplitOrderedHashMap_h
+#define SplitOrderedHashMap_h
+
+#include <atomic>
+#include <stdint.h>
+#include "hashfunctions.h"
+#include "hashfunctions.cpp"
+#include "EpochReclaimer.h"
+using namespace std;
+
+template<typename keyType, typename valueType> class SplitOrderedHashMap{
+
+  /* The public interface for the SplitOrderedHashMap class */
+
+  public :
+
+  /*
+   * Constructor : SplitOrderedHashMap
+   * Usage       : SplitOrderedHashMap<string,int> map;
+   * -----------------------------------------------------------
+   * Initialise an empty map.
+   */
+
+    SplitOrderedHashMap();
+
+   /*
+    * Destructor : ~SplitOrderedHashMap
+    * ---------------------------------------------------------------------------
+    * Frees any heap memory associated with the map. No thread may be using it.
+    */
+
+    ~SplitOrderedHashMap();
+
+   /*
+    * Method : size
+    * Usage  : long n = map.size();
+    * -------------------------------------------------------------------------
+    * Returns the number of key value pairs, exact once no thread is writing.
+    */
+
+    long size() const;
+
+   /*
+    * Methods : get,tryGet,containsKey
+    * Usage   : if(map.tryGet(key,value)) ...
+    * ---------------------------------------------------------------------------------------
+    * get returns the value stored for key, or valueType() if key is absent. tryGet stores
+    * the value in value and returns true if key is present, and returns false otherwise.
+    */
+
+    valueType get(const keyType& key) const;
+    bool tryGet(const keyType& key,valueType& value) const;
+    bool containsKey(const keyType& key) const;
+
+   /*
+    * Methods : put,remove
+    * Usage   : map.put(key,value);
+    * ----------------------------------------------------------------------------------------
+    * put inserts the key value pair, overwriting any value stored for key. remove deletes the
+    * pair of key, if any, and returns whether there was one.
+    */
+
+    void put(const keyType& key,const valueType& value);
+    bool remove(const keyType& key);
+
+   /*
+    * Method : forEach
+    * Usage  : map.forEach(printPair);
+    * ----------------------------------------------------------------------------------------
+    * Calls function(key,value) for every pair, in no particular order. Pairs put or removed
+    * by other threads during the walk may or may not be seen. Memory retired by other threads
+    * is not freed until the walk ends, so the function should be quick.
+    */
+
+    template<typename Function> void forEach(Function function) const;
+
+  private :
+
+  /*
+   * Representational Notes :
+   * -----------------------------------------------------------------------------------------
+   * All pairs are cells of a single sorted linked list, the split-ordered list of Shalev and
+   * Shavit. A cell is sorted by its hash code with the bits reversed, so the cells of bucket
+   * b of a table of 2^k buckets, those whose low k bits of hash equal b, form one contiguous
+   * run. Splitting a bucket in two when the table doubles only needs a new entry point in the
+   * middle of its run, so cells never move. Each bucket points at a sentinel cell heading its
+   * run. Sentinels are created the first time a bucket is used, by inserting them after the
+   * sentinel of the parent bucket, b with its highest bit cleared, which is created first if
+   * need be. Sentinels sort before the cells of their bucket because their reversed key has a
+   * low bit of 0, while cell keys have it set.
+   *
+   * The list is the lock-free list of Harris and Michael. A cell is removed in two steps : a
+   * compare-and-swap sets the low bit of its next link, which stops any insert after it, then
+   * another unlinks it. Any thread that meets a marked cell helps unlink it. Unlinked cells
+   * and replaced values go to the EpochReclaimer, which deletes them once no thread can still
+   * be reading them.
+   *
+   * The bucket array is a directory of segments that are never moved : segment 0 holds bucket
+   * 0, and segment i holds buckets 2^(i-1) to 2^i - 1. A segment is allocated the first time
+   * one of its buckets is used. The table doubles when there are more than LOAD_FACTOR cells
+   * per bucket, simply by doubling bucketCount.
+   */
+
+  /* Private constants */
+    static const int LOAD_FACTOR = 2;
+    static const int MAX_SEGMENTS = 64;
+
+  /* Structure for a cell or sentinel */
+    struct Cell{
+      uint64_t splitKey;
+      keyType key;
+      atomic<valueType *> value;
+      atomic<uintptr_t> next;
+    };
+
+  /* Instance variables */
+    mutable atomic<atomic<Cell *> *> segments[MAX_SEGMENTS];
+    atomic<uint64_t> bucketCount;
+    atomic<long> cellCount;
+
+  /* Private methods */
+    static uint64_t reverseBits(uint64_t bits);
+    static uint64_t cellKey(uint64_t hash);
+    static uint64_t sentinelKey(uint64_t bucket);
+    static Cell *pointerOf(uintptr_t link);
+    static Cell *newCell(uint64_t splitKey,const keyType& key,valueType *value);
+    static void deleteCell(void *cell);
+    static void deleteValue(void *value);
+    static bool findInList(Cell *head,uint64_t splitKey,const keyType& key,bool sentinel,
+                           atomic<uintptr_t> *&previous,Cell *&current);
+    atomic<Cell *>& bucketSlot(uint64_t bucket) const;
+    Cell *bucketHead(uint64_t bucket) const;
+    Cell *findCell(uint64_t hash,const keyType& key) const;
+
+  /* Making copying illegal */
+    SplitOrderedHashMap(const SplitOrderedHashMap<keyType,valueType>& map);
+    SplitOrderedHashMap<keyType,valueType>& operator=(const SplitOrderedHashMap<keyType,valueType>& map);
+};
+
+/*
+ * Implementation Notes : Constructor and Destructor
+ * ----------------------------------------------------------------------------------------
+ * The sentinel of bucket 0 heads the whole list and is made by the constructor. The
+ * destructor deletes the cells still linked; those already retired belong to the reclaimer.
+ */
+
+template<typename keyType,typename valueType>
+SplitOrderedHashMap<keyType,valueType>::SplitOrderedHashMap(){
+  for(int i=0;i<MAX_SEGMENTS;i++)
+    segments[i].store(NULL);
+  bucketCount.store(2);
+  cellCount.store(0);
+  bucketSlot(0).store(newCell(sentinelKey(0),keyType(),NULL));
+}
+
+template<typename keyType,typename valueType>
+SplitOrderedHashMap<keyType,valueType>::~SplitOrderedHashMap(){
+  Cell *cell = bucketSlot(0).load();
+  while(cell!=NULL){
+    Cell *next = pointerOf(cell->next.load());
+    deleteCell(cell);
+    cell = next;
+  }
+  for(int i=0;i<MAX_SEGMENTS;i++)
+    delete[] segments[i].load();
+}
+
+template<typename keyType,typename valueType>
+long SplitOrderedHashMap<keyType,valueType>::size() const{
+  return cellCount.load(memory_order_relaxed);
+}
+
+/*
+ * Implementation Notes : get, tryGet, containsKey
+ * ---------------------------------------------------------------------------------------
+ * The value is copied while the guard is held, as a concurrent put may retire it as soon
+ * as the guard is released.
+ */
+
+template<typename keyType,typename valueType>
+valueType SplitOrderedHashMap<keyType,valueType>::get(const keyType& key) const{
+  valueType value = valueType();
+  tryGet(key,value);
+  return value;
+}
+
+template<typename keyType,typename valueType>
+bool SplitOrderedHashMap<keyType,valueType>::tryGet(const keyType& key,valueType& value) const{
+  EpochGuard guard;
+  Cell *cell = findCell(HashTraits<keyType>::hash(key),key);
+  if(cell==NULL) return false;
+  value = *cell->value.load(memory_order_acquire);
+  return true;
+}
+
+template<typename keyType,typename valueType>
+bool SplitOrderedHashMap<keyType,valueType>::containsKey(const keyType& key) const{
+  EpochGuard guard;
+  return findCell(HashTraits<keyType>::hash(key),key)!=NULL;
+}
+
+/*
+ * Implementation Notes : put
+ * ---------------------------------------------------------------------------------------
+ * An existing key has its value pointer swapped and the old value retired. Otherwise a new
+ * cell is linked in with one compare-and-swap on the link found for it; if the link changed
+ * meanwhile, the search is repeated, and may now find the key put by another thread.
+ */
+
+template<typename keyType,typename valueType>
+void SplitOrderedHashMap<keyType,valueType>::put(const keyType& key,const valueType& value){
+  EpochGuard guard;
+  uint64_t hash = HashTraits<keyType>::hash(key);
+  uint64_t splitKey = cellKey(hash);
+  Cell *head = bucketHead(hash&(bucketCount.load(memory_order_acquire)-1));
+  valueType *fresh = new valueType(value);
+  Cell *cell = NULL;
+  atomic<uintptr_t> *previous;
+  Cell *current;
+  while(true){
+    if(findInList(head,splitKey,key,false,previous,current)){
+      valueType *old = current->value.exchange(fresh,memory_order_acq_rel);
+      EpochReclaimer::instance().retire(old,deleteValue);
+      if(cell!=NULL){
+        cell->value.store(NULL,memory_order_relaxed);
+        deleteCell(cell);
+      }
+      return;
+    }
+    if(cell==NULL) cell = newCell(splitKey,key,fresh);
+    cell->next.store((uintptr_t)current,memory_order_relaxed);
+    uintptr_t expected = (uintptr_t)current;
+    if(previous->compare_exchange_strong(expected,(uintptr_t)cell,memory_order_release,memory_order_relaxed))
+      break;
+  }
+  long count = cellCount.fetch_add(1,memory_order_relaxed)+1;
+  uint64_t buckets = bucketCount.load(memory_order_relaxed);
+  if((uint64_t)count>buckets*LOAD_FACTOR && buckets<((uint64_t)1<<(MAX_SEGMENTS-2)))
+    bucketCount.compare_exchange_strong(buckets,2*buckets,memory_order_release,memory_order_relaxed);
+}
+
+/*
+ * Implementation Notes : remove
+ * ----------------------------------------------------------------------------------------
+ * The thread whose compare-and-swap marks the cell is the one that removed the key. It then
+ * tries to unlink the cell itself, and if that fails searches again, which unlinks it.
+ */
+
+template<typename keyType,typename valueType>
+bool SplitOrderedHashMap<keyType,valueType>::remove(const keyType& key){
+  EpochGuard guard;
+  uint64_t hash = HashTraits<keyType>::hash(key);
+  uint64_t splitKey = cellKey(hash);
+  Cell *head = bucketHead(hash&(bucketCount.load(memory_order_acquire)-1));
+  atomic<uintptr_t> *previous;
+  Cell *current;
+  while(true){
+    if(!findInList(head,splitKey,key,false,previous,current)) return false;
+    uintptr_t next = current->next.load(memory_order_acquire);
+    if(next&1) continue;
+    if(current->next.compare_exchange_strong(next,next|1,memory_order_acq_rel,memory_order_relaxed))
+      break;
+  }
+  uintptr_t expected = (uintptr_t)current;
+  uintptr_t next = current->next.load(memory_order_relaxed)&~(uintptr_t)1;
+  if(previous->compare_exchange_strong(expected,next,memory_order_acq_rel,memory_order_relaxed))
+    EpochReclaimer::instance().retire(current,deleteCell);
+  else
+    findInList(head,splitKey,key,false,previous,current);
+  cellCount.fetch_sub(1,memory_order_relaxed);
+  return true;
+}
+
+template<typename keyType,typename valueType> template<typename Function>
+void SplitOrderedHashMap<keyType,valueType>::forEach(Function function) const{
+  EpochGuard guard;
+  Cell *cell = pointerOf(bucketSlot(0).load(memory_order_acquire)->next.load(memory_order_acquire));
+  while(cell!=NULL){
+    uintptr_t next = cell->next.load(memory_order_acquire);
+    if((cell->splitKey&1) && !(next&1))
+      function(cell->key,*cell->value.load(memory_order_acquire));
+    cell = pointerOf(next);
+  }
+}
+
+/*
+ * Implementation Notes : reverseBits, cellKey, sentinelKey
+ * ---------------------------------------------------------------------------------
+ * reverseBits swaps ever larger blocks of bits. A cell key has its low bit set, which
+ * costs the top bit of the hash in the ordering; cells with equal split keys are told
+ * apart by comparing their keys.
+ */
+
+template<typename keyType,typename valueType>
+uint64_t SplitOrderedHashMap<keyType,valueType>::reverseBits(uint64_t bits){
+  bits = ((bits>>1)&0x5555555555555555ULL)|((bits&0x5555555555555555ULL)<<1);
+  bits = ((bits>>2)&0x3333333333333333ULL)|((bits&0x3333333333333333ULL)<<2);
+  bits = ((bits>>4)&0x0F0F0F0F0F0F0F0FULL)|((bits&0x0F0F0F0F0F0F0F0FULL)<<4);
+  bits = ((bits>>8)&0x00FF00FF00FF00FFULL)|((bits&0x00FF00FF00FF00FFULL)<<8);
+  bits = ((bits>>16)&0x0000FFFF0000FFFFULL)|((bits&0x0000FFFF0000FFFFULL)<<16);
+  return (bits>>32)|(bits<<32);
+}
+
+template<typename keyType,typename valueType>
+uint64_t SplitOrderedHashMap<keyType,valueType>::cellKey(uint64_t hash){
+  return reverseBits(hash)|1;
+}
+
+template<typename keyType,typename valueType>
+uint64_t SplitOrderedHashMap<keyType,valueType>::sentinelKey(uint64_t bucket){
+  return reverseBits(bucket);
+}
+
+/*
+ * Implementation Notes : pointerOf, newCell, deleteCell, deleteValue
+ * -------------------------------------------------------------------------------
+ * A link is a cell address whose low bit marks the cell holding it as removed.
+ * deleteCell and deleteValue have the signature the EpochReclaimer expects.
+ */
+
+template<typename keyType,typename valueType>
+typename SplitOrderedHashMap<keyType,valueType>::Cell *SplitOrderedHashMap<keyType,valueType>::pointerOf(uintptr_t link){
+  return (Cell *)(link&~(uintptr_t)1);
+}
+
+template<typename keyType,typename valueType>
+typename SplitOrderedHashMap<keyType,valueType>::Cell *SplitOrderedHashMap<keyType,valueType>::newCell(uint64_t splitKey,const keyType& key,valueType *value){
+  Cell *cell = new Cell;
+  cell->splitKey = splitKey;
+  cell->key = key;
+  cell->value.store(value,memory_order_relaxed);
+  cell->next.store(0,memory_order_relaxed);
+  return cell;
+}
+
+template<typename keyType,typename valueType>
+void SplitOrderedHashMap<keyType,valueType>::deleteCell(void *cell){
+  delete ((Cell *)cell)->value.load(memory_order_relaxed);
+  delete (Cell *)cell;
+}
+
+template<typename keyType,typename valueType>
+void SplitOrderedHashMap<keyType,valueType>::deleteValue(void *value){
+  delete (valueType *)value;
+}
+
+/*
+ * Implementation Notes : findInList
+ * -------------------------------------------------------------------------------------------
+ * Walks from head to the first cell not sorting before (splitKey,key), unlinking and retiring
+ * any marked cell on the way. On return previous is the link that points at current, the
+ * place to insert the key, and the result tells whether current holds the key itself. If an
+ * unlink fails, the list changed around the walk and it starts again from head, which is a
+ * sentinel and so is never removed.
+ */
+
+template<typename keyType,typename valueType>
+bool SplitOrderedHashMap<keyType,valueType>::findInList(Cell *head,uint64_t splitKey,const keyType& key,bool sentinel,
+                                                        atomic<uintptr_t> *&previous,Cell *&current){
+  retry:
+  previous = &head->next;
+  current = pointerOf(previous->load(memory_order_acquire));
+  while(current!=NULL){
+    uintptr_t next = current->next.load(memory_order_acquire);
+    if(next&1){
+      uintptr_t expected = (uintptr_t)current;
+      if(!previous->compare_exchange_strong(expected,next&~(uintptr_t)1,memory_order_acq_rel,memory_order_relaxed))
+        goto retry;
+      EpochReclaimer::instance().retire(current,deleteCell);
+      current = pointerOf(next);
+      continue;
+    }
+    if(current->splitKey>splitKey) return false;
+    if(current->splitKey==splitKey && (sentinel || current->key==key)) return true;
+    previous = &current->next;
+    current = pointerOf(next);
+  }
+  return false;
+}
+
+/*
+ * Implementation Notes : bucketSlot, bucketHead
+ * -----------------------------------------------------------------------------------------
+ * bucketSlot finds the directory entry of a bucket, allocating its segment if need be; of
+ * two threads racing to allocate, the loser frees its copy. bucketHead creates a missing
+ * sentinel after its parent's. Racing threads find each other's sentinel in the list and
+ * store the same one in the directory.
+ */
+
+template<typename keyType,typename valueType>
+atomic<typename SplitOrderedHashMap<keyType,valueType>::Cell *>& SplitOrderedHashMap<keyType,valueType>::bucketSlot(uint64_t bucket) const{
+  int segment = bucket==0?0:64-__builtin_clzll(bucket);
+  uint64_t first = segment==0?0:(uint64_t)1<<(segment-1);
+  atomic<Cell *> *slots = segments[segment].load(memory_order_acquire);
+  if(slots==NULL){
+    uint64_t length = segment==0?1:first;
+    atomic<Cell *> *fresh = new atomic<Cell *>[length];
+    for(uint64_t i=0;i<length;i++)
+      fresh[i].store(NULL,memory_order_relaxed);
+    if(segments[segment].compare_exchange_strong(slots,fresh,memory_order_acq_rel,memory_order_acquire)){
+      slots = fresh;
+    }else{
+      delete[] fresh;
+    }
+  }
+  return slots[bucket-first];
+}
+
+template<typename keyType,typename valueType>
+typename SplitOrderedHashMap<keyType,valueType>::Cell *SplitOrderedHashMap<keyType,valueType>::bucketHead(uint64_t bucket) const{
+  atomic<Cell *>& slot = bucketSlot(bucket);
+  Cell *head = slot.load(memory_order_acquire);
+  if(head!=NULL) return head;
+  Cell *parentHead = bucketHead(bucket&~((uint64_t)1<<(63-__builtin_clzll(bucket))));
+  uint64_t splitKey = sentinelKey(bucket);
+  Cell *sentinel = newCell(splitKey,keyType(),NULL);
+  atomic<uintptr_t> *previous;
+  Cell *current;
+  while(true){
+    if(findInList(parentHead,splitKey,keyType(),true,previous,current)){
+      deleteCell(sentinel);
+      sentinel = current;
+      break;
+    }
+    sentinel->next.store((uintptr_t)current,memory_order_relaxed);
+    uintptr_t expected = (uintptr_t)current;
+    if(previous->compare_exchange_strong(expected,(uintptr_t)sentinel,memory_order_release,memory_order_relaxed))
+      break;
+  }
+  slot.store(sentinel,memory_order_release);
+  return sentinel;
+}
+
+template<typename keyType,typename valueType>
+typename SplitOrderedHashMap<keyType,valueType>::Cell *SplitOrderedHashMap<keyType,valueType>::findCell(uint64_t hash,const keyType& key) const{
+  Cell *head = bucketHead(hash&(bucketCount.load(memory_order_acquire)-1));
+  atomic<uintptr_t> *previous;
+  Cell *current;
+  if(findInList(head,cellKey(hash),key,false,previous,current)) return current;
+  return NULL;
+}
+
+#endif
@@ -0,0 +1,298 @@
+/*
+ * File : hashfunctions.cpp
+ * ------------------------------------------------------------------------------------
+ * Implementation of the hash functions exported by hashfunctions.h. Every map header
+ * includes this file directly, so it has its own include guard, which lets one source
+ * file include several of them, and every function is declared inline to allow several
+ * source files of one program to include them.
+ */
+
+#ifndef _hashfunctions_cpp
+#define _hashfunctions_cpp
+
+#include "hashfunctions.h"
+#include <cstring>
+#include <random>
+
+/* Constants for the byte hash, the default secret of wyhash */
+  const uint64_t HASH_SECRET0 = 0x2d358dccaa6c78a5ULL;
+  const uint64_t HASH_SECRET1 = 0x8bb84b93962eacc9ULL;
+  const uint64_t HASH_SECRET2 = 0x4b33a62ed433d4a3ULL;
+  const uint64_t HASH_SECRET3 = 0x4d5a2da51de1aa47ULL;
+
+/*
+ * Implementation Notes : multiply128,multiplyMix
+ * ------------------------------------------------------------------------------------
+ * multiply128 replaces a and b with the low and high words of their 128 bit product,
+ * and multiplyMix folds the two words together with xor. Uses the compiler's 128 bit
+ * integers where available, otherwise four 32 bit multiplies.
+ */
+
+  inline void multiply128(uint64_t &a,uint64_t &b){
+#ifdef __SIZEOF_INT128__
+    __uint128_t product = (__uint128_t)a*b;
+    a = (uint64_t)product;
+    b = (uint64_t)(product>>64);
+#else
+    uint64_t aLow = (uint32_t)a, aHigh = a>>32;
+    uint64_t bLow = (uint32_t)b, bHigh = b>>32;
+    uint64_t lowLow = aLow*bLow, lowHigh = aLow*bHigh;
+    uint64_t highLow = aHigh*bLow, highHigh = aHigh*bHigh;
+    uint64_t middle = (lowLow>>32)+(uint32_t)lowHigh+(uint32_t)highLow;
+    a = (middle<<32)|(uint32_t)lowLow;
+    b = highHigh+(lowHigh>>32)+(highLow>>32)+(middle>>32);
+#endif
+  }
+
+  inline uint64_t multiplyMix(uint64_t a,uint64_t b){
+    multiply128(a,b);
+    return a^b;
+  }
+
+/*
+ * Implementation Notes : readWord,readHalfWord
+ * --------------------------------------------------------------------------------
+ * Read 8 or 4 bytes from any address. memcpy compiles to a single load on machines
+ * that allow unaligned loads.
+ */
+
+  inline uint64_t readWord(const unsigned char *p){
+    uint64_t word;
+    memcpy(&word,p,sizeof(word));
+    return word;
+  }
+
+  inline uint64_t readHalfWord(const unsigned char *p){
+    uint32_t word;
+    memcpy(&word,p,sizeof(word));
+    return word;
+  }
+
+/*
+ * Implementation Notes : hashBytes
+ * ----------------------------------------------------------------------------------------
+ * Follows wyhash. Inputs of up to 16 bytes are read as two possibly overlapping words.
+ * Longer inputs are consumed 48 bytes at a time by three independent lanes, which keeps
+ * several multiplies in flight, then 16 bytes at a time. The last 16 bytes are always read
+ * as two words, overlapping the previous block if need be, and mixed with the length.
+ */
+
+  inline uint64_t hashBytes(const void *data,size_t length,uint64_t seed){
+    const unsigned char *p = (const unsigned char *)data;
+    seed ^= multiplyMix(seed^HASH_SECRET0,HASH_SECRET1);
+    uint64_t a,b;
+    if(length<=16){
+      if(length>=4){
+        size_t middle = (length>>3)<<2;
+        a = (readHalfWord(p)<<32)|readHalfWord(p+middle);
+        b = (readHalfWord(p+length-4)<<32)|readHalfWord(p+length-4-middle);
+      }else if(length>0){
+        a = ((uint64_t)p[0]<<16)|((uint64_t)p[length>>1]<<8)|p[length-1];
+        b = 0;
+      }else{
+        a = b = 0;
+      }
+    }else{
+      size_t remaining = length;
+      if(remaining>48){
+        uint64_t seed1 = seed, seed2 = seed;
+        do{
+          seed = multiplyMix(readWord(p)^HASH_SECRET1,readWord(p+8)^seed);
+          seed1 = multiplyMix(readWord(p+16)^HASH_SECRET2,readWord(p+24)^seed1);
+          seed2 = multiplyMix(readWord(p+32)^HASH_SECRET3,readWord(p+40)^seed2);
+          p += 48;
+          remaining -= 48;
+        }while(remaining>48);
+        seed ^= seed1^seed2;
+      }
+      while(remaining>16){
+        seed = multiplyMix(readWord(p)^HASH_SECRET1,readWord(p+8)^seed);
+        p += 16;
+        remaining -= 16;
+      }
+      a = readWord(p+remaining-16);
+      b = readWord(p+remaining-8);
+    }
+    a ^= HASH_SECRET1;
+    b ^= seed;
+    multiply128(a,b);
+    return multiplyMix(a^HASH_SECRET0^length,b^HASH_SECRET1);
+  }
+
+/*
+ * Implementation Notes : mixBits
+ * ----------------------------------------------------------------------------------
+ * The finalizer of splitmix64 : two multiply-xorshift rounds with odd constants.
+ */
+
+  inline uint64_t mixBits(uint64_t key){
+    key ^= key>>30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key>>27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key>>31;
+    return key;
+  }
+
+/*
+ * Implementation Notes : sipRound, sipHash
+ * ------------------------------------------------------------------------------------
+ * Follows the SipHash reference with one round per 8 byte word and three to finish, the
+ * variant Rust's HashMap uses. The last word holds the remaining bytes and the length
+ * in its top byte. Words are read in the machine's byte order, so big endian machines
+ * get different, equally good, codes from the reference.
+ */
+
+  inline uint64_t rotateBits(uint64_t word,int count){
+    return (word<<count)|(word>>(64-count));
+  }
+
+  inline void sipRound(uint64_t &v0,uint64_t &v1,uint64_t &v2,uint64_t &v3){
+    v0 += v1; v1 = rotateBits(v1,13); v1 ^= v0; v0 = rotateBits(v0,32);
+    v2 += v3; v3 = rotateBits(v3,16); v3 ^= v2;
+    v0 += v3; v3 = rotateBits(v3,21); v3 ^= v0;
+    v2 += v1; v1 = rotateBits(v1,17); v1 ^= v2; v2 = rotateBits(v2,32);
+  }
+
+  inline uint64_t sipHash(const void *data,size_t length,const HashSeed &seed){
+    const unsigned char *p = (const unsigned char *)data;
+    uint64_t v0 = seed.k0^0x736f6d6570736575ULL;
+    uint64_t v1 = seed.k1^0x646f72616e646f6dULL;
+    uint64_t v2 = seed.k0^0x6c7967656e657261ULL;
+    uint64_t v3 = seed.k1^0x7465646279746573ULL;
+    size_t remaining = length;
+    while(remaining>=8){
+      uint64_t word = readWord(p);
+      v3 ^= word;
+      sipRound(v0,v1,v2,v3);
+      v0 ^= word;
+      p += 8;
+      remaining -= 8;
+    }
+    uint64_t last = (uint64_t)length<<56;
+    for(size_t i=0;i<remaining;i++)
+      last |= (uint64_t)p[i]<<(8*i);
+    v3 ^= last;
+    sipRound(v0,v1,v2,v3);
+    v0 ^= last;
+    v2 ^= 0xff;
+    sipRound(v0,v1,v2,v3);
+    sipRound(v0,v1,v2,v3);
+    sipRound(v0,v1,v2,v3);
+    return v0^v1^v2^v3;
+  }
+
+  inline HashSeed randomHashSeed(){
+    random_device source;
+    HashSeed seed;
+    seed.k0 = ((uint64_t)source()<<32)^source();
+    seed.k1 = ((uint64_t)source()<<32)^source();
+    return seed;
+  }
+
+/*
+ * Implementation Notes : HashTraits
+ * -------------------------------------------------------------------------------------
+ * Doubles are hashed by their bit pattern, with 0.0 and -0.0 given the same code since
+ * they compare equal. Signed integers are converted to unsigned so that negative keys
+ * hash the same way whatever their width.
+ */
+
+  inline uint64_t HashTraits<string>::hash(const string &key){
+    return hashBytes(key.data(),key.size());
+  }
+
+  inline uint64_t HashTraits<string>::hash(const char *key){
+    return hashBytes(key,strlen(key));
+  }
+
+#if __cplusplus >= 201703L
+  inline uint64_t HashTraits<string>::hash(string_view key){
+    return hashBytes(key.data(),key.size());
+  }
+#endif
+
+  inline uint64_t HashTraits<char>::hash(char key){
+    return mixBits((unsigned char)key);
+  }
+
+  inline uint64_t HashTraits<int>::hash(int key){
+    return mixBits((uint64_t)(long long)key);
+  }
+
+  inline uint64_t HashTraits<unsigned int>::hash(unsigned int key){
+    return mixBits(key);
+  }
+
+  inline uint64_t HashTraits<long>::hash(long key){
+    return mixBits((uint64_t)(long long)key);
+  }
+
+  inline uint64_t HashTraits<unsigned long>::hash(unsigned long key){
+    return mixBits(key);
+  }
+
+  inline uint64_t HashTraits<long long>::hash(long long key){
+    return mixBits((uint64_t)key);
+  }
+
+  inline uint64_t HashTraits<unsigned long long>::hash(unsigned long long key){
+    return mixBits(key);
+  }
+
+  inline uint64_t HashTraits<double>::hash(double key){
+    if(key==0) return mixBits(0);
+    uint64_t bits;
+    memcpy(&bits,&key,sizeof(bits));
+    return mixBits(bits);
+  }
+
+  template<typename T>
+  uint64_t HashTraits<T *>::hash(const T *key){
+    return mixBits((uintptr_t)key);
+  }
+
+  template<typename keyType> template<typename lookupType>
+  uint64_t KeyedHashTraits<keyType>::hash(const lookupType &key,const HashSeed &seed){
+    uint64_t code = HashTraits<keyType>::hash(key);
+    return sipHash(&code,sizeof(code),seed);
+  }
+
+  inline uint64_t KeyedHashTraits<string>::hash(const string &key,const HashSeed &seed){
+    return sipHash(key.data(),key.size(),seed);
+  }
+
+  inline uint64_t KeyedHashTraits<string>::hash(const char *key,const HashSeed &seed){
+    return sipHash(key,strlen(key),seed);
+  }
+
+#if __cplusplus >= 201703L
+  inline uint64_t KeyedHashTraits<string>::hash(string_view key,const HashSeed &seed){
+    return sipHash(key.data(),key.size(),seed);
+  }
+#endif
+
+/*
+ * Implementation Notes : shardBitsFor, topBits
+ * ---------------------------------------------------------------------------------------
+ * topBits shifts by 63-count and then by 1 rather than by 64-count at once, since a shift
+ * by 64 is undefined and 0 shard bits are common.
+ */
+
+  inline int shardBitsFor(int n){
+    int bits = 0;
+    while(bits<30 && (1<<bits)<n)
+      bits++;
+    return bits;
+  }
+
+  inline size_t topBits(uint64_t hash,int count){
+    return (size_t)((hash>>(63-count))>>1);
+  }
+
+  template<typename keyType>
+  uint64_t hashfunction(const keyType &key){
+    return HashTraits<keyType>::hash(key);
+  }
+
+#endif
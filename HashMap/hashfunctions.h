@@ -0,0 +1,139 @@
+/*
+ * File : hashfunctions.h
+ * ---------------------------------------------------------------------------------
+ * This file exports the hash functions used by the HashMap class : a fast byte hash
+ * for strings, a strong mixer for integers and pointers, and the HashTraits template
+ * which picks one of them for each key type at compile time. The implementations are
+ * in hashfunctions.cpp.
+ */
+
+#ifndef _hashfunctions_h
+#define _hashfunctions_h
+
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+using namespace std;
+
+/*
+ * Function : hashBytes
+ * Usage    : uint64_t code = hashBytes(text.data(),text.size());
+ * ---------------------------------------------------------------------------------------
+ * Returns a 64 bit hash of length bytes, in the style of wyhash : the input is read eight
+ * bytes at a time and every pair of words is mixed with one 64x64->128 bit multiply. Short
+ * inputs take a handful of instructions. Different seeds give unrelated hash functions.
+ */
+
+  inline uint64_t hashBytes(const void *data,size_t length,uint64_t seed = 0);
+
+/*
+ * Function : mixBits
+ * Usage    : uint64_t code = mixBits(key);
+ * ---------------------------------------------------------------------------------------
+ * Returns a 64 bit hash of an integer. Every input bit affects every output bit, so that
+ * keys that differ only in their high bits, or are multiples of a power of two, still fall
+ * into different buckets when only the low bits of the hash are used.
+ */
+
+  inline uint64_t mixBits(uint64_t key);
+
+/*
+ * Template : HashTraits
+ * Usage    : uint64_t code = HashTraits<keyType>::hash(key);
+ * ---------------------------------------------------------------------------------------
+ * Chooses the hash function of a key type. Equal keys always have equal hash codes.
+ * Integers, characters and doubles go through mixBits, strings through hashBytes, and
+ * pointers are hashed by address, so two pointers are the same key only if they point at
+ * the same object. Other key types can be supported by specializing HashTraits.
+ * HashTraits<string> also hashes const char* and, from C++17, string_view the same way
+ * as the equal string, so that HashMap can look string keys up without building one.
+ */
+
+  template<typename keyType> struct HashTraits;
+
+  template<> struct HashTraits<string>{
+    static uint64_t hash(const string &key);
+    static uint64_t hash(const char *key);
+#if __cplusplus >= 201703L
+    static uint64_t hash(string_view key);
+#endif
+  };
+  template<> struct HashTraits<char>{ static uint64_t hash(char key); };
+  template<> struct HashTraits<int>{ static uint64_t hash(int key); };
+  template<> struct HashTraits<unsigned int>{ static uint64_t hash(unsigned int key); };
+  template<> struct HashTraits<long>{ static uint64_t hash(long key); };
+  template<> struct HashTraits<unsigned long>{ static uint64_t hash(unsigned long key); };
+  template<> struct HashTraits<long long>{ static uint64_t hash(long long key); };
+  template<> struct HashTraits<unsigned long long>{ static uint64_t hash(unsigned long long key); };
+  template<> struct HashTraits<double>{ static uint64_t hash(double key); };
+  template<typename T> struct HashTraits<T *>{ static uint64_t hash(const T *key); };
+
+/*
+ * Type     : HashSeed
+ * Function : sipHash
+ * Usage    : uint64_t code = sipHash(text.data(),text.size(),seed);
+ * ---------------------------------------------------------------------------------------
+ * Returns the SipHash-1-3 of length bytes under the 128 bit secret seed. hashBytes is built
+ * for speed, and anyone who knows it can compute inputs whose codes share their low bits;
+ * sipHash is a keyed pseudorandom function, so without the seed such inputs cannot be found.
+ * It takes a few times longer. randomHashSeed draws a seed from std::random_device.
+ */
+
+  struct HashSeed{
+    uint64_t k0;
+    uint64_t k1;
+  };
+
+  inline uint64_t sipHash(const void *data,size_t length,const HashSeed &seed);
+  inline HashSeed randomHashSeed();
+
+/*
+ * Template : KeyedHashTraits
+ * Usage    : uint64_t code = KeyedHashTraits<keyType>::hash(key,seed);
+ * ---------------------------------------------------------------------------------------
+ * Chooses the keyed hash of a key type, which hardened HashMaps use. Strings, and the other
+ * types HashTraits<string> accepts, go through sipHash directly. Other keys are hashed with
+ * HashTraits first and the code then goes through sipHash, which is just as safe as long as
+ * distinct keys never share a HashTraits code : true of the integers, characters, doubles and
+ * pointers above, whose codes are one-to-one. A key type whose codes can collide should
+ * specialize KeyedHashTraits as well.
+ */
+
+  template<typename keyType> struct KeyedHashTraits{
+    template<typename lookupType> static uint64_t hash(const lookupType &key,const HashSeed &seed);
+  };
+
+  template<> struct KeyedHashTraits<string>{
+    static uint64_t hash(const string &key,const HashSeed &seed);
+    static uint64_t hash(const char *key,const HashSeed &seed);
+#if __cplusplus >= 201703L
+    static uint64_t hash(string_view key,const HashSeed &seed);
+#endif
+  };
+
+/*
+ * Functions : shardBitsFor, topBits
+ * Usage     : Shard& shard = shards[topBits(hash,shardBits)];
+ * ---------------------------------------------------------------------------------------
+ * Sharded maps pick the shard of a key from the top bits of its hash code, as the table in
+ * each shard indexes by the low bits. shardBitsFor returns the number of bits that address
+ * n shards rounded up to a power of two, at most 30; topBits returns the top count bits of
+ * hash, or 0 when count is 0.
+ */
+
+  inline int shardBitsFor(int n);
+  inline size_t topBits(uint64_t hash,int count);
+
+/*
+ * Function : hashfunction
+ * Usage    : uint64_t code = hashfunction(key);
+ * ---------------------------------------------------------------------
+ * Returns HashTraits<keyType>::hash(key), choosing keyType from the key.
+ */
+
+  template<typename keyType> uint64_t hashfunction(const keyType &key);
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * File : linearprobing.h
+ * ---------------------------------------------------------------------------------
+ * This file exports the slot routines shared by the open addressing maps, the
+ * ConcurrentHashMap and the PersistentHashMap. Both keep a power of two array of
+ * slots, each a hash, key and value, in which a hash of 0 marks a free slot and a
+ * key lives in the first free slot at or after its home slot, hash&mask.
+ */
+
+#ifndef _linearprobing_h
+#define _linearprobing_h
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+using namespace std;
+
+/*
+ * Functions : slotHash, setSlotHash
+ * Usage     : if(slotHash(slots[i].hash)==0) ...
+ * ---------------------------------------------------------------------------------------
+ * Read and write the hash field of a slot, which is a plain uint64_t in a PersistentHashMap
+ * and an atomic one, accessed with relaxed ordering, in a ConcurrentHashMap.
+ */
+
+  inline uint64_t slotHash(const uint64_t& field);
+  inline uint64_t slotHash(const atomic<uint64_t>& field);
+  inline void setSlotHash(uint64_t& field,uint64_t hash);
+  inline void setSlotHash(atomic<uint64_t>& field,uint64_t hash);
+
+/*
+ * Function : probeFreeSlot
+ * Usage    : size_t index = probeFreeSlot(slots,mask,hash);
+ * ---------------------------------------------------------------------------------------
+ * Returns the first free slot at or after the home slot of hash, where a key known to be
+ * absent belongs. The array must hold at least one free slot.
+ */
+
+  template<typename Slot> size_t probeFreeSlot(const Slot *slots,size_t mask,uint64_t hash);
+
+/*
+ * Function : closeGap
+ * Usage    : freeSlot(slots[closeGap(slots,mask,index)]);
+ * ---------------------------------------------------------------------------------------
+ * Removes the key in slots[index] by moving later keys of its run back over it, and returns
+ * the slot left over at the end, which the caller frees in its own way. Every key stays
+ * reachable from its home slot, without tombstones.
+ */
+
+  template<typename Slot> size_t closeGap(Slot *slots,size_t mask,size_t index);
+
+/*
+ * Implementation Notes : slotHash, setSlotHash
+ * ---------------------------------------------------------------------------------------
+ * Overloaded on the type of the field, so the routines below compile for both kinds of slot.
+ */
+
+inline uint64_t slotHash(const uint64_t& field){
+  return field;
+}
+
+inline uint64_t slotHash(const atomic<uint64_t>& field){
+  return field.load(memory_order_relaxed);
+}
+
+inline void setSlotHash(uint64_t& field,uint64_t hash){
+  field = hash;
+}
+
+inline void setSlotHash(atomic<uint64_t>& field,uint64_t hash){
+  field.store(hash,memory_order_relaxed);
+}
+
+/*
+ * Implementation Notes : probeFreeSlot, closeGap
+ * ---------------------------------------------------------------------------------------
+ * closeGap walks the run after the gap until a free slot. A key at i whose home is not
+ * cyclically in (gap,i] would be cut off from its home by the gap, so it moves into the gap
+ * and its old slot becomes the gap; (i-home)&mask>=(i-gap)&mask tests exactly that. A key is
+ * moved field by field, the hash last, as an atomic hash cannot be assigned as a whole.
+ */
+
+template<typename Slot>
+size_t probeFreeSlot(const Slot *slots,size_t mask,uint64_t hash){
+  size_t i = hash&mask;
+  while(slotHash(slots[i].hash)!=0)
+    i = (i+1)&mask;
+  return i;
+}
+
+template<typename Slot>
+size_t closeGap(Slot *slots,size_t mask,size_t index){
+  size_t gap = index;
+  for(size_t i=(index+1)&mask;;i=(i+1)&mask){
+    uint64_t hash = slotHash(slots[i].hash);
+    if(hash==0) break;
+    size_t home = hash&mask;
+    if(((i-home)&mask)>=((i-gap)&mask)){
+      slots[gap].key = slots[i].key;
+      slots[gap].value = slots[i].value;
+      setSlotHash(slots[gap].hash,hash);
+      gap = i;
+    }
+  }
+  return gap;
+}
+
+#endif
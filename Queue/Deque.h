@@ -0,0 +1,423 @@
+/*
+ * File : Deque.h
+ * ----------------------------------------------------------------------------------
+ * Interface and implementation for a double ended queue, which adds and removes
+ * elements at both ends in constant time and reads any element by index. Elements
+ * are stored in fixed size blocks and never move once added, so a reference to one
+ * stays valid until it is removed, unlike in the array queue, which copies its
+ * elements on every expansion, and without the allocation per element of the
+ * linked queue.
+ */
+
+#ifndef _Deque_h
+#define _Deque_h
+
+#include <cstddef>
+#include <stdint.h>
+
+template<typename valueType> class Deque{
+
+  /* Public interface for the deque class */
+  public:
+
+  /*
+   * Constructor : Deque
+   * Usage       : Deque<valueType> deque;
+   * --------------------------------------
+   * Initializes an empty deque.
+   */
+
+   Deque();
+
+  /*
+   * Destructor : ~Deque
+   * Usage      : Usually implicit.
+   * ------------------------------------------------
+   * Frees the heap memory associated with the deque.
+   */
+
+   ~Deque();
+
+  /*
+   * Methods : size,isEmpty,clear
+   * Usage   : if(deque.isEmpty()) //Some code
+   * ---------------------------------------------------------------------------
+   * Return the number of elements, whether there are none, and remove them all.
+   */
+
+   int size() const;
+   bool isEmpty() const;
+   void clear();
+
+  /*
+   * Methods : pushFront,pushBack
+   * Usage   : deque.pushBack(value);
+   * -------------------------------------------------------------------------------------------
+   * Add value before the first element or after the last one. Both take constant time in the
+   * worst case, and never move the elements already in the deque.
+   */
+
+   void pushFront(valueType value);
+   void pushBack(valueType value);
+
+  /*
+   * Methods : popFront,popBack
+   * Usage   : valueType value = deque.popFront();
+   * -------------------------------------------------------------------------------------------
+   * Remove the first or the last element and return it, in constant time in the worst case.
+   * Throw an error if the deque is empty.
+   */
+
+   valueType popFront();
+   valueType popBack();
+
+  /*
+   * Methods : front,back
+   * Usage   : deque.front() = value;
+   * -------------------------------------------------------------------------------------------
+   * Return the first or the last element by reference. Throw an error if the deque is empty.
+   */
+
+   valueType& front();
+   valueType& back();
+
+  /*
+   * Methods : get,set
+   * Usage   : deque.set(0,deque.get(1));
+   * -------------------------------------------------------------------------------------------
+   * Read or overwrite the element at index, counting from the front. Throw an error if index is
+   * out of bounds.
+   */
+
+   valueType get(int index) const;
+   void set(int index,valueType value);
+
+  /*
+   * Operator : []
+   * Usage    : deque[2] = 30;
+   * -------------------------------------------------------------------------------------------
+   * Returns the element at index, counting from the front, by reference, in constant time. The
+   * reference stays valid until that element is removed, whatever is added or removed elsewhere.
+   * Throws an error if index is out of bounds.
+   */
+
+   valueType& operator[](int index);
+   const valueType& operator[](int index) const;
+
+   /* Copy constructor and assignment operator */
+
+   Deque(const Deque<valueType>& src);
+   Deque<valueType>& operator=(const Deque<valueType>& src);
+
+  /* Implementation part */
+  private:
+
+  /*
+   * Notes on representation
+   * -------------------------------------------------------------------------------------------
+   * Elements live in blocks of BLOCK_SIZE, a power of two chosen so that a block fills about 512
+   * bytes. Every element has a position, a 64 bit number that goes down by one for each element
+   * added at the front and up by one at the back; the element at position e sits at offset e %
+   * BLOCK_SIZE of block e / BLOCK_SIZE. The deque holds the blocks numbered frontBlock up to
+   * backBlock, exclusive, and its elements are the count positions from first. Positions start
+   * in the middle of the 64 bit range, so they never wrap.
+   *
+   * The map is a circular array of block pointers whose size is a power of two, block b being at
+   * map[b % mapCapacity]. Finding an element is two shifts, a mask and two loads. A block is added
+   * when an end reaches the edge of the last one, and freed when an end leaves it; one freed block
+   * is kept as spare, so that an end going to and fro across a block edge does not allocate.
+   *
+   * The map itself would have to be copied into a larger one as the deque grows, which would make
+   * the push that fills it take time in proportion to the size of the deque. Instead, once half the
+   * map is in use, a map of twice the size is allocated and every block added later first copies
+   * two of the block pointers into it, blocks added meanwhile going into both. The copying finishes
+   * before the old map can fill, and the larger map then replaces it, so no single operation does
+   * more than a constant amount of work. The elements themselves are never copied.
+   */
+
+  /* Private constants */
+  static const int BLOCK_SHIFT = sizeof(valueType)<=8?6:sizeof(valueType)<=16?5:sizeof(valueType)<=32?4:3;
+  static const int BLOCK_SIZE = 1<<BLOCK_SHIFT;
+  static const int INITIAL_MAP_CAPACITY = 8;
+  static const int COPIES_PER_STEP = 2;
+
+  /* Instance variables for a deque object */
+  valueType **map;
+  uint64_t mapCapacity;
+  valueType **newMap;
+  uint64_t nextToCopy;
+  valueType *spare;
+  uint64_t frontBlock;
+  uint64_t backBlock;
+  uint64_t first;
+  int count;
+
+  /* Private methods */
+  void initialize();
+  void freeBlocks();
+  valueType& element(uint64_t position) const;
+  void addBlock(uint64_t block);
+  void releaseBlock(uint64_t block);
+  void growMap();
+  void deepCopy(const Deque<valueType>& src);
+};
+
+/*
+ * Method : Constructor and Destructor
+ * ----------------------------------------------------------------------
+ * The constructor allocates the map but no block; the destructor frees
+ * every block, the spare one and the maps.
+ */
+
+  template<typename valueType>
+  Deque<valueType>::Deque(){
+    initialize();
+  }
+
+  template<typename valueType>
+  Deque<valueType>::~Deque(){
+    freeBlocks();
+  }
+
+/*
+ * Method : size, isEmpty, clear
+ * ----------------------------------------------------------------------------
+ * size and isEmpty use the count. clear frees every block and starts afresh.
+ */
+
+  template<typename valueType>
+  int Deque<valueType>::size() const{
+    return count;
+  }
+
+  template<typename valueType>
+  bool Deque<valueType>::isEmpty() const{
+    return count==0;
+  }
+
+  template<typename valueType>
+  void Deque<valueType>::clear(){
+    freeBlocks();
+    initialize();
+  }
+
+/*
+ * Method : pushFront, pushBack
+ * ---------------------------------------------------------------------------------------------
+ * Add a block first if the new position falls outside the blocks held, then store the value.
+ */
+
+  template<typename valueType>
+  void Deque<valueType>::pushFront(valueType value){
+    if(first==frontBlock<<BLOCK_SHIFT){
+      addBlock(frontBlock-1);
+      frontBlock--;
+    }
+    first--;
+    count++;
+    element(first) = value;
+  }
+
+  template<typename valueType>
+  void Deque<valueType>::pushBack(valueType value){
+    uint64_t position = first+count;
+    if(position==backBlock<<BLOCK_SHIFT){
+      addBlock(backBlock);
+      backBlock++;
+    }
+    count++;
+    element(position) = value;
+  }
+
+/*
+ * Method : popFront, popBack
+ * ---------------------------------------------------------------------------------------------
+ * The slot left behind is reset to valueType(), so that it lets go of any memory the value held,
+ * and its block is freed if it was the last element in it.
+ */
+
+  template<typename valueType>
+  valueType Deque<valueType>::popFront(){
+    if(isEmpty()) throw "Error : Cannot pop from an empty deque.";
+    valueType result = element(first);
+    element(first) = valueType();
+    first++;
+    count--;
+    if(first==(frontBlock+1)<<BLOCK_SHIFT){
+      releaseBlock(frontBlock);
+      frontBlock++;
+    }
+    return result;
+  }
+
+  template<typename valueType>
+  valueType Deque<valueType>::popBack(){
+    if(isEmpty()) throw "Error : Cannot pop from an empty deque.";
+    count--;
+    uint64_t position = first+count;
+    valueType result = element(position);
+    element(position) = valueType();
+    if(position==(backBlock-1)<<BLOCK_SHIFT){
+      releaseBlock(backBlock-1);
+      backBlock--;
+      if(count==0) first = backBlock<<BLOCK_SHIFT;
+    }
+    return result;
+  }
+
+/*
+ * Method : front, back, get, set, operator []
+ * ---------------------------------------------------------------------------------------------
+ * Check that the deque is not empty or that index is in bounds, then go through element.
+ */
+
+  template<typename valueType>
+  valueType& Deque<valueType>::front(){
+    if(isEmpty()) throw "Error : Cannot peek at an empty deque.";
+    return element(first);
+  }
+
+  template<typename valueType>
+  valueType& Deque<valueType>::back(){
+    if(isEmpty()) throw "Error : Cannot peek at an empty deque.";
+    return element(first+count-1);
+  }
+
+  template<typename valueType>
+  valueType Deque<valueType>::get(int index) const{
+    if(index<0 || index>=count) throw "Error : Index out of bounds";
+    return element(first+index);
+  }
+
+  template<typename valueType>
+  void Deque<valueType>::set(int index,valueType value){
+    if(index<0 || index>=count) throw "Error : Index out of bounds";
+    element(first+index) = value;
+  }
+
+  template<typename valueType>
+  valueType& Deque<valueType>::operator[](int index){
+    if(index<0 || index>=count) throw "Error : Index out of bounds";
+    return element(first+index);
+  }
+
+  template<typename valueType>
+  const valueType& Deque<valueType>::operator[](int index) const{
+    if(index<0 || index>=count) throw "Error : Index out of bounds";
+    return element(first+index);
+  }
+
+/* Methods : Copy constructor and assignment operator */
+
+  template<typename valueType>
+  Deque<valueType>::Deque(const Deque<valueType>& src){
+    initialize();
+    deepCopy(src);
+  }
+
+  template<typename valueType>
+  Deque<valueType>& Deque<valueType>::operator=(const Deque<valueType>& src){
+    if(this!=&src){
+      clear();
+      deepCopy(src);
+    }
+    return *this;
+  }
+
+/* Implementation of private methods */
+
+/*
+ * Method : initialize, freeBlocks, deepCopy
+ * ---------------------------------------------------------------------------------------------
+ * initialize sets up an empty deque, with its positions in the middle of the range. freeBlocks
+ * frees what initialize and the pushes allocated. deepCopy pushes the elements of src in order.
+ */
+
+  template<typename valueType>
+  void Deque<valueType>::initialize(){
+    mapCapacity = INITIAL_MAP_CAPACITY;
+    map = new valueType*[mapCapacity];
+    newMap = NULL;
+    nextToCopy = 0;
+    spare = NULL;
+    frontBlock = backBlock = (uint64_t)1<<(62-BLOCK_SHIFT);
+    first = frontBlock<<BLOCK_SHIFT;
+    count = 0;
+  }
+
+  template<typename valueType>
+  void Deque<valueType>::freeBlocks(){
+    for(uint64_t block=frontBlock;block<backBlock;block++)
+      delete[] map[block&(mapCapacity-1)];
+    delete[] spare;
+    delete[] map;
+    delete[] newMap;
+  }
+
+  template<typename valueType>
+  void Deque<valueType>::deepCopy(const Deque<valueType>& src){
+    for(int i=0;i<src.count;i++)
+      pushBack(src.element(src.first+i));
+  }
+
+/*
+ * Method : element, addBlock, releaseBlock
+ * ---------------------------------------------------------------------------------------------
+ * element finds the slot of a position in the old map, which holds every block until the new
+ * one takes over. addBlock lets growMap take its step, then stores a block, the spare one if there
+ * is one, in both maps while the copying is under way; releaseBlock keeps the block as spare, or
+ * frees it if there already is one.
+ */
+
+  template<typename valueType>
+  valueType& Deque<valueType>::element(uint64_t position) const{
+    return map[(position>>BLOCK_SHIFT)&(mapCapacity-1)][position&(BLOCK_SIZE-1)];
+  }
+
+  template<typename valueType>
+  void Deque<valueType>::addBlock(uint64_t block){
+    growMap();
+    valueType *storage = spare;
+    if(storage==NULL) storage = new valueType[BLOCK_SIZE];
+    spare = NULL;
+    map[block&(mapCapacity-1)] = storage;
+    if(newMap!=NULL) newMap[block&(2*mapCapacity-1)] = storage;
+  }
+
+  template<typename valueType>
+  void Deque<valueType>::releaseBlock(uint64_t block){
+    valueType *storage = map[block&(mapCapacity-1)];
+    if(spare==NULL) spare = storage;
+    else delete[] storage;
+  }
+
+/*
+ * Method : growMap
+ * ---------------------------------------------------------------------------------------------
+ * Called before every block is added. Starts copying into a map twice the size once half the map
+ * holds blocks, and otherwise copies the next COPIES_PER_STEP block pointers, skipping blocks
+ * already popped from the front; blocks added behind the copying were stored in both maps by
+ * addBlock. Copying two pointers for each block added keeps ahead, so the copying of the blocks
+ * present when it started, half the map, ends once a quarter of the map more has been added, well
+ * before the old map is full. The larger map then replaces the old one.
+ */
+
+  template<typename valueType>
+  void Deque<valueType>::growMap(){
+    if(newMap==NULL){
+      if(backBlock-frontBlock+1<mapCapacity/2) return;
+      newMap = new valueType*[2*mapCapacity];
+      nextToCopy = frontBlock;
+    }
+    if(nextToCopy<frontBlock) nextToCopy = frontBlock;
+    for(int i=0;i<COPIES_PER_STEP && nextToCopy<backBlock;i++,nextToCopy++)
+      newMap[nextToCopy&(2*mapCapacity-1)] = map[nextToCopy&(mapCapacity-1)];
+    if(nextToCopy>=backBlock){
+      delete[] map;
+      map = newMap;
+      mapCapacity *= 2;
+      newMap = NULL;
+    }
+  }
+
+#endif
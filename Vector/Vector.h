@@ -8,6 +8,8 @@
 #ifndef _Vector_h
 #define _Vector_h
 
+#include <cstddef>
+
 template<typename valueType> class Vector{
 
   /* Interface for the Vector class */
@@ -118,15 +120,28 @@ template<typename valueType> class Vector{
     * Usage    : vec[2] = 30;
     * ------------------------------------------------------------------------------------------------
     * Overloads the [] operator for the vector class.Returns the value at the specified index if used
-    * as a rvalue. If used as a lvalue, overwrites the value at the given index. 
+    * as a rvalue. If used as a lvalue, overwrites the value at the given index. Throws an error if
+    * index is out of bounds.
     */
     
-    valueType& operator=(int index);
-    
+    valueType& operator[](int index);
+    const valueType& operator[](int index) const;
+
+   /*
+    * Method : data
+    * Usage  : const int *elements = vec.data();
+    * ---------------------------------------------------------------------------------------------
+    * Returns the address of the first element; the elements follow it in order. Lets tight loops
+    * read the vector without a bounds check per element. The address is only valid until the
+    * vector next grows.
+    */
+
+    valueType *data();
+    const valueType *data() const;
 
     /* Copy constructor and assignment operator */
 
-    Vector(const Vector<valueTye> &vec);
+    Vector(const Vector<valueType> &vec);
     Vector<valueType>& operator=(const Vector<valueType> &Vec); 
        
   private :
@@ -142,16 +157,16 @@ template<typename valueType> class Vector{
   static const int INITIAL_CAPACITY = 10;
   
   /* Instance variables */
-  Vector* array;
+  valueType* array;
   int capacity;
   int count;
 
   /* Private methods */
 
-  deepCopy(const Vector<valueType> &src);
-  expandCapacity();
+  void deepCopy(const Vector<valueType> &src);
+  void expandCapacity();
   
-}
+};
 
 /*
  * Implementation Notes : Constructor and Destructor
@@ -168,13 +183,14 @@ template<typename valueType> class Vector{
   } 
 
   template<typename valueType>
-  Vector<valueType>::Vector(int size, valueType defaultVal = valueType()){
-    capacity = INITIAL_CAPACITY;
+  Vector<valueType>::Vector(int size, valueType defaultVal){
+    if(size<0) throw "Error : Negative size";
+    capacity = size>INITIAL_CAPACITY?size:INITIAL_CAPACITY;
     array = new valueType[capacity];
+    count=size;
     for(int i=0;i<count;i++){
       array[i] = defaultVal;
     }
-    count=size;
   } 
 
   template<typename valueType>
@@ -216,13 +232,13 @@ template<typename valueType> class Vector{
   }
 
   template<typename valueType>
-  valueType Vector<valueType>::set(int index,valueType value) const{
+  void Vector<valueType>::set(int index,valueType value){
     if(index<0 || index>=count) throw "Error : Index out of bounds";
     array[index] = value;
   }
 
 /*
- * Implementation Notes : operator []
+ * Implementation Notes : operator [], data
  * ------------------------------------------------------------------------------------------------- 
  * Checks to see whether index is out of bounds. Throws an error if index is less than 0 or greater
  * than count[current number of elements]. Returns by reference to make sure that it can be used 
@@ -230,11 +246,27 @@ template<typename valueType> class Vector{
  */
 
   template<typename valueType>
-  valueType& Vector<valueType>::operator=(int index){
+  valueType& Vector<valueType>::operator[](int index){
     if(index<0 || index>=count) throw "Error : Index out of bounds";
     return array[index];
   }
 
+  template<typename valueType>
+  const valueType& Vector<valueType>::operator[](int index) const{
+    if(index<0 || index>=count) throw "Error : Index out of bounds";
+    return array[index];
+  }
+
+  template<typename valueType>
+  valueType *Vector<valueType>::data(){
+    return array;
+  }
+
+  template<typename valueType>
+  const valueType *Vector<valueType>::data() const{
+    return array;
+  }
+
 /* 
  * Implementation Notes : insert,remove,add
  * -------------------------------------------------------------------------------
@@ -247,7 +279,7 @@ template<typename valueType> class Vector{
   void Vector<valueType>::insert(int index, valueType value){
     if(index<0||index>count) throw "Error : Index out of bounds"; 
     if(capacity==count) expandCapacity();
-    for(int i= count;i>=index;i--){
+    for(int i= count;i>index;i--){
       array[i] = array[i-1];
     }
     array[index] = value;
@@ -257,10 +289,9 @@ template<typename valueType> class Vector{
   template<typename valueType>
   void Vector<valueType>::remove(int index){
     if(index<0||index>=count) throw "Error : Index out of bounds"; 
-    for(int i= index;i<count;i++){
+    for(int i= index;i<count-1;i++){
       array[i] = array[i+1];
     }
-    array[index] = value;
     count--;
   } 
 
@@ -268,6 +299,7 @@ template<typename valueType> class Vector{
   void Vector<valueType>::add(valueType value){
     if(capacity==count) expandCapacity();
     array[count] = value;
+    count++;
   }
 
 /* 
@@ -302,7 +334,7 @@ template<typename valueType> class Vector{
     capacity = src.capacity + INITIAL_CAPACITY;
     array = new valueType[capacity];
     for(int i=0;i<count;i++){
-      array[i] = src[i];
+      array[i] = src.array[i];
     }
   }
 
@@ -314,9 +346,9 @@ template<typename valueType> class Vector{
 
   template<typename valueType>
   void Vector<valueType>::expandCapacity(){
-    Vector* oldArray = array;
+    valueType* oldArray = array;
     capacity *=2;
-    Vector* newArray = new valueType[capacity];
+    valueType* newArray = new valueType[capacity];
     for(int i=0;i<count;i++){
       newArray[i] = array[i];
     }